@@ -0,0 +1,408 @@
+﻿#ifndef __LOGCOMPRESS_H__
+#define __LOGCOMPRESS_H__
+
+// Compressão dos segmentos na escrita (segmentCompression=gzip): cada lote gravado é passado pelo
+// deflate e termina em Z_SYNC_FLUSH, então o arquivo é decodificável até o último lote gravado.
+// A cada blockBytes de entrada o membro gzip é fechado e um novo começa: membros são independentes
+// (gzip -dc lê a concatenação) e o segmento sai pronto para arquivar, sem a segunda passada do ZIP.
+// ParallelDeflater comprime os pacotes do compressMode em várias threads.
+
+#include <zlib.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+namespace WYD_Server {
+namespace Compress {
+
+    static constexpr const char* FILE_EXTENSION = ".gz";
+    static constexpr size_t DEFAULT_BLOCK_BYTES = 1 << 20;     // Entrada por membro gzip
+    static constexpr int LIVE_LEVEL = 1;                       // Z_BEST_SPEED: o worker não pode esperar o deflate
+    static constexpr size_t PARALLEL_BLOCK_BYTES = 128 * 1024; // Entrada de cada bloco do ParallelDeflater (como o pigz)
+    static constexpr size_t DICTIONARY_BYTES = 32 * 1024;      // Janela do deflate: fim do bloco anterior
+
+    class GzipStream {
+    public:
+        GzipStream() = default;
+        ~GzipStream() { End(); }
+
+        GzipStream(const GzipStream&) = delete;
+        GzipStream& operator=(const GzipStream&) = delete;
+
+        // Estado do zlib alocado uma vez por segmento; false se o deflateInit2 falhar
+        bool Begin(int level = LIVE_LEVEL, size_t blockBytes = DEFAULT_BLOCK_BYTES) {
+            End();
+            stream = z_stream{};
+            // windowBits 15 + 16: cabeçalho e trailer gzip, CRC-32 em stream.adler
+            if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            this->blockBytes = blockBytes > 0 ? blockBytes : DEFAULT_BLOCK_BYTES;
+            active = true;
+            memberOpen = false;
+            emergencyStarted = false;
+            return true;
+        }
+
+        // Libera o zlib sem fechar o membro aberto (use Finish antes)
+        void End() {
+            if (active) {
+                deflateEnd(&stream);
+                active = false;
+                memberOpen = false;
+            }
+        }
+
+        bool IsActive() const { return active; }
+
+        // Comprime input e acrescenta em out, terminando em sync flush. Quando o membro passa de
+        // blockBytes ele é fechado; o próximo lote abre outro.
+        void Compress(std::string_view input, std::string& out) {
+            if (!active || input.empty()) {
+                return;
+            }
+
+            busy.store(true, std::memory_order_relaxed);
+            if (!memberOpen) {
+                deflateReset(&stream);
+                memberOpen = true;
+            }
+
+            stream.next_in = (Bytef*)input.data();
+            stream.avail_in = (uInt)input.size();
+            bool finish = stream.total_in + input.size() >= blockBytes;
+            Run(finish ? Z_FINISH : Z_SYNC_FLUSH, out);
+            if (finish) {
+                memberOpen = false;
+            }
+            busy.store(false, std::memory_order_relaxed);
+        }
+
+        // Fecha o membro aberto (fim do segmento)
+        void Finish(std::string& out) {
+            if (!active || !memberOpen) {
+                return;
+            }
+            busy.store(true, std::memory_order_relaxed);
+            stream.next_in = nullptr;
+            stream.avail_in = 0;
+            Run(Z_FINISH, out);
+            memberOpen = false;
+            busy.store(false, std::memory_order_relaxed);
+        }
+
+        // =======================
+        // Dreno de emergência: continua o membro com blocos "stored" e o fecha sem chamar deflate()
+        // (a thread que morreu pode estar dentro dele). Depois de um sync flush o deflate está
+        // alinhado em byte, então blocos stored podem ser acrescentados direto. Sem alocação;
+        // emit(const char*, size_t) grava os bytes. false se o deflate estava no meio de um lote.
+        // =======================
+        template<typename Emit>
+        bool EmergencyAppend(const char* data, size_t size, Emit&& emit) {
+            if (!active || busy.load(std::memory_order_relaxed)) {
+                return false;
+            }
+
+            if (!emergencyStarted) {
+                emergencyStarted = true;
+                if (memberOpen) {
+                    emergencyCrc = stream.adler;
+                    emergencySize = (uint32_t)stream.total_in;
+                }
+                else {
+                    // Membro novo: cabeçalho gzip mínimo (sem nome nem mtime)
+                    static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+                    emit((const char*)header, sizeof(header));
+                    emergencyCrc = crc32(0L, Z_NULL, 0);
+                    emergencySize = 0;
+                    memberOpen = true;
+                }
+            }
+
+            while (size > 0) {
+                size_t chunk = size < 65535 ? size : 65535;
+                unsigned char block[5] = { 0,
+                    (unsigned char)(chunk & 0xFF), (unsigned char)(chunk >> 8),
+                    (unsigned char)(~chunk & 0xFF), (unsigned char)((~chunk >> 8) & 0xFF) };
+                emit((const char*)block, sizeof(block));
+                emit(data, chunk);
+
+                emergencyCrc = crc32(emergencyCrc, (const Bytef*)data, (uInt)chunk);
+                emergencySize += (uint32_t)chunk;
+                data += chunk;
+                size -= chunk;
+            }
+            return true;
+        }
+
+        template<typename Emit>
+        void EmergencyFinish(Emit&& emit) {
+            if (!active || busy.load(std::memory_order_relaxed) || !memberOpen) {
+                return;
+            }
+            if (!emergencyStarted) {
+                EmergencyAppend("", 0, emit);
+            }
+
+            // Bloco stored vazio com BFINAL + trailer (CRC-32 e tamanho, little endian)
+            unsigned char tail[13] = { 1, 0, 0, 0xff, 0xff };
+            for (int i = 0; i < 4; ++i) {
+                tail[5 + i] = (unsigned char)((emergencyCrc >> (8 * i)) & 0xFF);
+                tail[9 + i] = (unsigned char)((emergencySize >> (8 * i)) & 0xFF);
+            }
+            emit((const char*)tail, sizeof(tail));
+            memberOpen = false;
+        }
+
+    private:
+        void Run(int flush, std::string& out) {
+            do {
+                size_t used = out.size();
+                size_t room = deflateBound(&stream, stream.avail_in) + 64;
+                out.resize(used + room);
+                stream.next_out = (Bytef*)out.data() + used;
+                stream.avail_out = (uInt)room;
+                deflate(&stream, flush);
+                out.resize(used + (room - stream.avail_out));
+            } while (stream.avail_out == 0);
+        }
+
+        z_stream stream{};
+        size_t blockBytes = DEFAULT_BLOCK_BYTES;
+        bool active = false;
+        bool memberOpen = false;
+        std::atomic<bool> busy{false};
+
+        bool emergencyStarted = false;
+        unsigned long emergencyCrc = 0;
+        uint32_t emergencySize = 0;
+    };
+
+    // =======================
+    // Deflate paralelo estilo pigz. A entrada é lida em lotes de 2 blocos por thread; cada bloco é
+    // comprimido por uma thread com os 32 KB anteriores como dicionário e termina em sync flush, então
+    // a concatenação em ordem é um único stream deflate cru (o de uma entrada ZIP). O stream fecha com
+    // um bloco final vazio e o CRC-32 da entrada sai de crc32_combine dos blocos.
+    // A thread chamadora também comprime: threads = 1 não cria nenhuma thread.
+    // =======================
+    class ParallelDeflater {
+    public:
+        ParallelDeflater(int level, int threads, size_t blockBytes = PARALLEL_BLOCK_BYTES)
+            : level(level), blockBytes(blockBytes < DICTIONARY_BYTES ? DICTIONARY_BYTES : blockBytes) {
+            if (threads < 1) threads = 1;
+            streams.resize((size_t)threads);
+            for (auto& stream : streams) {
+                // windowBits negativo: deflate cru, sem cabeçalho zlib (o ZIP guarda CRC e tamanhos)
+                ready = deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK && ready;
+            }
+            jobs.resize((size_t)threads * 2);
+            for (int i = 1; i < threads; ++i) {
+                workers.emplace_back(&ParallelDeflater::WorkerLoop, this, (size_t)i);
+            }
+        }
+
+        ~ParallelDeflater() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            startCV.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            for (auto& stream : streams) {
+                deflateEnd(&stream);
+            }
+        }
+
+        ParallelDeflater(const ParallelDeflater&) = delete;
+        ParallelDeflater& operator=(const ParallelDeflater&) = delete;
+
+        int GetThreadCount() const { return (int)streams.size(); }
+        int GetLevel() const { return level; }
+
+        // read(char* buffer, size_t capacity) -> bytes lidos (0 = fim da entrada, < 0 = erro/cancelado)
+        // write(const char* data, size_t size) -> false interrompe
+        // Grava o stream deflate cru completo; rawSize/crc descrevem a entrada
+        template<typename Read, typename Write>
+        bool Deflate(Read&& read, Write&& write, uint64_t& rawSize, unsigned long& crc) {
+            rawSize = 0;
+            crc = crc32(0L, Z_NULL, 0);
+            if (!ready) {
+                return false;
+            }
+
+            const size_t batchBytes = blockBytes * jobs.size();
+            buffer.resize(DICTIONARY_BYTES + batchBytes);
+            unsigned char* data = buffer.data() + DICTIONARY_BYTES;
+            size_t dictionary = 0;      // Bytes do lote anterior logo antes de data
+
+            for (;;) {
+                size_t filled = 0;
+                while (filled < batchBytes) {
+                    auto n = read((char*)data + filled, batchBytes - filled);
+                    if (n < 0) {
+                        return false;
+                    }
+                    if (n == 0) {
+                        break;
+                    }
+                    filled += (size_t)n;
+                }
+                if (filled == 0) {
+                    break;
+                }
+
+                size_t count = (filled + blockBytes - 1) / blockBytes;
+                for (size_t i = 0; i < count; ++i) {
+                    Job& job = jobs[i];
+                    job.input = data + i * blockBytes;
+                    job.size = (std::min)(blockBytes, filled - i * blockBytes);
+                    job.dictionary = i == 0 ? dictionary : DICTIONARY_BYTES;
+                    job.output.clear();
+                }
+                RunJobs(count);
+
+                for (size_t i = 0; i < count; ++i) {
+                    const Job& job = jobs[i];
+                    if (!job.ok || !write(job.output.data(), job.output.size())) {
+                        return false;
+                    }
+                    crc = crc32_combine(crc, job.crc, (z_off_t)job.size);
+                    rawSize += job.size;
+                }
+
+                if (filled < batchBytes) {
+                    break;
+                }
+
+                // Dicionário do primeiro bloco do próximo lote
+                memmove(buffer.data(), data + filled - DICTIONARY_BYTES, DICTIONARY_BYTES);
+                dictionary = DICTIONARY_BYTES;
+            }
+
+            // Bloco final vazio (BFINAL, Huffman fixo, só o fim de bloco): fecha o stream
+            static const char finalBlock[2] = { 0x03, 0x00 };
+            return write(finalBlock, sizeof(finalBlock));
+        }
+
+    private:
+        struct Job {
+            const unsigned char* input = nullptr;
+            size_t size = 0;
+            size_t dictionary = 0;
+            std::string output;
+            unsigned long crc = 0;
+            bool ok = false;
+        };
+
+        void RunJobs(size_t count) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobCount = count;
+                nextJob = 0;
+                doneJobs = 0;
+                ++generation;
+            }
+            startCV.notify_all();
+
+            Work(streams[0]);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            doneCV.wait(lock, [this] { return doneJobs == jobCount; });
+        }
+
+        // Blocos reivindicados sob o mutex: cada um comprime 128 KB, o lock não aparece no custo
+        void Work(z_stream& stream) {
+            for (;;) {
+                size_t index;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (nextJob >= jobCount) {
+                        return;
+                    }
+                    index = nextJob++;
+                }
+
+                CompressJob(stream, jobs[index]);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++doneJobs == jobCount) {
+                    doneCV.notify_one();
+                }
+            }
+        }
+
+        void WorkerLoop(size_t index) {
+            uint64_t seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    startCV.wait(lock, [&] { return stopping || generation != seen; });
+                    if (stopping) {
+                        return;
+                    }
+                    seen = generation;
+                }
+                Work(streams[index]);
+            }
+        }
+
+        static void CompressJob(z_stream& stream, Job& job) {
+            job.ok = false;
+            job.crc = crc32(crc32(0L, Z_NULL, 0), job.input, (uInt)job.size);
+            if (deflateReset(&stream) != Z_OK) {
+                return;
+            }
+            if (job.dictionary > 0 &&
+                deflateSetDictionary(&stream, job.input - job.dictionary, (uInt)job.dictionary) != Z_OK) {
+                return;
+            }
+
+            stream.next_in = (Bytef*)job.input;
+            stream.avail_in = (uInt)job.size;
+            do {
+                size_t used = job.output.size();
+                size_t room = deflateBound(&stream, stream.avail_in) + 64;
+                job.output.resize(used + room);
+                stream.next_out = (Bytef*)job.output.data() + used;
+                stream.avail_out = (uInt)room;
+                if (deflate(&stream, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+                    return;
+                }
+                job.output.resize(used + (room - stream.avail_out));
+            } while (stream.avail_out == 0);
+            job.ok = true;
+        }
+
+        const int level;
+        const size_t blockBytes;
+        bool ready = true;
+        std::vector<z_stream> streams;
+        std::vector<Job> jobs;
+        std::vector<unsigned char> buffer;
+
+        std::mutex mutex;
+        std::condition_variable startCV;
+        std::condition_variable doneCV;
+        size_t jobCount = 0;
+        size_t nextJob = 0;
+        size_t doneJobs = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+
+} // namespace Compress
+} // namespace WYD_Server
+
+#endif // __LOGCOMPRESS_H__
@@ -0,0 +1,181 @@
+﻿#ifndef __LOGCRASH_H__
+#define __LOGCRASH_H__
+
+// Dreno de emergência: monta linhas de texto e registros do segmento binário em um buffer fixo,
+// sem alocação, locks ou chamadas de biblioteca que não sejam seguras dentro de um handler de
+// sinal/exceção. Usado por LogSystem::EmergencyDrain quando o processo está morrendo.
+// A hora local vem de um deslocamento UTC calculado de antemão (localtime não é
+// async-signal-safe).
+
+#include "LogSegment.h"
+
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+namespace WYD_Server {
+namespace Crash {
+
+    static constexpr size_t LINE_CAPACITY = 4096;   // Linha/registro maior é truncado
+
+    // Buffer de uma linha ou registro. Append trunca em LINE_CAPACITY; EndLine sempre cabe.
+    class LineBuffer {
+    public:
+        void Clear() { size = 0; }
+        const char* Data() const { return data; }
+        size_t Size() const { return size; }
+        size_t Remaining() const { return LINE_CAPACITY - size; }
+
+        void Append(const char* src, size_t length) {
+            if (length > Remaining()) length = Remaining();
+            memcpy(data + size, src, length);
+            size += length;
+        }
+
+        void Append(std::string_view text) { Append(text.data(), text.size()); }
+
+        void Append(char c) {
+            if (size < LINE_CAPACITY) data[size++] = c;
+        }
+
+        // Decimal com zeros à esquerda até width dígitos
+        void AppendDecimal(uint64_t value, int width = 0) {
+            char digits[20];
+            int count = 0;
+            do {
+                digits[count++] = (char)('0' + value % 10);
+                value /= 10;
+            } while (value != 0 && count < 20);
+            while (count < width && count < 20) {
+                digits[count++] = '0';
+            }
+            while (count > 0) {
+                Append(digits[--count]);
+            }
+        }
+
+        void AppendVarint(uint64_t value) {
+            while (value >= 0x80) {
+                Append((char)((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            Append((char)value);
+        }
+
+        void AppendFixed(uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) Append((char)((value >> (8 * i)) & 0xFF));
+        }
+
+        // "\r\n" no espaço reservado além de LINE_CAPACITY
+        void EndLine() {
+            data[size++] = '\r';
+            data[size++] = '\n';
+        }
+
+    private:
+        char data[LINE_CAPACITY + 2];
+        size_t size = 0;
+    };
+
+    // Dias desde 1970-01-01 -> data civil (algoritmo days_from_civil invertido, só aritmética inteira)
+    inline void CivilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned doe = (unsigned)(days - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        day = doy - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = (int64_t)yoe + era * 400 + (month <= 2 ? 1 : 0);
+    }
+
+    // Mesmo formato do Segment::TextRenderer:
+    // "[YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] msg [extra] [IP:a.b.c.d]\r\n", msg/extra escapados como lá
+    inline void RenderLine(LineBuffer& out, uint8_t level, uint64_t micros, int64_t utcOffsetSeconds,
+                           int fractionDigits, uint32_t ip, std::string_view msg, std::string_view extra,
+                           Segment::EscapeMode escape) {
+        int64_t local = (int64_t)(micros / 1000000) + utcOffsetSeconds;
+        int64_t days = local >= 0 ? local / 86400 : (local - 86399) / 86400;
+        int64_t secondOfDay = local - days * 86400;
+
+        int64_t year;
+        unsigned month, day;
+        CivilFromDays(days, year, month, day);
+
+        out.Append('[');
+        out.AppendDecimal((uint64_t)year, 4);
+        out.Append('-');
+        out.AppendDecimal(month, 2);
+        out.Append('-');
+        out.AppendDecimal(day, 2);
+        out.Append(' ');
+        out.AppendDecimal((uint64_t)(secondOfDay / 3600), 2);
+        out.Append(':');
+        out.AppendDecimal((uint64_t)(secondOfDay / 60 % 60), 2);
+        out.Append(':');
+        out.AppendDecimal((uint64_t)(secondOfDay % 60), 2);
+        if (fractionDigits > 0) {
+            uint64_t fraction = micros % 1000000;
+            if (fractionDigits < 6) fraction /= 1000;
+            out.Append('.');
+            out.AppendDecimal(fraction, fractionDigits < 6 ? 3 : 6);
+        }
+        out.Append("] ");
+        out.Append(std::string_view(Segment::LevelTag(level)));
+        out.Append(' ');
+        auto write = [&out](const char* data, size_t size) { out.Append(data, size); };
+        Segment::EscapeText(msg, escape, write);
+
+        if (!extra.empty()) {
+            out.Append(" [");
+            Segment::EscapeText(extra, escape, write);
+            out.Append(']');
+        }
+
+        if (ip != 0) {
+            out.Append(" [IP:");
+            out.AppendDecimal((ip >> 24) & 0xFF);
+            out.Append('.');
+            out.AppendDecimal((ip >> 16) & 0xFF);
+            out.Append('.');
+            out.AppendDecimal((ip >> 8) & 0xFF);
+            out.Append('.');
+            out.AppendDecimal(ip & 0xFF);
+            out.Append(']');
+        }
+
+        out.EndLine();
+    }
+
+    // Segmento binário: o dreno começa com um Reset (tabela de strings e base de tempo zeradas),
+    // então os registros seguintes são literais e independem do estado do Segment::Encoder
+    inline void EncodeReset(LineBuffer& out, uint64_t baseMicros) {
+        out.Append((char)Segment::TAG_RESET);
+        out.AppendFixed(baseMicros, 8);
+    }
+
+    // msg/extra truncados para o registro caber inteiro no buffer (comprimentos sempre consistentes)
+    inline void EncodeRecord(LineBuffer& out, uint8_t level, int64_t deltaMicros, uint32_t ip,
+                             std::string_view msg, std::string_view extra) {
+        constexpr size_t RECORD_OVERHEAD = 1 + 10 + 4 + 1 + 10 + 10;
+        size_t room = out.Remaining() > RECORD_OVERHEAD ? out.Remaining() - RECORD_OVERHEAD : 0;
+        if (msg.size() > room) msg = msg.substr(0, room);
+        room -= msg.size();
+        if (extra.size() > room) extra = extra.substr(0, room);
+
+        out.Append((char)level);
+        out.AppendVarint(Segment::ZigZag(deltaMicros));
+        out.AppendFixed(ip, 4);
+        out.AppendVarint(0);            // msgId 0: mensagem literal
+        out.AppendVarint(msg.size());
+        out.Append(msg);
+        out.AppendVarint(extra.size());
+        out.Append(extra);
+    }
+
+} // namespace Crash
+} // namespace WYD_Server
+
+#endif // __LOGCRASH_H__
@@ -0,0 +1,187 @@
+﻿#ifndef __LOGDISPLAY_H__
+#define __LOGDISPLAY_H__
+
+// Estágio de exibição das janelas de log (TargetSide).
+// As linhas de cada painel são acumuladas em runs de mesma cor e publicadas em quadros,
+// no máximo maxFps por segundo. O número de linhas da janela é contado localmente
+// (sem EM_GETLINECOUNT) para calcular quantas linhas remover do topo.
+//
+// ISurface é o destino de um quadro: RichEditSurface (LogSystem.h) é o adaptador Win32 e
+// HeadlessSurface o dublê usado pelo display_benchmark (compila fora do Windows).
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+namespace WYD_Server {
+namespace Display {
+
+    struct ColorRun {
+        uint32_t color = 0;     // COLORREF
+        size_t length = 0;      // Bytes de Frame::text cobertos pelo run
+    };
+
+    // Texto novo de um painel. A superfície acrescenta os runs e depois remove trimLines do topo;
+    // reset = limpar a janela antes (o quadro sozinho já ocupa maxLines)
+    struct Frame {
+        std::string text;
+        std::vector<ColorRun> runs;
+        size_t lines = 0;
+        size_t trimLines = 0;
+        bool reset = false;
+
+        bool Empty() const { return text.empty(); }
+
+        void Clear() {
+            text.clear();
+            runs.clear();
+            lines = 0;
+            trimLines = 0;
+            reset = false;
+        }
+    };
+
+    class ISurface {
+    public:
+        virtual ~ISurface() = default;
+        virtual void Apply(const Frame& frame) = 0;
+    };
+
+    // Acumula as linhas de um painel. Não é thread-safe: usado apenas pela thread do sink da janela.
+    class Batcher {
+    public:
+        void SetMaxFps(int fps) { frameIntervalNs = fps > 0 ? 1000000000ull / (uint64_t)fps : 0; }
+        void SetMaxLines(size_t lines) { maxLines = (std::max)(lines, (size_t)1); }
+
+        // Janela limpa/trocada por fora (ClearRichEdit, SetTarget)
+        void ResetLineCount() { lineCount = 0; }
+
+        void Append(std::string_view line, uint32_t color) {
+            if (line.empty()) return;
+
+            if (!pending.runs.empty() && pending.runs.back().color == color) {
+                pending.runs.back().length += line.size();
+            }
+            else {
+                pending.runs.push_back({ color, line.size() });
+            }
+            pending.text.append(line);
+            pending.lines += (size_t)std::count(line.begin(), line.end(), '\n');
+        }
+
+        bool HasPending() const { return !pending.Empty(); }
+
+        // Publica o quadro pendente se o intervalo mínimo já passou; force ignora o intervalo
+        // (fila do sink vazia: não há rajada a agrupar)
+        bool Publish(ISurface& surface, uint64_t nowNs, bool force) {
+            if (pending.Empty()) {
+                return false;
+            }
+            if (!force && published && nowNs - lastPublishNs < frameIntervalNs) {
+                return false;
+            }
+
+            FinishFrame();
+            surface.Apply(pending);
+            pending.Clear();
+
+            lastPublishNs = nowNs;
+            published = true;
+            ++frames;
+            return true;
+        }
+
+        uint64_t GetFrames() const { return frames; }
+        size_t GetLineCount() const { return lineCount; }
+
+    private:
+        void FinishFrame() {
+            if (pending.lines >= maxLines) {
+                // Tudo o que está na janela sairia de qualquer forma: limpa e envia só o final
+                DropLeadingLines(pending.lines - maxLines);
+                pending.reset = true;
+                lineCount = pending.lines;
+                return;
+            }
+
+            lineCount += pending.lines;
+            if (lineCount > maxLines) {
+                pending.trimLines = lineCount - maxLines;
+                lineCount = maxLines;
+            }
+        }
+
+        void DropLeadingLines(size_t count) {
+            size_t cut = 0;
+            for (size_t i = 0; i < count; ++i) {
+                size_t newline = pending.text.find('\n', cut);
+                if (newline == std::string::npos) break;
+                cut = newline + 1;
+            }
+            pending.text.erase(0, cut);
+            pending.lines -= count;
+
+            auto it = pending.runs.begin();
+            while (it != pending.runs.end() && cut >= it->length) {
+                cut -= it->length;
+                ++it;
+            }
+            pending.runs.erase(pending.runs.begin(), it);
+            if (!pending.runs.empty()) {
+                pending.runs.front().length -= cut;
+            }
+        }
+
+        Frame pending;
+        size_t maxLines = 10000;
+        size_t lineCount = 0;
+        uint64_t frameIntervalNs = 1000000000ull / 30;
+        uint64_t lastPublishNs = 0;
+        bool published = false;
+        uint64_t frames = 0;
+    };
+
+    // Dublê sem janela: guarda só contadores e o total de linhas que a janela teria
+    class HeadlessSurface : public ISurface {
+    public:
+        // Chamadas Win32 de LogSystem::ApplyDisplayFrame: fixas por quadro, por run de cor, por remoção do topo e por limpeza
+        static constexpr uint64_t CALLS_PER_FRAME = 6;
+        static constexpr uint64_t CALLS_PER_RUN = 2;
+        static constexpr uint64_t CALLS_PER_TRIM = 5;
+        static constexpr uint64_t CALLS_PER_RESET = 3;
+
+        void Apply(const Frame& frame) override {
+            ++frames;
+            runs += frame.runs.size();
+            bytes += frame.text.size();
+
+            if (frame.reset) {
+                ++resets;
+                lines = 0;
+            }
+            lines += frame.lines;
+            if (frame.trimLines > 0) {
+                ++trims;
+                lines -= (std::min)(lines, frame.trimLines);
+            }
+        }
+
+        uint64_t EstimatedWindowCalls() const {
+            return frames * CALLS_PER_FRAME + runs * CALLS_PER_RUN + trims * CALLS_PER_TRIM + resets * CALLS_PER_RESET;
+        }
+
+        uint64_t frames = 0;
+        uint64_t runs = 0;
+        uint64_t bytes = 0;
+        uint64_t trims = 0;
+        uint64_t resets = 0;
+        size_t lines = 0;
+    };
+
+} // namespace Display
+} // namespace WYD_Server
+
+#endif // __LOGDISPLAY_H__
@@ -0,0 +1,243 @@
+﻿#ifndef __LOGINDEX_H__
+#define __LOGINDEX_H__
+
+// Índice lateral dos segmentos (segmentIndex=true): server_..._N.log.idx ao lado de cada segmento,
+// gravado pelo worker enquanto loga. O segmento é dividido em blocos de ~indexBlockKB; para cada
+// bloco o índice guarda onde ele está, o intervalo de tempo, os níveis presentes e um filtro de
+// Bloom dos IPs. Uma busca ("Errors do IP x entre 14:02 e 14:10") lê só os blocos que podem conter
+// o que procura. Usado pelo LogSystem para gravar e pela ferramenta logq.
+//
+// Layout (inteiros em little-endian):
+//   Cabeçalho : "LSIX" | u16 versão | u16 flags | u32 blockBytes | u32 BLOOM_BYTES
+//   Bloco     : u64 offset | u64 length | u64 firstMicros | u64 lastMicros | u32 registros
+//               u16 máscara de níveis | u16 reservado | BLOOM_BYTES bytes de Bloom
+//
+// Offsets são do segmento antes da compressão (FLAG_COMPRESSED: posições no stream gzip
+// descomprimido). No formato binário cada bloco começa no cabeçalho ou num Reset, então decodifica
+// sozinho. Bytes fora de todos os blocos (início de um segmento reaberto sem índice, fim ainda não
+// fechado em um bloco, dreno de emergência) não são cobertos e precisam ser lidos inteiros.
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+namespace WYD_Server {
+namespace Index {
+
+    static constexpr char MAGIC[4] = { 'L', 'S', 'I', 'X' };
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr uint16_t FLAG_COMPRESSED = 1;     // Offsets no stream descomprimido (.gz)
+    static constexpr uint16_t FLAG_BINARY = 2;         // Segmento .lsb
+    static constexpr size_t BLOOM_BYTES = 512;         // 4096 bits: ~2% de falso positivo com 500 IPs por bloco
+    static constexpr int BLOOM_HASHES = 4;
+    static constexpr size_t ENTRY_SIZE = 8 * 4 + 4 + 2 + 2 + BLOOM_BYTES;
+    static constexpr size_t DEFAULT_BLOCK_BYTES = 64 * 1024;
+    static constexpr const char* FILE_EXTENSION = ".idx";
+
+    struct Block {
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        uint64_t firstMicros = 0;
+        uint64_t lastMicros = 0;
+        uint32_t records = 0;
+        uint16_t levelMask = 0;
+        uint8_t bloom[BLOOM_BYTES] = {};
+
+        // Hash duplo sobre o IP misturado (finalizador do splitmix64); IP 0 (sem IP) não entra no filtro
+        static uint32_t BloomBit(uint32_t ip, int i) {
+            uint64_t h = ip + 0x9E3779B97F4A7C15ull;
+            h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+            h ^= h >> 31;
+            uint32_t h1 = (uint32_t)h;
+            uint32_t h2 = (uint32_t)(h >> 32) | 1;
+            return (h1 + (uint32_t)i * h2) % (BLOOM_BYTES * 8);
+        }
+
+        void AddIp(uint32_t ip) {
+            for (int i = 0; i < BLOOM_HASHES; ++i) {
+                uint32_t bit = BloomBit(ip, i);
+                bloom[bit / 8] |= (uint8_t)(1u << (bit % 8));
+            }
+        }
+
+        bool MayContainIp(uint32_t ip) const {
+            for (int i = 0; i < BLOOM_HASHES; ++i) {
+                uint32_t bit = BloomBit(ip, i);
+                if (!(bloom[bit / 8] & (1u << (bit % 8)))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    // Filtro de uma busca; campos zerados não filtram
+    struct Query {
+        uint64_t fromMicros = 0;
+        uint64_t toMicros = UINT64_MAX;
+        uint16_t levelMask = 0xFFFF;
+        uint32_t ip = 0;
+
+        bool Matches(const Block& b) const {
+            return b.lastMicros >= fromMicros && b.firstMicros <= toMicros &&
+                (b.levelMask & levelMask) != 0 && (ip == 0 || b.MayContainIp(ip));
+        }
+    };
+
+    struct Range {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    inline void PutFixed(std::string& out, uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out.push_back((char)(v >> (8 * i)));
+        }
+    }
+
+    inline uint64_t GetFixed(const char* p, int bytes) {
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) {
+            v |= (uint64_t)(uint8_t)p[i] << (8 * i);
+        }
+        return v;
+    }
+
+    inline void WriteHeader(uint16_t flags, uint32_t blockBytes, std::string& out) {
+        out.append(MAGIC, sizeof(MAGIC));
+        PutFixed(out, VERSION, 2);
+        PutFixed(out, flags, 2);
+        PutFixed(out, blockBytes, 4);
+        PutFixed(out, BLOOM_BYTES, 4);
+    }
+
+    // Acumula o bloco atual do segmento aberto (só o worker usa, sob fileMutex)
+    class Builder {
+    public:
+        void SetBlockBytes(size_t bytes) { blockBytes = bytes; }
+        size_t GetBlockBytes() const { return blockBytes; }
+
+        // Próximo bloco começa em offset (cabeçalho/Reset no formato binário, primeira linha no texto)
+        void Begin(uint64_t offset) {
+            block = Block();
+            block.offset = offset;
+            open = true;
+        }
+
+        bool IsOpen() const { return open; }
+        bool IsFull(uint64_t offset) const { return open && block.records > 0 && offset - block.offset >= blockBytes; }
+
+        void Add(uint64_t micros, uint8_t level, uint32_t ip) {
+            if (block.records == 0) {
+                block.firstMicros = micros;
+            }
+            block.lastMicros = (std::max)(block.lastMicros, micros);
+            block.firstMicros = (std::min)(block.firstMicros, micros);
+            block.levelMask |= (uint16_t)(1u << level);
+            ++block.records;
+            if (ip != 0) {
+                block.AddIp(ip);
+            }
+        }
+
+        // Fecha o bloco em endOffset; false se estava vazio (nada a gravar)
+        bool Finish(uint64_t endOffset, std::string& out) {
+            bool wrote = open && block.records > 0;
+            if (wrote) {
+                block.length = endOffset - block.offset;
+                PutFixed(out, block.offset, 8);
+                PutFixed(out, block.length, 8);
+                PutFixed(out, block.firstMicros, 8);
+                PutFixed(out, block.lastMicros, 8);
+                PutFixed(out, block.records, 4);
+                PutFixed(out, block.levelMask, 2);
+                PutFixed(out, 0, 2);
+                out.append((const char*)block.bloom, BLOOM_BYTES);
+            }
+            open = false;
+            return wrote;
+        }
+
+    private:
+        Block block;
+        size_t blockBytes = DEFAULT_BLOCK_BYTES;
+        bool open = false;
+    };
+
+    // Leitura de um .idx carregado em memória
+    class Reader {
+    public:
+        // false se não for um índice LSIX; uma entrada truncada no fim é ignorada
+        bool Load(const char* data, size_t size) {
+            blocks.clear();
+            if (size < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0 ||
+                GetFixed(data + 4, 2) > VERSION || GetFixed(data + 12, 4) != BLOOM_BYTES) {
+                return false;
+            }
+            flags = (uint16_t)GetFixed(data + 6, 2);
+            blockBytes = (uint32_t)GetFixed(data + 8, 4);
+
+            for (size_t pos = HEADER_SIZE; pos + ENTRY_SIZE <= size; pos += ENTRY_SIZE) {
+                const char* p = data + pos;
+                Block b;
+                b.offset = GetFixed(p, 8);
+                b.length = GetFixed(p + 8, 8);
+                b.firstMicros = GetFixed(p + 16, 8);
+                b.lastMicros = GetFixed(p + 24, 8);
+                b.records = (uint32_t)GetFixed(p + 32, 4);
+                b.levelMask = (uint16_t)GetFixed(p + 36, 2);
+                memcpy(b.bloom, p + 40, BLOOM_BYTES);
+                blocks.push_back(b);
+            }
+            return true;
+        }
+
+        const std::vector<Block>& GetBlocks() const { return blocks; }
+        uint16_t GetFlags() const { return flags; }
+        uint32_t GetBlockBytes() const { return blockBytes; }
+
+        // Trechos do segmento (de segmentSize bytes) que precisam ser lidos: os blocos que podem
+        // atender a busca mais tudo que nenhum bloco cobre. Em ordem e com vizinhos unidos.
+        std::vector<Range> Select(const Query& query, uint64_t segmentSize) const {
+            std::vector<Range> ranges;
+            auto add = [&ranges](uint64_t offset, uint64_t end) {
+                if (end <= offset) return;
+                if (!ranges.empty() && ranges.back().offset + ranges.back().length == offset) {
+                    ranges.back().length += end - offset;
+                }
+                else {
+                    ranges.push_back(Range{ offset, end - offset });
+                }
+            };
+
+            uint64_t covered = 0;
+            for (const Block& b : blocks) {
+                uint64_t begin = (std::min)(b.offset, segmentSize);
+                uint64_t end = (std::min)(b.offset + b.length, segmentSize);
+                if (begin > covered) {
+                    add(covered, begin);    // Lacuna sem índice
+                }
+                if (query.Matches(b)) {
+                    add(begin, end);
+                }
+                covered = (std::max)(covered, end);
+            }
+            add(covered, segmentSize);
+            return ranges;
+        }
+
+    private:
+        std::vector<Block> blocks;
+        uint16_t flags = 0;
+        uint32_t blockBytes = 0;
+    };
+
+} // namespace Index
+} // namespace WYD_Server
+
+#endif // __LOGINDEX_H__
@@ -0,0 +1,370 @@
+﻿#ifndef __LOGMANIFEST_H__
+#define __LOGMANIFEST_H__
+
+// Manifesto dos segmentos (logDir/segments.manifest): registro append-only de cada segmento
+// aberto, fechado, arquivado ou excluído, e dos pacotes aguardando upload. A limpeza escolhe os
+// dias expirados pelo mapa ordenado por dia, sem percorrer o diretório nem aplicar regex a cada
+// arquivo. Só a primeira execução (sem manifesto) varre o diretório.
+//
+// Registros (um por linha, o nome sempre por último):
+//   open <dia> <tamanho> <nome>      segmento ativo
+//   segment <dia> <tamanho> <nome>   segmento fechado (varredura inicial/compactação)
+//   close <tamanho> <nome>           segmento fechado
+//   archived <nome>                  compactado em um ZIP e removido
+//   deleted <nome>                   removido sem arquivo (compressMode=none)
+//   upload <pacote>                  pacote aguardando upload
+//   uploaded <pacote>                upload concluído
+//   dropped <pacote>                 upload desistido (pacote apagado do disco)
+//
+// Linhas desconhecidas ou truncadas (queda no meio de uma gravação) são ignoradas. Ao carregar, o
+// manifesto é reescrito só com o estado atual; durante a execução é reescrito quando os registros
+// acumulados passam de COMPACT_RATIO vezes o que está sendo rastreado.
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <mutex>
+#include <cstdint>
+#include <cctype>
+
+namespace WYD_Server {
+namespace Manifest {
+
+    static constexpr const char* FILE_NAME = "segments.manifest";
+    static constexpr const char* HEADER = "# LogSystem segment manifest v1";
+    static constexpr size_t COMPACT_MIN_RECORDS = 4096;    // Abaixo disso o manifesto nunca é reescrito
+    static constexpr size_t COMPACT_RATIO = 4;
+
+    // server_YYYY-MM-DD_N.(log|lsb)[.gz] -> YYYY-MM-DD
+    inline bool ParseSegmentName(std::string_view name, std::string& day) {
+        constexpr std::string_view prefix = "server_";
+        if (name.size() < prefix.size() + 13 || name.substr(0, prefix.size()) != prefix) {
+            return false;
+        }
+
+        std::string_view date = name.substr(prefix.size(), 10);
+        for (size_t i = 0; i < date.size(); ++i) {
+            bool separator = i == 4 || i == 7;
+            if (separator ? date[i] != '-' : !std::isdigit((unsigned char)date[i])) {
+                return false;
+            }
+        }
+
+        std::string_view rest = name.substr(prefix.size() + 10);
+        if (rest[0] != '_') {
+            return false;
+        }
+        size_t digits = 1;
+        while (digits < rest.size() && std::isdigit((unsigned char)rest[digits])) {
+            ++digits;
+        }
+        std::string_view extension = rest.substr(digits);
+        if (digits == 1 || (extension != ".log" && extension != ".lsb" &&
+            extension != ".log.gz" && extension != ".lsb.gz")) {
+            return false;
+        }
+
+        day.assign(date);
+        return true;
+    }
+
+    struct SegmentInfo {
+        uint64_t size = 0;
+        bool live = false;
+    };
+
+    class SegmentManifest {
+    public:
+        using DayMap = std::map<std::string, std::vector<std::string>>;
+
+        SegmentManifest() = default;
+        SegmentManifest(const SegmentManifest&) = delete;
+        SegmentManifest& operator=(const SegmentManifest&) = delete;
+
+        // Carrega logDir/segments.manifest; sem manifesto faz a varredura inicial do diretório.
+        // Segmentos marcados como ativos são de uma execução anterior e passam a fechados.
+        // false se o manifesto não pôde ser gravado (o estado em memória continua valendo)
+        bool Load(const std::string& directory) {
+            std::lock_guard<std::mutex> lock(mutex);
+            days.clear();
+            dayOf.clear();
+            pendingUploads.clear();
+            path = directory + "/" + FILE_NAME;
+
+            std::ifstream in(path, std::ios::binary);
+            if (in.is_open()) {
+                std::string line;
+                while (std::getline(in, line)) {
+                    Replay(line);
+                }
+            }
+            else {
+                Scan(directory);
+            }
+
+            for (auto& [day, segments] : days) {
+                for (auto& [name, info] : segments) {
+                    info.live = false;
+                }
+            }
+            return Compact();
+        }
+
+        // Segmento ativado (novo ou reaberto no mesmo dia)
+        bool OpenSegment(const std::string& name, uint64_t size) {
+            std::string day;
+            if (!ParseSegmentName(name, day)) {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            Set(name, day, size, true);
+            Append("open " + day + " " + std::to_string(size) + " " + name);
+            return true;
+        }
+
+        void CloseSegment(const std::string& name, uint64_t size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            SegmentInfo* info = Find(name);
+            if (!info) {
+                return;
+            }
+            info->size = size;
+            info->live = false;
+            Append("close " + std::to_string(size) + " " + name);
+        }
+
+        // Compactado em um ZIP (ou já é o arquivo final): sai da limpeza
+        void ArchiveSegment(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (Remove(name)) {
+                Append("archived " + name);
+            }
+        }
+
+        void DeleteSegment(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (Remove(name)) {
+                Append("deleted " + name);
+            }
+        }
+
+        void AddPendingUpload(const std::string& archive) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pendingUploads.insert(archive).second) {
+                Append("upload " + archive);
+            }
+        }
+
+        void MarkUploaded(const std::string& archive) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pendingUploads.erase(archive) > 0) {
+                Append("uploaded " + archive);
+            }
+        }
+
+        void DropUpload(const std::string& archive) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pendingUploads.erase(archive) > 0) {
+                Append("dropped " + archive);
+            }
+        }
+
+        // Segmentos fechados dos dias até lastDay (inclusive), agrupados por dia.
+        // O mapa é ordenado por dia: o custo é proporcional aos expirados, não ao diretório
+        DayMap Expired(const std::string& lastDay) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            DayMap expired;
+            for (auto it = days.begin(); it != days.end() && it->first <= lastDay; ++it) {
+                for (const auto& [name, info] : it->second) {
+                    if (!info.live) {
+                        expired[it->first].push_back(name);
+                    }
+                }
+            }
+            return expired;
+        }
+
+        std::vector<std::string> GetPendingUploads() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return std::vector<std::string>(pendingUploads.begin(), pendingUploads.end());
+        }
+
+        size_t GetSegmentCount() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return dayOf.size();
+        }
+
+    private:
+        void Set(const std::string& name, const std::string& day, uint64_t size, bool live) {
+            auto previous = dayOf.find(name);
+            if (previous != dayOf.end() && previous->second != day) {
+                Remove(name);
+            }
+            dayOf[name] = day;
+            days[day][name] = SegmentInfo{ size, live };
+        }
+
+        SegmentInfo* Find(const std::string& name) {
+            auto it = dayOf.find(name);
+            if (it == dayOf.end()) {
+                return nullptr;
+            }
+            return &days[it->second][name];
+        }
+
+        bool Remove(const std::string& name) {
+            auto it = dayOf.find(name);
+            if (it == dayOf.end()) {
+                return false;
+            }
+
+            auto day = days.find(it->second);
+            if (day != days.end()) {
+                day->second.erase(name);
+                if (day->second.empty()) {
+                    days.erase(day);
+                }
+            }
+            dayOf.erase(it);
+            return true;
+        }
+
+        void Replay(const std::string& line) {
+            std::istringstream iss(line);
+            std::string op, day, name;
+            uint64_t size = 0;
+            iss >> op;
+
+            if (op == "open" || op == "segment") {
+                if (!(iss >> day >> size)) return;
+            }
+            else if (op == "close") {
+                if (!(iss >> size)) return;
+            }
+            else if (op != "archived" && op != "deleted" && op != "upload" && op != "uploaded" && op != "dropped") {
+                return;     // Comentário, registro desconhecido ou truncado
+            }
+
+            std::getline(iss >> std::ws, name);
+            if (name.empty()) {
+                return;
+            }
+
+            if (op == "open" || op == "segment") {
+                std::string parsedDay;
+                if (ParseSegmentName(name, parsedDay) && parsedDay == day) {
+                    Set(name, day, size, op == "open");
+                }
+            }
+            else if (op == "close") {
+                if (SegmentInfo* info = Find(name)) {
+                    info->size = size;
+                    info->live = false;
+                }
+            }
+            else if (op == "archived" || op == "deleted") {
+                Remove(name);
+            }
+            else if (op == "upload") {
+                pendingUploads.insert(name);
+            }
+            else {
+                pendingUploads.erase(name);
+            }
+        }
+
+        // Primeira execução: uma única passada pelo diretório
+        void Scan(const std::string& directory) {
+            std::error_code ec;
+            for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+                std::error_code fileEc;
+                if (!it->is_regular_file(fileEc)) {
+                    continue;
+                }
+
+                std::string name = it->path().filename().string();
+                std::string day;
+                if (ParseSegmentName(name, day)) {
+                    uint64_t size = it->file_size(fileEc);
+                    Set(name, day, fileEc ? 0 : size, false);
+                }
+            }
+        }
+
+        void Append(const std::string& record) {
+            if (!out.is_open()) {
+                return;
+            }
+
+            // Um registro por evento de segmento (rotação, limpeza): o flush imediato é barato
+            out << record << '\n';
+            out.flush();
+            ++records;
+
+            size_t tracked = dayOf.size() + pendingUploads.size();
+            if (records >= COMPACT_MIN_RECORDS && records > tracked * COMPACT_RATIO) {
+                Compact();
+            }
+        }
+
+        // Reescreve o manifesto só com o estado atual (arquivo temporário + rename)
+        bool Compact() {
+            if (out.is_open()) {
+                out.close();
+            }
+
+            std::string tmp = path + ".tmp";
+            bool ok;
+            {
+                std::ofstream rewrite(tmp, std::ios::binary | std::ios::trunc);
+                rewrite << HEADER << '\n';
+                records = 0;
+                for (const auto& [day, segments] : days) {
+                    for (const auto& [name, info] : segments) {
+                        rewrite << (info.live ? "open " : "segment ") << day << ' ' << info.size << ' ' << name << '\n';
+                        ++records;
+                    }
+                }
+                for (const auto& archive : pendingUploads) {
+                    rewrite << "upload " << archive << '\n';
+                    ++records;
+                }
+                rewrite.flush();
+                ok = rewrite.good();
+            }
+
+            std::error_code ec;
+            if (ok) {
+                std::filesystem::rename(tmp, path, ec);
+                ok = !ec;
+            }
+            if (!ok) {
+                std::filesystem::remove(tmp, ec);
+            }
+
+            // Em falha o manifesto antigo segue recebendo registros: ao recarregar o resultado é o mesmo
+            out.open(path, std::ios::binary | std::ios::app);
+            return ok && out.is_open();
+        }
+
+        mutable std::mutex mutex;
+        std::string path;
+        std::ofstream out;
+        size_t records = 0;
+
+        std::map<std::string, std::map<std::string, SegmentInfo>> days;    // dia -> nome -> segmento
+        std::unordered_map<std::string, std::string> dayOf;                 // nome -> dia
+        std::set<std::string> pendingUploads;
+    };
+
+} // namespace Manifest
+} // namespace WYD_Server
+
+#endif // __LOGMANIFEST_H__
@@ -0,0 +1,463 @@
+﻿#ifndef __LOGSEGMENT_H__
+#define __LOGSEGMENT_H__
+
+// Formato binário compacto dos segmentos de log (fileFormat=binary).
+// Usado pelo LogSystem para gravar e pela ferramenta logdecode para converter de
+// volta ao texto de sempre.
+//
+// Layout:
+//   Cabeçalho : "LSMB" | u16 versão | u16 flags | u64 baseMicros
+//   Registro  : u8 nível (0..6) | varint delta (zigzag, us) | u32 ip | varint msgId
+//               [varint len | bytes se msgId == 0] | varint extraLen | bytes extra
+//   String    : u8 0xF0 | varint id | varint len | bytes          (define msgId)
+//   Reset     : u8 0xF1 | u64 baseMicros                         (reabertura do arquivo)
+//
+// Inteiros fixos em little-endian. Mensagens repetidas são gravadas uma única vez
+// na tabela de strings do segmento; o Reset limpa a tabela e a base de tempo.
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+
+#include "LogSimd.h"
+
+namespace WYD_Server {
+namespace Segment {
+
+    static constexpr char MAGIC[4] = { 'L', 'S', 'M', 'B' };
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr uint8_t TAG_STRING = 0xF0;
+    static constexpr uint8_t TAG_RESET = 0xF1;
+    static constexpr uint8_t LEVEL_COUNT = 7;
+    static constexpr size_t MAX_INTERNED = 65536;      // Entradas na tabela de strings por segmento
+    static constexpr size_t MAX_INTERNED_LENGTH = 512;  // Mensagens maiores vão sempre literais
+    static constexpr const char* FILE_EXTENSION = ".lsb";
+
+    inline const char* LevelTag(uint8_t level) {
+        static const char* tags[LEVEL_COUNT] = {
+            "[TRACE]", "[DEBUG]", "[INFO]", "[WARN]", "[ERROR]", "[QUEST]", "[PACKETS]"
+        };
+        return level < LEVEL_COUNT ? tags[level] : "[UNKNOWN]";
+    }
+
+    inline void PutVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out += (char)((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += (char)value;
+    }
+
+    inline void PutFixed32(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out += (char)((value >> (8 * i)) & 0xFF);
+    }
+
+    inline void PutFixed64(std::string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out += (char)((value >> (8 * i)) & 0xFF);
+    }
+
+    inline uint64_t ZigZag(int64_t value) {
+        return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    }
+
+    inline int64_t UnZigZag(uint64_t value) {
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    // Fração de segundo do timestamp: digits = 0 (nada), 3 (".mmm") ou 6 (".uuuuuu")
+    inline void AppendStampFraction(std::string& out, uint64_t micros, int digits) {
+        if (digits <= 0) return;
+        uint32_t fraction = (uint32_t)(micros % 1000000);
+        if (digits < 6) fraction /= 1000;
+        char buffer[8];
+        buffer[0] = '.';
+        for (int i = digits; i > 0; --i) {
+            buffer[i] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        out.append(buffer, (size_t)digits + 1);
+    }
+
+    // Escape de msg/extra na linha de texto (messageEscape). Control: \r, \n e \t viram as sequências
+    // de C e os demais controles C0 e o DEL viram \xHH, então nenhum texto de jogador quebra ou forja
+    // uma linha. Utf8: além disso, bytes >= 0x80 fora de uma sequência UTF-8 válida viram \xHH. A
+    // barra invertida não é escapada: o objetivo é a linha íntegra para os parsers, não a reversão.
+    enum class EscapeMode : uint8_t {
+        None,
+        Control,
+        Utf8
+    };
+
+    // Tamanho da sequência UTF-8 válida que começa em p (2 a 4 bytes, sem formas longas, surrogates
+    // ou código acima de U+10FFFF), ou 0
+    inline size_t Utf8SequenceLength(const char* p, const char* end) {
+        unsigned char lead = (unsigned char)p[0];
+        size_t length;
+        if (lead >= 0xC2 && lead <= 0xDF) length = 2;
+        else if (lead >= 0xE0 && lead <= 0xEF) length = 3;
+        else if (lead >= 0xF0 && lead <= 0xF4) length = 4;
+        else return 0;
+
+        if ((size_t)(end - p) < length) {
+            return 0;
+        }
+        uint32_t code = lead & (0x7F >> length);
+        for (size_t i = 1; i < length; ++i) {
+            unsigned char b = (unsigned char)p[i];
+            if ((b & 0xC0) != 0x80) {
+                return 0;
+            }
+            code = (code << 6) | (b & 0x3F);
+        }
+        if (length == 3 && (code < 0x800 || (code >= 0xD800 && code <= 0xDFFF))) {
+            return 0;
+        }
+        if (length == 4 && (code < 0x10000 || code > 0x10FFFF)) {
+            return 0;
+        }
+        return length;
+    }
+
+    // Escreve text escapado por write(const char*, size_t): trechos limpos saem inteiros (achados pelo
+    // Simd::CleanPrefix), sem alocar nada (o dreno de emergência usa com um buffer fixo)
+    template <typename Write>
+    void EscapeText(std::string_view text, EscapeMode mode, Write&& write) {
+        if (mode == EscapeMode::None) {
+            write(text.data(), text.size());
+            return;
+        }
+
+        static constexpr char HEX[] = "0123456789ABCDEF";
+        const bool utf8 = mode == EscapeMode::Utf8;
+        const char* p = text.data();
+        const char* end = p + text.size();
+
+        while (p < end) {
+            size_t clean = Simd::CleanPrefix(p, (size_t)(end - p), utf8);
+            if (clean > 0) {
+                write(p, clean);
+                p += clean;
+                if (p == end) {
+                    break;
+                }
+            }
+
+            unsigned char c = (unsigned char)*p;
+            if (utf8 && c >= 0x80) {
+                size_t length = Utf8SequenceLength(p, end);
+                if (length > 0) {
+                    write(p, length);
+                    p += length;
+                    continue;
+                }
+            }
+
+            char escaped[4] = { '\\', 0, 0, 0 };
+            size_t escapedLength = 2;
+            switch (c) {
+            case '\r': escaped[1] = 'r'; break;
+            case '\n': escaped[1] = 'n'; break;
+            case '\t': escaped[1] = 't'; break;
+            default:
+                escaped[1] = 'x';
+                escaped[2] = HEX[c >> 4];
+                escaped[3] = HEX[c & 0x0F];
+                escapedLength = 4;
+                break;
+            }
+            write(escaped, escapedLength);
+            ++p;
+        }
+    }
+
+    // true se EscapeText devolveria text sem mudanças (só a varredura SIMD no caso comum)
+    inline bool IsClean(std::string_view text, EscapeMode mode) {
+        if (mode == EscapeMode::None) {
+            return true;
+        }
+        const bool utf8 = mode == EscapeMode::Utf8;
+        const char* p = text.data();
+        const char* end = p + text.size();
+        for (;;) {
+            p += Simd::CleanPrefix(p, (size_t)(end - p), utf8);
+            if (p == end) {
+                return true;
+            }
+            size_t length = utf8 ? Utf8SequenceLength(p, end) : 0;
+            if (length == 0) {
+                return false;
+            }
+            p += length;
+        }
+    }
+
+    inline void AppendEscaped(std::string& out, std::string_view text, EscapeMode mode) {
+        EscapeText(text, mode, [&out](const char* data, size_t size) { out.append(data, size); });
+    }
+
+    // Hash transparente: a tabela de strings é consultada com string_view, sem montar std::string
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+    };
+
+    // Codificador de um segmento. Não é thread-safe: usado apenas pelo worker sob fileMutex.
+    class Encoder {
+    public:
+        // Início de um arquivo novo
+        void WriteHeader(uint64_t baseMicros, std::string& out) {
+            out.append(MAGIC, sizeof(MAGIC));
+            out += (char)(VERSION & 0xFF);
+            out += (char)(VERSION >> 8);
+            out += (char)0;
+            out += (char)0;
+            PutFixed64(out, baseMicros);
+            Restart(baseMicros);
+        }
+
+        // Continuação de um arquivo existente (ex.: reinício do servidor no mesmo dia)
+        void WriteReset(uint64_t baseMicros, std::string& out) {
+            out += (char)TAG_RESET;
+            PutFixed64(out, baseMicros);
+            Restart(baseMicros);
+        }
+
+        // intern = false para mensagens que dificilmente se repetem (ex.: já formatadas com argumentos)
+        void Encode(uint8_t level, uint64_t micros, uint32_t ip, std::string_view msg,
+                    std::string_view extra, bool intern, std::string& out) {
+            uint32_t id = 0;
+            if (intern && msg.size() <= MAX_INTERNED_LENGTH) {
+                auto it = strings.find(msg);
+                if (it != strings.end()) {
+                    id = it->second;
+                }
+                else if (strings.size() < MAX_INTERNED) {
+                    id = (uint32_t)strings.size() + 1;
+                    strings.emplace(std::string(msg), id);
+
+                    out += (char)TAG_STRING;
+                    PutVarint(out, id);
+                    PutVarint(out, msg.size());
+                    out.append(msg);
+                }
+            }
+
+            out += (char)level;
+            PutVarint(out, ZigZag((int64_t)(micros - lastMicros)));
+            PutFixed32(out, ip);
+            PutVarint(out, id);
+            if (id == 0) {
+                PutVarint(out, msg.size());
+                out.append(msg);
+            }
+            PutVarint(out, extra.size());
+            out.append(extra);
+
+            lastMicros = micros;
+        }
+
+    private:
+        void Restart(uint64_t baseMicros) {
+            strings.clear();
+            lastMicros = baseMicros;
+        }
+
+        std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> strings;
+        uint64_t lastMicros = 0;
+    };
+
+    // Registro decodificado; as views apontam para o buffer do segmento ou para a tabela de strings
+    struct Record {
+        uint8_t level = 0;
+        uint64_t micros = 0;
+        uint32_t ip = 0;
+        std::string_view message;
+        std::string_view extra;
+    };
+
+    // Decodificador sequencial de um segmento carregado em memória
+    class Decoder {
+    public:
+        Decoder(const char* data, size_t size) : cur(data), end(data + size) {}
+
+        // Valida o cabeçalho; false se o buffer não for um segmento LSMB
+        bool ReadHeader() {
+            if ((size_t)(end - cur) < HEADER_SIZE || memcmp(cur, MAGIC, sizeof(MAGIC)) != 0) {
+                return false;
+            }
+            uint16_t version = (uint16_t)((uint8_t)cur[4] | ((uint8_t)cur[5] << 8));
+            if (version > VERSION) {
+                return false;
+            }
+            cur += 8;
+            Restart(ReadFixed64());
+            return true;
+        }
+
+        // false no fim do buffer ou em dados corrompidos/truncados (ver IsCorrupt)
+        bool Next(Record& rec) {
+            while (cur < end) {
+                uint8_t tag = (uint8_t)*cur++;
+
+                if (tag == TAG_STRING) {
+                    uint64_t id, len;
+                    if (!ReadVarint(id) || !ReadVarint(len) || (uint64_t)(end - cur) < len || id == 0 || id > MAX_INTERNED) {
+                        return Fail();
+                    }
+                    if (strings.size() <= id) strings.resize((size_t)id + 1);
+                    strings[(size_t)id].assign(cur, (size_t)len);
+                    cur += len;
+                    continue;
+                }
+
+                if (tag == TAG_RESET) {
+                    if ((size_t)(end - cur) < 8) return Fail();
+                    Restart(ReadFixed64());
+                    continue;
+                }
+
+                if (tag >= LEVEL_COUNT) {
+                    return Fail();
+                }
+
+                uint64_t delta, id, len;
+                if (!ReadVarint(delta) || (size_t)(end - cur) < 4) return Fail();
+                lastMicros += (uint64_t)UnZigZag(delta);
+                uint32_t ip = ReadFixed32();
+
+                if (!ReadVarint(id)) return Fail();
+                if (id == 0) {
+                    if (!ReadVarint(len) || (uint64_t)(end - cur) < len) return Fail();
+                    rec.message = std::string_view(cur, (size_t)len);
+                    cur += len;
+                }
+                else {
+                    if (id >= strings.size()) return Fail();
+                    rec.message = strings[(size_t)id];
+                }
+
+                if (!ReadVarint(len) || (uint64_t)(end - cur) < len) return Fail();
+                rec.extra = std::string_view(cur, (size_t)len);
+                cur += len;
+
+                rec.level = tag;
+                rec.micros = lastMicros;
+                rec.ip = ip;
+                return true;
+            }
+            return false;
+        }
+
+        bool IsCorrupt() const { return corrupt; }
+        size_t Offset(const char* base) const { return (size_t)(cur - base); }
+
+    private:
+        bool ReadVarint(uint64_t& value) {
+            value = 0;
+            for (int shift = 0; shift < 64 && cur < end; shift += 7) {
+                uint8_t b = (uint8_t)*cur++;
+                value |= (uint64_t)(b & 0x7F) << shift;
+                if (!(b & 0x80)) return true;
+            }
+            return false;
+        }
+
+        uint32_t ReadFixed32() {
+            uint32_t v = 0;
+            for (int i = 0; i < 4; ++i) v |= (uint32_t)(uint8_t)cur[i] << (8 * i);
+            cur += 4;
+            return v;
+        }
+
+        uint64_t ReadFixed64() {
+            uint64_t v = 0;
+            for (int i = 0; i < 8; ++i) v |= (uint64_t)(uint8_t)cur[i] << (8 * i);
+            cur += 8;
+            return v;
+        }
+
+        void Restart(uint64_t baseMicros) {
+            strings.clear();
+            strings.emplace_back();
+            lastMicros = baseMicros;
+        }
+
+        bool Fail() {
+            corrupt = true;
+            cur = end;
+            return false;
+        }
+
+        const char* cur;
+        const char* end;
+        std::vector<std::string> strings;
+        uint64_t lastMicros = 0;
+        bool corrupt = false;
+    };
+
+    // Converte um registro para a linha de texto gravada pelo modo texto:
+    // "[YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] msg [extra] [IP:a.b.c.d]\r\n"
+    // fractionDigits segue o timestampPrecision do LogSystem (0, 3 ou 6); msg/extra passam pelo
+    // EscapeText (segmentos gravados antes do messageEscape também saem com uma linha por registro)
+    class TextRenderer {
+    public:
+        explicit TextRenderer(int fractionDigits = 3, EscapeMode escapeMode = EscapeMode::Control)
+            : digits(fractionDigits), escape(escapeMode) {}
+
+        void Render(const Record& rec, std::string& out) {
+            int64_t second = (int64_t)(rec.micros / 1000000);
+            if (second != cachedSecond) {
+                time_t t = (time_t)second;
+                std::tm tm{};
+#ifdef _WIN32
+                localtime_s(&tm, &t);
+#else
+                localtime_r(&t, &tm);
+#endif
+                cachedStampLength = strftime(cachedStamp, sizeof(cachedStamp), "[%Y-%m-%d %H:%M:%S", &tm);
+                cachedSecond = second;
+            }
+
+            out.append(cachedStamp, cachedStampLength);
+            AppendStampFraction(out, rec.micros, digits);
+            out += "] ";
+            out += LevelTag(rec.level);
+            out += ' ';
+            AppendEscaped(out, rec.message, escape);
+
+            if (!rec.extra.empty()) {
+                out += " [";
+                AppendEscaped(out, rec.extra, escape);
+                out += ']';
+            }
+
+            if (rec.ip != 0) {
+                char ipStr[32];
+                snprintf(ipStr, sizeof(ipStr), " [IP:%u.%u.%u.%u]",
+                    (rec.ip >> 24) & 0xFF, (rec.ip >> 16) & 0xFF, (rec.ip >> 8) & 0xFF, rec.ip & 0xFF);
+                out += ipStr;
+            }
+
+            out += "\r\n";
+        }
+
+    private:
+        int digits;
+        EscapeMode escape;
+        int64_t cachedSecond = -1;
+        char cachedStamp[32] = {};
+        size_t cachedStampLength = 0;
+    };
+
+} // namespace Segment
+} // namespace WYD_Server
+
+#endif // __LOGSEGMENT_H__
@@ -0,0 +1,166 @@
+﻿#ifndef __LOGSIMD_H__
+#define __LOGSIMD_H__
+
+// Rotinas vetorizadas: varredura dos bytes que precisam de escape em msg/extra (caminho quente do
+// Log(), ver Segment::EscapeText) e busca de substring da ferramenta logq.
+// A largura é escolhida em compilação: AVX2 (32 bytes) com /arch:AVX2 ou -mavx2, SSE2 (16 bytes)
+// em qualquer x64, laço escalar nas demais arquiteturas.
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <bit>
+
+#if defined(__AVX2__)
+#define LOGSYSTEM_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOGSYSTEM_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace WYD_Server {
+namespace Simd {
+
+    // Nome da rota compilada (para o benchmark/diagnóstico)
+    inline const char* PathName() {
+#if defined(LOGSYSTEM_SIMD_AVX2)
+        return "AVX2";
+#elif defined(LOGSYSTEM_SIMD_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    // Byte que a linha de texto não pode levar como está: controles C0 e DEL; com highBytes também
+    // qualquer byte >= 0x80 (o chamador decide se ele inicia uma sequência UTF-8 válida)
+    inline bool IsSpecialByte(unsigned char c, bool highBytes) {
+        return c < 0x20 || c == 0x7F || (highBytes && c >= 0x80);
+    }
+
+    // Tamanho do prefixo de [data, data + size) sem nenhum byte especial. Texto limpo (o caso comum)
+    // custa uma comparação com sinal, um cmpeq e um movemask a cada 16/32 bytes: com sinal, "< 0x20"
+    // pega tanto os controles quanto os bytes >= 0x80, que são descartados quando highBytes é false.
+    inline size_t CleanPrefix(const char* data, size_t size, bool highBytes) {
+        size_t i = 0;
+
+#if defined(LOGSYSTEM_SIMD_AVX2)
+        const __m256i space = _mm256_set1_epi8(0x20);
+        const __m256i del = _mm256_set1_epi8(0x7F);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 32 <= size; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+            __m256i below = _mm256_cmpgt_epi8(space, v);
+            if (!highBytes) {
+                below = _mm256_andnot_si256(_mm256_cmpgt_epi8(zero, v), below);
+            }
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(below, _mm256_cmpeq_epi8(v, del)));
+            if (mask) {
+                return i + std::countr_zero(mask);
+            }
+        }
+#elif defined(LOGSYSTEM_SIMD_SSE2)
+        const __m128i space = _mm_set1_epi8(0x20);
+        const __m128i del = _mm_set1_epi8(0x7F);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= size; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i below = _mm_cmplt_epi8(v, space);
+            if (!highBytes) {
+                below = _mm_andnot_si128(_mm_cmplt_epi8(v, zero), below);
+            }
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(below, _mm_cmpeq_epi8(v, del)));
+            if (mask) {
+                return i + std::countr_zero(mask);
+            }
+        }
+#endif
+
+        // Cauda (ou arquitetura sem SIMD)
+        for (; i < size && !IsSpecialByte((unsigned char)data[i], highBytes); ++i) {}
+        return i;
+    }
+
+    // Busca de um texto fixo: compara o primeiro e o último byte do padrão em 16/32 posições por
+    // instrução e só confirma com memcmp os candidatos em que os dois batem. Em log, onde o
+    // primeiro byte sozinho ('[', ' ', dígitos) aparece o tempo todo, isso descarta quase tudo.
+    class Finder {
+    public:
+        explicit Finder(std::string_view pattern) : needle(pattern) {}
+
+        const std::string& Pattern() const { return needle; }
+
+        // Primeira ocorrência em [begin, end), ou nullptr
+        const char* Find(const char* begin, const char* end) const {
+            size_t n = needle.size();
+            if (n == 0) {
+                return begin;
+            }
+            if ((size_t)(end - begin) < n) {
+                return nullptr;
+            }
+            if (n == 1) {
+                return (const char*)memchr(begin, needle[0], (size_t)(end - begin));
+            }
+
+            const char* p = begin;
+            const char* last = end - n;     // Última posição inicial possível
+
+#if defined(LOGSYSTEM_SIMD_AVX2)
+            const __m256i firstByte = _mm256_set1_epi8(needle[0]);
+            const __m256i lastByte = _mm256_set1_epi8(needle[n - 1]);
+            for (; p + 32 <= last + 1; p += 32) {
+                __m256i a = _mm256_loadu_si256((const __m256i*)p);
+                __m256i b = _mm256_loadu_si256((const __m256i*)(p + n - 1));
+                uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(a, firstByte), _mm256_cmpeq_epi8(b, lastByte)));
+                while (mask) {
+                    const char* candidate = p + std::countr_zero(mask);
+                    if (memcmp(candidate + 1, needle.data() + 1, n - 2) == 0) {
+                        return candidate;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+#elif defined(LOGSYSTEM_SIMD_SSE2)
+            const __m128i firstByte = _mm_set1_epi8(needle[0]);
+            const __m128i lastByte = _mm_set1_epi8(needle[n - 1]);
+            for (; p + 16 <= last + 1; p += 16) {
+                __m128i a = _mm_loadu_si128((const __m128i*)p);
+                __m128i b = _mm_loadu_si128((const __m128i*)(p + n - 1));
+                uint32_t mask = (uint32_t)_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(a, firstByte), _mm_cmpeq_epi8(b, lastByte)));
+                while (mask) {
+                    const char* candidate = p + std::countr_zero(mask);
+                    if (memcmp(candidate + 1, needle.data() + 1, n - 2) == 0) {
+                        return candidate;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+#endif
+
+            // Cauda (ou arquitetura sem SIMD)
+            for (; p <= last; ++p) {
+                p = (const char*)memchr(p, needle[0], (size_t)(last - p) + 1);
+                if (!p) {
+                    return nullptr;
+                }
+                if (p[n - 1] == needle[n - 1] && memcmp(p + 1, needle.data() + 1, n - 2) == 0) {
+                    return p;
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        std::string needle;
+    };
+
+} // namespace Simd
+} // namespace WYD_Server
+
+#endif // __LOGSIMD_H__
@@ -3,7 +3,74 @@
 using namespace WYD_Server;
 namespace fs = std::filesystem;
 
-LogSystem::LogSystem() : stopWorker(false), maxRichEditLines(10000), headlessMode(false), asyncLogging(true) {
+namespace {
+    std::atomic<uint64_t> nextInstanceId{1};
+
+    // Anéis da thread atual, um por instância de LogSystem.
+    // O destrutor roda quando a thread termina e marca os anéis como órfãos.
+    struct ThreadRingCache {
+        struct Entry {
+            uint64_t instanceId;
+            std::shared_ptr<ProducerRing> ring;
+        };
+        std::vector<Entry> entries;
+        uint64_t lastInstance = 0;
+        ProducerRing* lastRing = nullptr;
+
+        ~ThreadRingCache() {
+            for (auto& e : entries) {
+                e.ring->orphaned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    thread_local ThreadRingCache threadRings;
+
+    // Gravadores de voo da thread atual, um por instância de LogSystem; liberados para reuso quando a thread termina
+    struct ThreadFlightCache {
+        struct Entry {
+            uint64_t instanceId;
+            std::shared_ptr<FlightRecorderRing> ring;
+        };
+        std::vector<Entry> entries;
+
+        ~ThreadFlightCache() {
+            for (auto& e : entries) {
+                e.ring->orphaned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    thread_local ThreadFlightCache threadFlight;
+
+    // Instância drenada pelos handlers de crash (InstallCrashHandler); handlers anteriores são encadeados
+    std::atomic<LogSystem*> crashTarget{nullptr};
+    LPTOP_LEVEL_EXCEPTION_FILTER previousExceptionFilter = nullptr;
+    void (*previousAbortHandler)(int) = SIG_DFL;
+
+    LONG WINAPI CrashExceptionFilter(EXCEPTION_POINTERS* info) {
+        if (LogSystem* target = crashTarget.load(std::memory_order_acquire)) {
+            target->EmergencyDrain();
+        }
+        return previousExceptionFilter ? previousExceptionFilter(info) : EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    // abort() (inclusive std::terminate): drena e devolve o sinal ao handler anterior
+    void CrashAbortHandler(int sig) {
+        if (LogSystem* target = crashTarget.load(std::memory_order_acquire)) {
+            target->EmergencyDrain();
+        }
+        signal(sig, previousAbortHandler != SIG_ERR ? previousAbortHandler : SIG_DFL);
+        raise(sig);
+    }
+
+    void DetachCrashHandler(LogSystem* instance) {
+        crashTarget.compare_exchange_strong(instance, nullptr, std::memory_order_acq_rel);
+    }
+}
+
+LogSystem::LogSystem() : stopWorker(false), maxRichEditLines(10000), headlessMode(false), asyncLogging(true),
+    queueMode(QueueMode::PerThread), instanceId(nextInstanceId.fetch_add(1, std::memory_order_relaxed)) {
     try {
         routing[(int)LogLevel::Trace] = TargetSide::Left;
         routing[(int)LogLevel::Debug] = TargetSide::Left;
@@ -37,10 +104,20 @@ LogSystem::LogSystem() : stopWorker(false), maxRichEditLines(10000), headlessMod
         logDir = "Log";
         fs::create_directories(logDir);
 
+        // Sinks internos: arquivo (não perde mensagens, espera espaço) e as duas janelas
+        // (descartam as linhas mais antigas se a interface não acompanhar)
+        fileChannel = std::make_shared<SinkChannel>(std::make_shared<FileSink>(*this), 0, SinkOverflowPolicy::Block);
+        for (int i = 0; i < TARGET_COUNT; ++i) {
+            displaySinks[i] = std::make_shared<RichEditSink>(*this, (TargetSide)i);
+            displayChannels[i] = std::make_shared<SinkChannel>(displaySinks[i], 0, SinkOverflowPolicy::DropOldest);
+        }
+        sinkList = std::make_shared<const SinkList>(SinkList{ fileChannel, displayChannels[0], displayChannels[1] });
+
         Initialize();
 
         // Iniciar thread worker para async logging
         if (asyncLogging) {
+            StartSinks();
             workerThread = std::thread(&LogSystem::WorkerThreadFunc, this);
         }
     }
@@ -54,19 +131,30 @@ LogSystem::LogSystem() : stopWorker(false), maxRichEditLines(10000), headlessMod
 
 LogSystem::~LogSystem() {
     try {
+        DetachCrashHandler(this);
         Shutdown();
-        if (logFile.is_open()) 
-            logFile.close();
+        std::lock_guard<std::mutex> lock(fileMutex);
+        CloseLogFile();
+        DiscardPreparedSegment();
     }
     catch (...) { }
 }
 
 void LogSystem::Shutdown() {
+    // Compactações em andamento são interrompidas (os arquivos ficam para a próxima limpeza);
+    // parar antes do worker deixa os logs das tarefas chegarem ao arquivo
+    maintenance.Stop();
+    uploads.Stop();     // Envio interrompido continua do .part no próximo Initialize
+
     if (asyncLogging && workerThread.joinable()) {
         stopWorker.store(true, std::memory_order_release);
             
-        // Wake up worker thread if sleeping
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // Wake up worker thread if parked
+        {
+            std::lock_guard<std::mutex> lock(parkMutex);
+            workerParked.store(false, std::memory_order_relaxed);
+        }
+        queueCV.notify_one();
             
         // Wait for worker to finish (max 5 seconds)
         auto start = std::chrono::steady_clock::now();
@@ -85,22 +173,53 @@ void LogSystem::Shutdown() {
         }
     }
         
+    // O worker já entregou tudo aos sinks; cada sink grava o que restou na própria fila
+    StopSinks();
+
     // Final flush
-    if (logFile.is_open()) {
-        logFile.flush();
+    FlushPendingWrites(true);
+
+    if (flightRecorderEnabled.load(std::memory_order_relaxed)) {
+        DumpFlightRings(true, "Shutdown");
     }
 }
 
 void LogSystem::Initialize() {
 	LoadConfig("logconfig.ini");
+
+    // Antes do primeiro segmento: sem manifesto (primeira execução) o diretório é varrido uma vez
+    if (!manifest.Load(logDir)) {
+        Warning("Falha ao gravar o manifesto de segmentos em " + logDir);
+    }
 	OpenLogFile();
+
+    int threads = maintenanceThreads;
+    if (threads <= 0) {
+        // Automático: metade dos núcleos, no máximo 4, para não disputar CPU com o servidor
+        threads = (std::clamp)((int)std::thread::hardware_concurrency() / 2, 1, 4);
+    }
+    maintenance.Start(threads, maintenanceLowPriority);
+    StartUploads();
 	CleanupOldLogs();
+
+    if (crashHandler) {
+        InstallCrashHandler();
+    }
 }
 
 void LogSystem::SetTarget(TargetSide side, HWND editHandle) {
     try {
         std::lock_guard<std::mutex> lock(targetMutex);
         targets[(int)side] = editHandle;
+        displaySinks[(int)side]->RequestReset();
+
+        // Níveis roteados para esta janela, se configurada
+        uint32_t mask = 0;
+        for (int i = 0; i < LOG_LEVEL_COUNT; ++i) {
+            if (editHandle && routing[i] == side) mask |= LevelBit((LogLevel)i);
+        }
+        targetLevelMask[(int)side].store(mask, std::memory_order_relaxed);
+        UpdateActiveLevels();
 
         if (!editHandle) {
             Warning("SetTarget chamado com handle nulo");
@@ -120,9 +239,13 @@ void LogSystem::SetTarget(TargetSide side, HWND editHandle) {
     }
 }
 
+// Aplicado pelos sinks das janelas no próximo Flush
 void LogSystem::SetMaxRichEditLines(int maxLines) {
-    std::lock_guard<std::mutex> lock(targetMutex);
-    maxRichEditLines = maxLines;
+    maxRichEditLines.store((std::max)(maxLines, 1), std::memory_order_relaxed);
+}
+
+void LogSystem::SetDisplayFps(int fps) {
+    displayFps.store((std::clamp)(fps, 1, 240), std::memory_order_relaxed);
 }
 
 void LogSystem::ClearRichEdit(TargetSide side) {
@@ -133,369 +256,2114 @@ void LogSystem::ClearRichEdit(TargetSide side) {
         SetWindowTextA(target, "");
         SendMessageA(target, EM_SETREADONLY, TRUE, 0);
     }
+    displaySinks[(int)side]->RequestReset();
 }
 
 // =======================
 // Thread worker para processamento assíncrono - agora com lock-free queue
 // =======================
 void LogSystem::WorkerThreadFunc() {
-    LogMessage msg;
-        
+    std::vector<LogMessage> batch;
+    batch.reserve(WORKER_DRAIN_BATCH * 4);
+    std::vector<std::shared_ptr<ProducerRing>> rings;
+    uint64_t knownVersion = ~0ull;
+    auto nextStatsRefresh = std::chrono::steady_clock::now();
+    int idleRounds = 0;
+    std::shared_ptr<const SinkList> sinks;
+    uint64_t knownSinksVersion = ~0ull;
+
     while (!stopWorker.load(std::memory_order_acquire)) {
-        bool processedAny = false;
-            
-        // Try lock-free queue first
-        while (lockFreeQueue.TryPop(msg)) {
-            ProcessLogMessage(msg);
-            processedAny = true;
-                
-            // Update queue peak
-            size_t currentSize = lockFreeQueue.Size();
-            uint64_t peak = stats.queuePeak.load(std::memory_order_relaxed);
-            while (currentSize > peak && 
-                    !stats.queuePeak.compare_exchange_weak(peak, currentSize, std::memory_order_relaxed));
-                
-            // Check stop flag periodically
-            if (stopWorker.load(std::memory_order_acquire)) {
-                break;
+        if (crashHalt.load(std::memory_order_acquire)) {
+            HaltWorkerForCrash(batch, 0);
+            return;
+        }
+
+        // Cópia da lista de sinks só quando AddSink/RemoveSink a trocam
+        uint64_t currentSinksVersion = sinksVersion.load(std::memory_order_acquire);
+        if (currentSinksVersion != knownSinksVersion) {
+            sinks = GetSinkList();
+            knownSinksVersion = currentSinksVersion;
+        }
+
+        // Atualiza a cópia local do registro de anéis quando algo muda
+        uint64_t version = ringsVersion.load(std::memory_order_acquire);
+        if (version != knownVersion) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings = producerRings;
+            knownVersion = version;
+        }
+
+        size_t drained = DrainQueues(rings, batch);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (crashHalt.load(std::memory_order_acquire)) {
+                HaltWorkerForCrash(batch, i);
+                return;
             }
+            ProcessLogMessage(batch[i], *sinks);
         }
-            
-        // Sleep briefly if queue empty and not stopping
-        if (!processedAny && !stopWorker.load(std::memory_order_acquire)) {
-            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        batch.clear();
+
+        // Error com gravador de voo: o despejo vai para o MaintenancePool, não fica na thread do jogo
+        if (flightDumpPending.load(std::memory_order_relaxed)) {
+            PostFlightDump();
         }
-    }
 
-    // Processar mensagens restantes antes de sair (max 100ms)
-    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
-    while (lockFreeQueue.TryPop(msg) && std::chrono::steady_clock::now() < deadline) {
-        ProcessLogMessage(msg);
-    }
-        
-    // Final flush do arquivo
-    if (logFile.is_open()) {
-        logFile.flush();
-    }
-}
+        ReclaimProducerRings(rings);
 
-void LogSystem::ProcessLogMessage(const LogMessage& msg) {
-    TargetSide side = routing[(int)msg.level];
-        
-    {
-        std::lock_guard<std::mutex> lock(targetMutex);
-        HWND target = targets[(int)side];
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextStatsRefresh) {
+            PublishRingStats(rings);
+            nextStatsRefresh = now + std::chrono::milliseconds(100);
+        }
 
-        if (target && IsWindow(target) && !headlessMode) {
-            AppendColoredText(target, msg.fullText, GetColor(msg.level));
-            TrimRichEdit(target);
+        if (drained > 0) {
+            idleRounds = 0;
+        }
+        else if (!stopWorker.load(std::memory_order_acquire)) {
+            WaitForMessages(rings, knownVersion, idleRounds);
         }
     }
 
-    // Rotação de arquivo por data
-    std::string today = GetDate();
-    if (today != currentDate) {
-        std::lock_guard<std::mutex> lock(fileMutex);
-        if (today != currentDate) {  // Double-check após adquirir lock
-            currentDate = today;
-            fileIndex = 1;  // Reset index quando muda o dia
-            OpenLogFile();
-            CleanupOldLogs();
+    // Processar mensagens restantes antes de sair (max 100ms)
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings = producerRings;
+    }
+    sinks = GetSinkList();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    for (;;) {
+        size_t drained = DrainQueues(rings, batch);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (crashHalt.load(std::memory_order_acquire)) {
+                HaltWorkerForCrash(batch, i);
+                return;
+            }
+            ProcessLogMessage(batch[i], *sinks);
+        }
+        batch.clear();
+        if (drained == 0 || std::chrono::steady_clock::now() >= deadline) {
+            break;
         }
     }
 
-    // Saída para arquivo
-    if (fileLevels.find(msg.level) != fileLevels.end()) {
-        std::lock_guard<std::mutex> lock(fileMutex);
-        WriteToFile(msg.fullText);
+    // Prazo esgotado com anéis ainda cheios: o que o merge retinha sai em ordem mesmo assim
+    for (auto& msg : mergePending) {
+        ProcessLogMessage(msg, *sinks);
     }
+    mergePending.clear();
+    PublishRingStats(rings);
 }
 
-void LogSystem::TrimRichEdit(HWND target) {
-    if (!target || !IsWindow(target)) return;
+// =======================
+// Dreno de emergência em andamento: o worker publica o lote que não chegou a processar e
+// não toca mais nas filas; só sai depois do dreno (que lê o lote no lugar) e quando o Shutdown pedir
+// =======================
+void LogSystem::HaltWorkerForCrash(const std::vector<LogMessage>& batch, size_t from) {
+    haltedBatch = &batch;
+    haltedFrom = from;
+    workerHalted.store(true, std::memory_order_release);
 
-    int lineCount = (int)SendMessageA(target, EM_GETLINECOUNT, 0, 0);
-        
-    if (lineCount > maxRichEditLines) {
-        int linesToDelete = lineCount - maxRichEditLines;
-        int charIndex = (int)SendMessageA(target, EM_LINEINDEX, linesToDelete, 0);
-            
-        SendMessageA(target, EM_SETREADONLY, FALSE, 0);
-        SendMessageA(target, EM_SETSEL, 0, charIndex);
-        SendMessageA(target, EM_REPLACESEL, FALSE, (LPARAM)"");
-        SendMessageA(target, EM_SETREADONLY, TRUE, 0);
+    while (crashHalt.load(std::memory_order_acquire) || !stopWorker.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WORKER_PARK_TIMEOUT_MS));
     }
 }
 
 // =======================
-// Função única de log - agora com otimizações de performance
+// Espera adaptativa do worker quando não há mensagens: primeiro spin (rajadas curtas
+// são atendidas sem trocar de contexto), depois yield e por fim estaciona na queueCV
+// até um produtor sinalizar ou WORKER_PARK_TIMEOUT_MS expirar
 // =======================
-void LogSystem::Log(LogLevel level, const std::string& msg, const std::string& extra, unsigned int ip) {
-    std::string prefix = LevelToString(level);
-    std::string timestamp = timestampCache.Get(); // Use cached timestamp
+void LogSystem::WaitForMessages(const std::vector<std::shared_ptr<ProducerRing>>& rings, uint64_t knownVersion, int& idleRounds) {
+    ++idleRounds;
 
-    // Use string pool to reduce allocations
-    std::string* poolStr = stringPool.Acquire();
-    std::stringstream ss;
-    ss << timestamp << " " << prefix << " " << msg;
+    if (idleRounds <= WORKER_SPIN_COUNT) {
+        YieldProcessor();
+        return;
+    }
 
-    if (!extra.empty()) {
-        ss << " [" << extra << "]";
+    if (idleRounds <= WORKER_SPIN_COUNT + WORKER_YIELD_COUNT) {
+        std::this_thread::yield();
+        return;
     }
 
-    if (ip != 0) {
-        char ipStr[32];
-        sprintf_s(ipStr, "%u.%u.%u.%u",
-            (ip >> 24) & 0xFF,
-            (ip >> 16) & 0xFF,
-            (ip >> 8) & 0xFF,
-            ip & 0xFF
-        );
-        ss << " [IP:" << ipStr << "]";
+    std::unique_lock<std::mutex> lock(parkMutex);
+    workerParked.store(true, std::memory_order_relaxed);
+
+    // Par do fence em Submit: ou o produtor vê workerParked == true e sinaliza,
+    // ou esta verificação vê a mensagem publicada por ele
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!HasPendingMessages(rings, knownVersion) && !stopWorker.load(std::memory_order_acquire)) {
+        stats.workerParks.fetch_add(1, std::memory_order_relaxed);
+        queueCV.wait_for(lock, std::chrono::milliseconds(WORKER_PARK_TIMEOUT_MS), [this] {
+            return !workerParked.load(std::memory_order_relaxed);
+        });
     }
 
-    *poolStr = ss.str();
-    std::string fullMsg = *poolStr;
-    stringPool.Release(poolStr);
-        
-    // Record statistics
-    stats.RecordLog(level, fullMsg.size());
+    workerParked.store(false, std::memory_order_relaxed);
+    idleRounds = 0;
+}
 
-    if (asyncLogging) {
-        LogMessage logMsg;
-        logMsg.level = level;
-        logMsg.message = msg;
-        logMsg.extra = extra;
-        logMsg.ip = ip;
-        logMsg.timestamp = timestamp;
-        logMsg.fullText = fullMsg + "\r\n";
-
-        // Try lock-free queue first
-        if (!lockFreeQueue.TryPush(std::move(logMsg))) {
-            // Queue full, record stat and process synchronously
-            stats.queueFull.fetch_add(1, std::memory_order_relaxed);
-            ProcessLogMessage(logMsg);
-        }
+bool LogSystem::HasPendingMessages(const std::vector<std::shared_ptr<ProducerRing>>& rings, uint64_t knownVersion) const {
+    if (!lockFreeQueue.IsEmpty() || ringsVersion.load(std::memory_order_acquire) != knownVersion) {
+        return true;
     }
-    else {
-        // Modo síncrono (fallback)
-        LogMessage logMsg;
-        logMsg.level = level;
-        logMsg.fullText = fullMsg + "\r\n";
-        ProcessLogMessage(logMsg);
+
+    for (const auto& producer : rings) {
+        if (producer->ring.Size() > 0) return true;
     }
+    return false;
 }
 
-// =======================
-// Funções para habilitar/desabilitar níveis de log para arquivo
-// =======================
-void LogSystem::EnableFileLevel(LogLevel level) { 
-    std::lock_guard<std::mutex> lock(logMutex);
-    fileLevels.insert(level); 
-}
-    
-void LogSystem::DisableFileLevel(LogLevel level) { 
-    std::lock_guard<std::mutex> lock(logMutex);
-    fileLevels.erase(level); 
+// Chamado por produtores apenas quando o worker está estacionado
+void LogSystem::WakeWorker() {
+    if (!workerParked.exchange(false, std::memory_order_relaxed)) {
+        return;  // Outro produtor já sinalizou
+    }
+
+    {
+        // Sincroniza com o predicado da wait_for para não perder o sinal
+        std::lock_guard<std::mutex> lock(parkMutex);
+    }
+    queueCV.notify_one();
+    stats.workerWakeups.fetch_add(1, std::memory_order_relaxed);
 }
 
 // =======================
-// Função para abrir o arquivo de log com base na data atual e índice de rotação
+// Coleta uma passada da fila compartilhada e de todos os anéis por thread e entrega em batch,
+// em ordem de tick, só o que nenhuma fila ainda pode anteceder (merge k-way entre passadas).
+// Uma fila cortada em WORKER_DRAIN_BATCH ainda tem mensagens a partir do último tick lido dela;
+// o que passa do menor desses ticks fica em mergePending até a próxima passada.
+// Retorna quantas mensagens saíram das filas.
 // =======================
-void LogSystem::OpenLogFile() {
-    currentDate = GetDate();
-    std::string filename = logDir + "/server_" + currentDate + "_" + std::to_string(fileIndex) + ".log";
+size_t LogSystem::DrainQueues(std::vector<std::shared_ptr<ProducerRing>>& rings, std::vector<LogMessage>& batch) {
+    const size_t held = mergePending.size();
+    uint64_t releaseTick = UINT64_MAX;
+    LogMessage msg;
 
-    if (logFile.is_open()) logFile.close();
-    logFile.open(filename, std::ios::app);
-        
-    if (!logFile.is_open()) {
-        // Tentar criar diretório se não existir
-        fs::create_directories(logDir);
-        logFile.open(filename, std::ios::app);
+    auto drain = [&](auto& queue) {
+        size_t depth = queue.Size();
+        if (depth == 0) return;
+        stats.UpdatePeak(depth);
+
+        size_t count = 0;
+        while (count < WORKER_DRAIN_BATCH && queue.TryPop(msg)) {
+            mergePending.push_back(std::move(msg));
+            ++count;
+        }
+        if (count == WORKER_DRAIN_BATCH) {
+            releaseTick = (std::min)(releaseTick, mergePending.back().tick);
+        }
+    };
+
+    drain(lockFreeQueue);
+    for (auto& producer : rings) {
+        drain(producer->ring);
+    }
+
+    auto byTick = [](const LogMessage& a, const LogMessage& b) { return a.tick < b.tick; };
+    size_t drained = mergePending.size() - held;
+    if (drained > 0) {
+        // Cada anel já está em ordem; a ordenação intercala as threads com o que ficou retido
+        std::stable_sort(mergePending.begin() + held, mergePending.end(), byTick);
+        if (held > 0) {
+            std::inplace_merge(mergePending.begin(), mergePending.begin() + held, mergePending.end(), byTick);
+        }
+    }
+
+    auto release = mergePending.end();
+    if (releaseTick != UINT64_MAX) {
+        release = std::upper_bound(mergePending.begin(), mergePending.end(), releaseTick,
+            [](uint64_t tick, const LogMessage& m) { return tick < m.tick; });
     }
+    std::move(mergePending.begin(), release, std::back_inserter(batch));
+    mergePending.erase(mergePending.begin(), release);
+
+    return drained;
 }
 
 // =======================
-// Função para fazer a limpeza e compactação dos logs antigos podendo enviar para FTP
+// Remove do registro os anéis de threads que já terminaram, depois de vazios
 // =======================
-void LogSystem::CleanupOldLogs() {
-    try {
-        auto now = std::chrono::system_clock::now();
-        std::map<std::string, std::vector<std::string>> filesByDay;
+void LogSystem::ReclaimProducerRings(std::vector<std::shared_ptr<ProducerRing>>& rings) {
+    bool anyReclaimable = false;
+    for (const auto& producer : rings) {
+        if (producer->orphaned.load(std::memory_order_acquire) && producer->ring.IsEmpty()) {
+            anyReclaimable = true;
+            break;
+        }
+    }
+    if (!anyReclaimable) return;
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    auto it = std::remove_if(producerRings.begin(), producerRings.end(), [](const std::shared_ptr<ProducerRing>& producer) {
+        return producer->orphaned.load(std::memory_order_acquire) && producer->ring.IsEmpty();
+    });
+    size_t reclaimed = (size_t)std::distance(it, producerRings.end());
+
+    // Some da tabela do dreno de emergência antes de o anel ser destruído
+    for (auto r = it; r != producerRings.end(); ++r) {
+        size_t count = drainRingCount.load(std::memory_order_relaxed);
+        for (size_t slot = 0; slot < count; ++slot) {
+            if (drainRings[slot].load(std::memory_order_relaxed) == r->get()) {
+                drainRings[slot].store(nullptr, std::memory_order_release);
+                break;
+            }
+        }
+    }
+    producerRings.erase(it, producerRings.end());
 
-        for (const auto& entry : fs::directory_iterator(logDir)) {
-            if (!fs::is_regular_file(entry.path())) continue;
+    stats.ringsReclaimed.fetch_add(reclaimed, std::memory_order_relaxed);
+    ringsVersion.fetch_add(1, std::memory_order_release);
+    rings = producerRings;
+}
 
-            auto name = entry.path().filename().string();
-                
-            // Corrigir regex para corresponder ao formato real: server_YYYY-MM-DD_X.log
-            std::regex re(R"(server_(\d{4}-\d{2}-\d{2})_\d+\.log)");
-            std::smatch match;
-                
-            if (std::regex_match(name, match, re)) {
-                std::string dayStr = match[1].str();
+void LogSystem::PublishRingStats(const std::vector<std::shared_ptr<ProducerRing>>& rings) {
+    std::vector<RingStats> snapshot;
+    snapshot.reserve(rings.size());
+
+    for (const auto& producer : rings) {
+        RingStats rs;
+        rs.threadId = producer->threadId;
+        rs.depth = producer->ring.Size();
+        rs.capacity = producer->ring.GetCapacity();
+        rs.pushed = producer->pushed.load(std::memory_order_relaxed);
+        rs.drops = producer->drops.load(std::memory_order_relaxed);
+        rs.orphaned = producer->orphaned.load(std::memory_order_relaxed);
+        snapshot.push_back(rs);
+    }
 
-                std::tm tm = {};
-                int year, month, day;
-                if (sscanf_s(dayStr.c_str(), "%d-%d-%d", &year, &month, &day) != 3) {
-                    Warning("Falha ao parsear data do arquivo: " + name);
-                    continue;
-                }
-                    
-                tm.tm_year = year - 1900;
-                tm.tm_mon = month - 1;
-                tm.tm_mday = day;
-                    
-                auto fileDate = std::chrono::system_clock::from_time_t(std::mktime(&tm));
-                auto ageDays = std::chrono::duration_cast<std::chrono::hours>(now - fileDate).count() / 24;
-
-                if (ageDays >= retentionDays) {
-                    filesByDay[dayStr].push_back(entry.path().string());
-                }
+    stats.UpdateRingStats(std::move(snapshot));
+}
+
+// =======================
+// Anel da thread atual (registrado na primeira chamada)
+// =======================
+std::shared_ptr<ProducerRing> LogSystem::RegisterProducerRing() {
+    auto producer = std::make_shared<ProducerRing>();
+    producer->threadId = GetCurrentThreadId();
+
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        producerRings.push_back(producer);
+
+        // Slot livre na tabela do dreno de emergência; além de CRASH_DRAIN_RINGS o anel fica de fora
+        size_t count = drainRingCount.load(std::memory_order_relaxed);
+        size_t slot = 0;
+        while (slot < count && drainRings[slot].load(std::memory_order_relaxed) != nullptr) {
+            ++slot;
+        }
+        if (slot < CRASH_DRAIN_RINGS) {
+            drainRings[slot].store(producer.get(), std::memory_order_release);
+            if (slot == count) {
+                drainRingCount.store(count + 1, std::memory_order_release);
             }
         }
+    }
+    ringsVersion.fetch_add(1, std::memory_order_release);
+    stats.ringsRegistered.fetch_add(1, std::memory_order_relaxed);
 
-        for (auto& [day, files] : filesByDay) {
-            if (compressMode == "none") {
-                // Apenas deletar arquivos antigos
-                for (auto& f : files) {
-                    try {
-                        fs::remove(f);
-                        Info("Arquivo excluído: " + f);
-                    }
-                    catch (const std::exception& e) {
-                        Error("Falha ao excluir arquivo: " + f + " - " + e.what());
-                    }
-                }
-            }
-            else if (compressMode == "file") {
-                // Compactar cada arquivo individualmente
-                for (auto& f : files) {
-                    if (CompressFile(f)) {
-                        stats.compressionCount.fetch_add(1, std::memory_order_relaxed);
-                        Info("Compactação concluída: " + f + ".zip");
-                        try {
-                            fs::remove(f);
-                            Info("Arquivo excluído após compactação: " + f);
-                        }
-                        catch (const std::exception& e) {
-                            Error("Falha ao excluir arquivo: " + f + " - " + e.what());
-                        }
-
-                        if (uploadBackup) {
-                            std::string localZip = f + ".zip";
-                            std::string remoteZip = ftpPath + fs::path(localZip).filename().string();
-                            if (UploadToFTP(localZip, ftpServer, ftpUser, ftpPass, remoteZip)) {
-                                Info("Upload concluído para FTP: " + remoteZip);
-                            }
-                            else {
-                                Error("Falha no upload para FTP: " + remoteZip);
-                            }
-                        }
-                    }
-                }
-            }
-            else if (compressMode == "day") {
-                // Compactar todos os arquivos do dia em um único ZIP
-                Info("Iniciando compactação dos logs do dia " + day);
-
-                if (CompressDayLogs(day, files)) {
-                    stats.compressionCount.fetch_add(1, std::memory_order_relaxed);
-                    Info("Compactação concluída: logpack_" + day + ".zip");
-
-                    for (auto& f : files) {
-                        try {
-                            fs::remove(f);
-                            Info("Arquivo excluído após compactação: " + f);
-                        }
-                        catch (const std::exception& e) {
-                            Error("Falha ao excluir arquivo: " + f + " - " + e.what());
-                        }
-                    }
+    return producer;
+}
 
-                    if (uploadBackup) {
-                        std::string localZip = logDir + "/logpack_" + day + ".zip";
-                        std::string remoteZip = ftpPath + "logpack_" + day + ".zip";
+bool LogSystem::PushToProducerRing(LogMessage&& msg) {
+    ProducerRing* producer = nullptr;
 
-                        if (UploadToFTP(localZip, ftpServer, ftpUser, ftpPass, remoteZip)) {
-                            Info("Upload concluído para FTP: " + remoteZip);
-                        }
-                        else {
-                            Error("Falha no upload para FTP: " + remoteZip);
-                        }
-                    }
-                }
-                else {
-                    Error("Falha ao compactar logs do dia " + day);
-                }
+    if (threadRings.lastInstance == instanceId) {
+        producer = threadRings.lastRing;
+    }
+    else {
+        for (auto& e : threadRings.entries) {
+            if (e.instanceId == instanceId) {
+                producer = e.ring.get();
+                break;
             }
         }
+        if (!producer) {
+            auto ring = RegisterProducerRing();
+            producer = ring.get();
+            threadRings.entries.push_back({ instanceId, std::move(ring) });
+        }
+        threadRings.lastInstance = instanceId;
+        threadRings.lastRing = producer;
     }
-    catch (const std::exception& e) {
-        Error("Exceção em CleanupOldLogs: " + std::string(e.what()));
+
+    if (!producer->ring.TryPush(std::move(msg))) {
+        producer->drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
     }
+
+    producer->pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
 // =======================
-// Função para carregar as configurações do arquivo INI de log se nao existir cria um novo
+// Entrega a mensagem aos sinks que aceitam o nível. O texto é montado uma única vez
+// (se algum sink precisar) e o LogMessage é compartilhado entre as filas dos sinks.
 // =======================
-void LogSystem::LoadConfig(const std::string& filename) {
-    try {
-        fs::path configDir = fs::current_path() / "Config";
-        if (!fs::exists(configDir)) {
-            fs::create_directory(configDir);
+void LogSystem::ProcessLogMessage(LogMessage& msg, const SinkList& sinks) {
+    // Mantém a base de hora de parede do relógio em dia (no máximo uma vez por segundo)
+    clock.CalibrateIfDue(msg.tick);
+
+    bool needsText = false;
+    for (const auto& channel : sinks) {
+        if (channel->Accepts(msg.level) && channel->GetSink().NeedsText()) {
+            needsText = true;
+            break;
         }
+    }
 
-        fs::path configFile = configDir / filename;
-        if (!fs::exists(configFile)) {
-            std::ofstream ini(configFile);
-            if (!ini.is_open()) {
-                Error("Não foi possível criar o arquivo de configuração: " + configFile.string());
-                return;
+    if (needsText && msg.fullText.empty()) {
+        RenderLogMessage(msg);
+    }
+    else if (msg.fullText.empty() && !fileChannel->Accepts(msg.level)) {
+        stats.RecordLog(msg.level, 0);  // Segmento binário contabiliza em WriteBinaryRecord
+    }
+
+    std::shared_ptr<const LogMessage> shared;
+    for (const auto& channel : sinks) {
+        if (!channel->Accepts(msg.level)) {
+            continue;
+        }
+
+        if (channel->IsRunning()) {
+            if (!shared) {
+                shared = std::make_shared<const LogMessage>(std::move(msg));
             }
+            channel->Push(shared);
+        }
+        else {
+            channel->WriteInline(shared ? *shared : msg);
+        }
+    }
+}
 
-            ini << "[Log]\n";
-            ini << "# Quantos dias os arquivos de log devem ser mantidos antes de serem compactados/excluídos\n";
-            ini << "retentionDays=7\n\n";
+// =======================
+// Sink de arquivo: troca de dia, rotação e escrita no formato configurado
+// =======================
+void LogSystem::WriteFileRecord(const LogMessage& msg) {
+    std::lock_guard<std::mutex> lock(fileMutex);
 
-            ini << "# Tamanho máximo (em bytes) de cada arquivo de log antes de rotacionar\n";
-            ini << "# Exemplo: 1048576 = 1 MB, 5242880 = 5 MB\n";
-            ini << "maxLogSize=1048576\n\n";
+    // Rotação de arquivo por data: compara o tick da mensagem com a próxima meia-noite
+    // pré-calculada em vez de formatar a data a cada mensagem
+    if (msg.tick >= nextMidnightTick.load(std::memory_order_relaxed)) {
+        fileIndex = 1;  // Reset index quando muda o dia
+        OpenLogFile();
+        CleanupOldLogs();
+    }
 
-            ini << "# Modo de compressão dos logs antigos:\n";
-            ini << "# none = não compacta, apenas deleta\n";
-            ini << "# file = compacta cada arquivo individualmente\n";
-            ini << "# day  = compacta todos os arquivos de um mesmo dia em um único .zip\n";
-            ini << "compressMode=day\n\n";
+    if (fileFormat.load(std::memory_order_relaxed) == FileFormat::Binary) {
+        WriteBinaryRecord(msg);
+    }
+    else if (!msg.fullText.empty()) {
+        WriteToFile(msg.fullText, msg.tick, msg.level, msg.ip);
+    }
+    else {
+        // Formato trocado por LoadConfig depois do despacho: a mensagem veio sem texto
+        LogMessage rendered = msg;
+        RenderLogMessage(rendered);
+        WriteToFile(rendered.fullText, msg.tick, msg.level, msg.ip);
+    }
+}
 
-            ini << "# Número máximo de linhas no RichEdit antes de limpar as antigas\n";
-            ini << "maxRichEditLines=10000\n\n";
+// =======================
+// Sink de janela: aplica um quadro do Display::Batcher ao RichEdit do lado informado.
+// Redesenho suspenso durante o quadro; um EM_SETCHARFORMAT + EM_REPLACESEL por run de cor
+// e uma única remoção do topo calculada pela contagem local de linhas
+// =======================
+void LogSystem::ApplyDisplayFrame(TargetSide side, const Display::Frame& frame) {
+    std::lock_guard<std::mutex> lock(targetMutex);
+    HWND target = targets[(int)side];
 
-            ini << "# Habilitar logging assíncrono (recomendado)\n";
-            ini << "asyncLogging=true\n\n";
+    if (!target || !IsWindow(target) || headlessMode) {
+        return;
+    }
 
-            ini << "# Modo headless (sem GUI, apenas arquivo)\n";
-            ini << "headlessMode=false\n\n";
+    SendMessageA(target, WM_SETREDRAW, FALSE, 0);
 
-            ini << "[Backup]\n";
-            ini << "# Define se os arquivos compactados devem ser enviados para FTP\n";
-            ini << "# true = habilita envio\n";
-            ini << "# false = desabilita envio (padrão)\n";
-            ini << "uploadBackup=false\n\n";
+    if (frame.reset) {
+        SendMessageA(target, EM_SETREADONLY, FALSE, 0);
+        SetWindowTextA(target, "");
+        SendMessageA(target, EM_SETREADONLY, TRUE, 0);
+    }
 
-            ini << "# Endereço do servidor FTP\n";
-            ini << "ftpServer=ftp.meuservidor.com\n\n";
+    CHARRANGE cr{ -1, -1 };
+    SendMessageA(target, EM_EXSETSEL, 0, (LPARAM)&cr);
 
-            ini << "# Usuário para login no FTP\n";
-            ini << "ftpUser=usuario\n\n";
+    CHARFORMAT2A cf{};
+    cf.cbSize = sizeof(CHARFORMAT2A);
+    cf.dwMask = CFM_COLOR | CFM_BACKCOLOR | CFM_FACE | CFM_SIZE;
+    cf.crBackColor = RGB(20, 20, 20);
+    strcpy_s(cf.szFaceName, "Consolas");
+    cf.yHeight = 200;
+
+    // EM_REPLACESEL precisa de texto terminado em zero: cada run é copiado para chunk
+    std::string chunk;
+    size_t offset = 0;
+    for (const Display::ColorRun& run : frame.runs) {
+        chunk.assign(frame.text, offset, run.length);
+        offset += run.length;
+
+        cf.crTextColor = (COLORREF)run.color;
+        SendMessageA(target, EM_SETCHARFORMAT, SCF_SELECTION, (LPARAM)&cf);
+        SendMessageA(target, EM_REPLACESEL, FALSE, (LPARAM)chunk.c_str());
+    }
+
+    if (frame.trimLines > 0) {
+        int charIndex = (int)SendMessageA(target, EM_LINEINDEX, (WPARAM)frame.trimLines, 0);
+        if (charIndex > 0) {
+            SendMessageA(target, EM_SETREADONLY, FALSE, 0);
+            SendMessageA(target, EM_SETSEL, 0, charIndex);
+            SendMessageA(target, EM_REPLACESEL, FALSE, (LPARAM)"");
+            SendMessageA(target, EM_SETREADONLY, TRUE, 0);
+        }
+    }
+
+    SendMessageA(target, EM_SETSEL, -1, -1);
+    SendMessageA(target, EM_SCROLLCARET, 0, 0);
+    SendMessageA(target, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(target, nullptr, FALSE);
+}
+
+// =======================
+// Função única de log - agora com otimizações de performance
+// =======================
+void LogSystem::Log(LogLevel level, std::string_view msg, std::string_view extra, unsigned int ip) {
+    // Nível sem destino: descartado antes de copiar o payload
+    if (!IsLevelEnabled(level)) {
+        return;
+    }
+
+    // Nível que só o gravador de voo consome: registro cru, sem passar pela fila
+    if (!IsLevelDelivered(level)) {
+        RecordFlight(level, LogClock::Now(), ip, msg, extra);
+        return;
+    }
+
+    LogMessage logMsg;
+    logMsg.level = level;
+    logMsg.ip = ip;
+    logMsg.SetPayload(msg, extra);
+
+    Submit(std::move(logMsg));
+}
+
+// =======================
+// Entrega uma mensagem já preenchida (nível, ip, payload) para a fila ou processamento direto
+// =======================
+void LogSystem::Submit(LogMessage&& logMsg) {
+    logMsg.tick = LogClock::Now();
+
+    const LogLevel level = logMsg.level;
+    const bool flight = flightRecorderEnabled.load(std::memory_order_relaxed);
+    if (flight) {
+        RecordFlight(level, logMsg.tick, logMsg.ip, logMsg.Message(), logMsg.Extra());
+    }
+
+    // Formatação imediata: o texto é montado na thread chamadora.
+    // Com formatação adiada a thread só copia os bytes crus e o worker renderiza.
+    if (!asyncLogging || !deferredFormatting.load(std::memory_order_relaxed)) {
+        RenderLogMessage(logMsg);
+    }
+
+    if (asyncLogging) {
+        bool queued = EnqueueLogMessage(std::move(logMsg));
+        if (!queued) {
+            stats.queueFull.fetch_add(1, std::memory_order_relaxed);
+            queued = WaitToEnqueue(logMsg);
+        }
+
+        if (queued) {
+            // Sinaliza só se o worker estiver estacionado; com o worker ativo não há syscall
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (workerParked.load(std::memory_order_relaxed)) {
+                WakeWorker();
+            }
+        }
+        else {
+            // Worker parado ou sem espaço dentro do prazo: processa na thread chamadora,
+            // à frente das mensagens mais antigas que ainda estão na fila
+            ProcessLogMessage(logMsg, *GetSinkList());
+        }
+    }
+    else {
+        // Modo síncrono (fallback)
+        ProcessLogMessage(logMsg, *GetSinkList());
+    }
+
+    // Error: o histórico recente desta thread vai para o arquivo junto com o erro (fora desta thread)
+    if (flight && level == LogLevel::Error) {
+        RequestFlightDump();
+    }
+}
+
+// =======================
+// Fila cheia: espera o worker abrir espaço por até QUEUE_FULL_WAIT_MS, para a mensagem não ser
+// gravada na thread chamadora antes das que já estão na fila. O próprio worker e o shutdown não
+// esperam (ninguém drenaria a fila)
+// =======================
+bool LogSystem::WaitToEnqueue(LogMessage& msg) {
+    if (stopWorker.load(std::memory_order_acquire) || std::this_thread::get_id() == workerThread.get_id()) {
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(QUEUE_FULL_WAIT_MS);
+    do {
+        WakeWorker();
+        std::this_thread::yield();
+        if (EnqueueLogMessage(std::move(msg))) {
+            return true;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
+
+// =======================
+// Gravador de voo: anel da thread atual (sem lock depois do registro) e despejo em arquivo
+// =======================
+void LogSystem::RecordFlight(LogLevel level, uint64_t tick, unsigned int ip, std::string_view msg, std::string_view extra) {
+    GetFlightRing(true)->Record(level, tick, ip, msg, extra);
+}
+
+FlightRecorderRing* LogSystem::GetFlightRing(bool create) {
+    for (auto& e : threadFlight.entries) {
+        if (e.instanceId == instanceId) {
+            return e.ring.get();
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+
+    std::shared_ptr<FlightRecorderRing> ring;
+    {
+        std::lock_guard<std::mutex> lock(flightMutex);
+        for (auto& candidate : flightRings) {
+            if (candidate->orphaned.load(std::memory_order_acquire)) {
+                ring = candidate;
+                ring->Reset();
+                ring->orphaned.store(false, std::memory_order_relaxed);
+                break;
+            }
+        }
+        if (!ring) {
+            ring = std::make_shared<FlightRecorderRing>();
+            flightRings.push_back(ring);
+        }
+        ring->threadId = GetCurrentThreadId();
+    }
+
+    threadFlight.entries.push_back({ instanceId, ring });
+    return ring.get();
+}
+
+size_t LogSystem::DumpFlightRecorder() {
+    return DumpFlightRings(true, "sob demanda");
+}
+
+// Error na thread produtora: só marca o anel dela. Quem despeja é o MaintenancePool, com a tarefa
+// postada pelo worker na próxima passada (ou aqui mesmo em modo síncrono, sem worker)
+void LogSystem::RequestFlightDump() {
+    FlightRecorderRing* own = GetFlightRing(false);
+    if (!own) {
+        return;
+    }
+    own->dumpRequested.store(true, std::memory_order_release);
+    flightDumpPending.store(true, std::memory_order_release);
+    if (!asyncLogging) {
+        PostFlightDump();
+    }
+}
+
+void LogSystem::PostFlightDump() {
+    if (!flightDumpPending.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    bool posted = maintenance.Post("flight", [this]() {
+        DumpFlightRings(false, "Error");
+        return true;
+    });
+    if (!posted) {
+        // Despejo anterior ainda rodando (ou pool parado: o Shutdown despeja tudo)
+        flightDumpPending.store(true, std::memory_order_release);
+    }
+}
+
+// Grava os registros ainda não despejados de todas as threads (ou só das que pediram com Error)
+// em logDir/flight_YYYY-MM-DD.log, no mesmo formato de linha do .log. Não loga nada:
+// roda no MaintenancePool (Error), em DumpFlightRecorder() e no Shutdown()
+size_t LogSystem::DumpFlightRings(bool allThreads, const char* reason) {
+    std::lock_guard<std::mutex> dumpLock(flightDumpMutex);
+
+    // flightMutex só para copiar o registro: uma thread nova não espera a renderização
+    std::vector<std::pair<std::shared_ptr<FlightRecorderRing>, DWORD>> rings;
+    {
+        std::lock_guard<std::mutex> lock(flightMutex);
+        for (auto& ring : flightRings) {
+            bool requested = ring->dumpRequested.exchange(false, std::memory_order_acq_rel);
+            if (allThreads || requested) {
+                rings.emplace_back(ring, ring->threadId);
+            }
+        }
+    }
+
+    Segment::TextRenderer renderer(FractionDigits(timestampPrecision.load(std::memory_order_relaxed)),
+        messageEscape.load(std::memory_order_relaxed));
+    std::vector<FlightEntry> entries;
+    std::string text;
+    size_t total = 0;
+
+    for (auto& [ring, threadId] : rings) {
+        entries.clear();
+        uint64_t from = ring->dumpedUpTo.load(std::memory_order_acquire);
+        uint64_t end = ring->Snapshot(from, entries);
+        ring->dumpedUpTo.compare_exchange_strong(from, end, std::memory_order_acq_rel);   // Reset concorrente prevalece
+        if (entries.empty()) {
+            continue;
+        }
+
+        char header[128];
+        snprintf(header, sizeof(header), "==== Flight recorder: thread %lu, %s, %zu registros ====\r\n",
+            (unsigned long)threadId, reason, entries.size());
+        text += header;
+
+        for (const FlightEntry& entry : entries) {
+            Segment::Record rec;
+            rec.level = (uint8_t)entry.level;
+            rec.micros = clock.ToWallMicros(entry.tick);
+            rec.ip = entry.ip;
+            rec.message = entry.message;
+            rec.extra = entry.extra;
+            renderer.Render(rec, text);
+        }
+        total += entries.size();
+    }
+
+    if (text.empty()) {
+        return 0;
+    }
+
+    std::ofstream out(logDir + "/flight_" + GetDate() + ".log", std::ios::binary | std::ios::app);
+    if (!out) {
+        return 0;
+    }
+    out.write(text.data(), (std::streamsize)text.size());
+    stats.flightDumps.fetch_add(1, std::memory_order_relaxed);
+    return total;
+}
+
+void LogSystem::SetFlightRecorder(bool enabled) {
+    flightRecorderEnabled.store(enabled, std::memory_order_relaxed);
+    UpdateActiveLevels();
+}
+
+// =======================
+// Handler de crash: uma instância por processo (a última instalada)
+// =======================
+void LogSystem::InstallCrashHandler() {
+    if (crashTarget.exchange(this, std::memory_order_acq_rel) != nullptr) {
+        return;     // Handlers já instalados; só troca a instância drenada
+    }
+    previousExceptionFilter = SetUnhandledExceptionFilter(CrashExceptionFilter);
+    previousAbortHandler = signal(SIGABRT, CrashAbortHandler);
+}
+
+// =======================
+// Dreno de emergência: o processo está morrendo. Grava no arquivo atual, em ordem:
+// o lote em memória (writeBuffer), a fila do sink de arquivo, o que o worker já tinha
+// retirado (lote em processamento e mergePending) e as filas do worker (compartilhada
+// e anéis por thread, um anel de cada vez). Sem lock (a thread que falhou pode estar
+// com fileMutex), sem alocação e sem localtime: as mensagens são visitadas no lugar e
+// montadas em emergencyLine. Roda uma única vez; depois dele o worker fica parado.
+// =======================
+void LogSystem::EmergencyDrain() {
+    if (emergencyDrained.exchange(true, std::memory_order_acq_rel) || !IsLogFileOpen()) {
+        return;
+    }
+
+    // O worker retira e destrói mensagens das filas; a thread do sink de arquivo também, além de
+    // gravar writeBuffer, o stream gzip e a view mapeada. Pede que os dois parem e espera as
+    // respostas antes de tocar em qualquer um. Sem resposta no prazo (preso num WriteFile, já
+    // encerrado) o dreno segue assim mesmo; a thread que falhou não precisa responder
+    crashHalt.store(true, std::memory_order_release);
+    fileChannel->RequestHalt();
+    const bool waitWorker = asyncLogging && workerThread.joinable() && std::this_thread::get_id() != workerThread.get_id();
+    const bool waitSink = fileChannel->IsRunning() && !fileChannel->IsSinkThread();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CRASH_HALT_WAIT_MS);
+    while (((waitWorker && !workerHalted.load(std::memory_order_acquire)) || (waitSink && !fileChannel->IsHalted())) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+
+    // Lotes overlapped em voo seriam cancelados com o processo
+    for (auto& slot : overlappedSlots) {
+        if (slot.inFlight) {
+            DWORD transferred = 0;
+            GetOverlappedResult(logFile, &slot.overlapped, &transferred, TRUE);
+        }
+    }
+
+    if (!writeBuffer.empty()) {
+        EmergencyWrite(writeBuffer.data(), writeBuffer.size());
+    }
+
+    const bool binary = fileFormat.load(std::memory_order_relaxed) == FileFormat::Binary;
+    const int digits = FractionDigits(timestampPrecision.load(std::memory_order_relaxed));
+    const int64_t offset = utcOffsetSeconds.load(std::memory_order_relaxed);
+    const Segment::EscapeMode escape = messageEscape.load(std::memory_order_relaxed);
+    uint64_t lastMicros = clock.ToWallMicrosNoWait(LogClock::Now());
+
+    if (binary) {
+        emergencyLine.Clear();
+        Crash::EncodeReset(emergencyLine, lastMicros);
+        EmergencyWrite(emergencyLine.Data(), emergencyLine.Size());
+    }
+
+    auto writeMessage = [&](const LogMessage& msg) {
+        if (!fileChannel->Accepts(msg.level)) {
+            return;
+        }
+        uint64_t micros = clock.ToWallMicrosNoWait(msg.tick);
+
+        emergencyLine.Clear();
+        if (binary) {
+            // Registro cru: sem espaço para escapar aqui, o TextRenderer do logdecode escapa na leitura
+            Crash::EncodeRecord(emergencyLine, (uint8_t)msg.level, (int64_t)(micros - lastMicros), msg.ip,
+                msg.Message(), msg.Extra());
+            lastMicros = micros;
+        }
+        else if (!msg.fullText.empty()) {
+            EmergencyWrite(msg.fullText.data(), msg.fullText.size());
+            return;
+        }
+        else {
+            Crash::RenderLine(emergencyLine, (uint8_t)msg.level, micros, offset, digits, msg.ip,
+                msg.Message(), msg.Extra(), escape);
+        }
+        EmergencyWrite(emergencyLine.Data(), emergencyLine.Size());
+    };
+
+    if (const LogMessage* held = fileChannel->HaltedItem()) {
+        writeMessage(*held);
+    }
+    fileChannel->VisitPending(writeMessage);
+    if (workerHalted.load(std::memory_order_acquire)) {
+        for (size_t i = haltedFrom; i < haltedBatch->size(); ++i) {
+            writeMessage((*haltedBatch)[i]);
+        }
+        for (const auto& msg : mergePending) {
+            writeMessage(msg);
+        }
+    }
+    lockFreeQueue.VisitPending(writeMessage);
+    size_t ringCount = drainRingCount.load(std::memory_order_acquire);
+    for (size_t slot = 0; slot < ringCount; ++slot) {
+        if (ProducerRing* producer = drainRings[slot].load(std::memory_order_acquire)) {
+            producer->ring.VisitPending(writeMessage);
+        }
+    }
+
+    if (gzipStream.IsActive()) {
+        gzipStream.EmergencyFinish([this](const char* bytes, size_t count) { EmergencyWriteFile(bytes, count); });
+    }
+
+    // fileWriter=mapped: trunca o segmento no último byte escrito
+    if (mappedView.IsMapped()) {
+        mappedView.Close(logFile);
+    }
+
+    // Libera o worker e o sink parados para o Shutdown
+    crashHalt.store(false, std::memory_order_release);
+    fileChannel->ReleaseHalt();
+}
+
+void LogSystem::EmergencyWrite(const char* data, size_t size) {
+    if (gzipStream.IsActive()) {
+        // Segmento comprimido: blocos stored no membro aberto (deflate no meio de um lote: não há como continuar)
+        gzipStream.EmergencyAppend(data, size, [this](const char* bytes, size_t count) { EmergencyWriteFile(bytes, count); });
+        return;
+    }
+    EmergencyWriteFile(data, size);
+}
+
+void LogSystem::EmergencyWriteFile(const char* data, size_t size) {
+    if (size == 0 || (mappedView.IsMapped() && mappedView.Append(std::string_view(data, size)))) {
+        return;
+    }
+
+    DWORD written = 0;
+    if (overlappedFile) {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = (DWORD)(writeOffset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = (DWORD)(writeOffset >> 32);
+        if (WriteFile(logFile, data, (DWORD)size, nullptr, &overlapped) || GetLastError() == ERROR_IO_PENDING) {
+            GetOverlappedResult(logFile, &overlapped, &written, TRUE);
+        }
+        writeOffset += size;
+    }
+    else {
+        WriteFile(logFile, data, (DWORD)size, &written, nullptr);
+    }
+}
+
+bool LogSystem::EnqueueLogMessage(LogMessage&& msg) {
+    return (queueMode == QueueMode::PerThread)
+        ? PushToProducerRing(std::move(msg))
+        : lockFreeQueue.TryPush(std::move(msg));
+}
+
+// =======================
+// Registro de formatos da API LogFormat<"..."> (id 0 é reservado para "sem formato")
+// =======================
+namespace {
+    struct FormatTable {
+        std::mutex mutex;
+        std::map<std::string, uint32_t, std::less<>> ids;
+        std::vector<std::string> formats{ std::string() };
+    };
+
+    FormatTable& GetFormatTable() {
+        static FormatTable table;
+        return table;
+    }
+}
+
+uint32_t FormatRegistry::Register(std::string_view fmt) {
+    FormatTable& table = GetFormatTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto it = table.ids.find(fmt);
+    if (it != table.ids.end()) {
+        return it->second;
+    }
+
+    uint32_t id = (uint32_t)table.formats.size();
+    table.formats.emplace_back(fmt);
+    table.ids.emplace(std::string(fmt), id);
+    return id;
+}
+
+std::string FormatRegistry::Get(uint32_t id) {
+    FormatTable& table = GetFormatTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return id < table.formats.size() ? table.formats[id] : std::string();
+}
+
+size_t FormatRegistry::Count() {
+    FormatTable& table = GetFormatTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.formats.size() - 1;
+}
+
+// =======================
+// Monta "[ts] [LEVEL] msg [extra] [IP:a.b.c.d]" a partir dos campos crus da mensagem
+// =======================
+void LogSystem::RenderLogMessage(LogMessage& msg) {
+    // Cache do timestamp por thread: o worker renderiza quase tudo, mas o fallback
+    // síncrono (fila cheia) também passa por aqui
+    thread_local int64_t cachedSecond = -1;
+    thread_local char cachedStamp[32] = {};
+    thread_local size_t cachedStampLength = 0;
+
+    uint64_t micros = clock.ToWallMicros(msg.tick);
+    int64_t second = (int64_t)(micros / 1000000);
+    if (second != cachedSecond) {
+        time_t t = (time_t)second;
+        std::tm tm;
+        localtime_s(&tm, &t);
+        cachedStampLength = strftime(cachedStamp, sizeof(cachedStamp), "[%Y-%m-%d %H:%M:%S", &tm);
+        cachedSecond = second;
+    }
+
+    std::string prefix = LevelToString(msg.level);
+    std::string_view message = msg.Message();
+    std::string_view extra = msg.Extra();
+    Segment::EscapeMode escape = messageEscape.load(std::memory_order_relaxed);
+
+    std::string& out = msg.fullText;
+    out.clear();
+    out.reserve(cachedStampLength + prefix.size() + message.size() + extra.size() + 40);
+
+    out.append(cachedStamp, cachedStampLength);
+    Segment::AppendStampFraction(out, micros, FractionDigits(timestampPrecision.load(std::memory_order_relaxed)));
+    out += "] ";
+    out += prefix;
+    out += ' ';
+    Segment::AppendEscaped(out, message, escape);    // \r, \n e controles de texto de jogador não quebram a linha
+
+    if (!extra.empty()) {
+        out += " [";
+        Segment::AppendEscaped(out, extra, escape);
+        out += ']';
+    }
+
+    if (msg.ip != 0) {
+        char ipStr[32];
+        sprintf_s(ipStr, "%u.%u.%u.%u",
+            (msg.ip >> 24) & 0xFF,
+            (msg.ip >> 16) & 0xFF,
+            (msg.ip >> 8) & 0xFF,
+            msg.ip & 0xFF
+        );
+        out += " [IP:";
+        out += ipStr;
+        out += ']';
+    }
+
+    stats.RecordLog(msg.level, out.size());
+    out += "\r\n";
+}
+
+// =======================
+// Funções para habilitar/desabilitar níveis de log para arquivo e janela
+// =======================
+void LogSystem::EnableFileLevel(LogLevel level) { 
+    fileLevelMask.fetch_or(LevelBit(level), std::memory_order_relaxed);
+    UpdateActiveLevels();
+}
+    
+void LogSystem::DisableFileLevel(LogLevel level) { 
+    fileLevelMask.fetch_and(~LevelBit(level), std::memory_order_relaxed);
+    UpdateActiveLevels();
+}
+
+void LogSystem::EnableDisplayLevel(LogLevel level) {
+    displayLevelMask.fetch_or(LevelBit(level), std::memory_order_relaxed);
+    UpdateActiveLevels();
+}
+
+void LogSystem::DisableDisplayLevel(LogLevel level) {
+    displayLevelMask.fetch_and(~LevelBit(level), std::memory_order_relaxed);
+    UpdateActiveLevels();
+}
+
+// Aplica as máscaras de arquivo/janelas aos sinks internos e recalcula a máscara consultada
+// por Log() (união de todos os sinks); logMutex só serializa os escritores
+void LogSystem::UpdateActiveLevels() {
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    fileChannel->SetLevelMask(fileLevelMask.load(std::memory_order_relaxed));
+
+    uint32_t display = headlessMode ? 0 : displayLevelMask.load(std::memory_order_relaxed);
+    for (int i = 0; i < TARGET_COUNT; ++i) {
+        displayChannels[i]->SetLevelMask(display & targetLevelMask[i].load(std::memory_order_relaxed));
+    }
+
+    uint32_t mask = 0;
+    for (const auto& channel : *GetSinkList()) {
+        mask |= channel->GetLevelMask();
+    }
+    deliveryLevelMask.store(mask, std::memory_order_relaxed);
+
+    // O gravador de voo consome todos os níveis (exceto os removidos em compilação)
+    if (flightRecorderEnabled.load(std::memory_order_relaxed)) {
+        mask |= ALL_LEVELS_MASK;
+    }
+    activeLevelMask.store(mask, std::memory_order_relaxed);
+}
+
+// =======================
+// Registro de sinks
+// =======================
+std::shared_ptr<const LogSystem::SinkList> LogSystem::GetSinkList() const {
+    std::lock_guard<std::mutex> lock(sinksMutex);
+    return sinkList;
+}
+
+void LogSystem::AddSink(std::shared_ptr<ILogSink> sink, uint32_t levelMask, SinkOverflowPolicy policy) {
+    if (!sink) {
+        return;
+    }
+
+    auto channel = std::make_shared<SinkChannel>(std::move(sink), levelMask & ALL_LEVELS_MASK, policy);
+    if (asyncLogging && workerThread.joinable() && !stopWorker.load(std::memory_order_acquire)) {
+        channel->Start();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sinksMutex);
+        auto list = std::make_shared<SinkList>(*sinkList);
+        list->push_back(std::move(channel));
+        sinkList = std::move(list);
+    }
+    sinksVersion.fetch_add(1, std::memory_order_release);
+    UpdateActiveLevels();
+}
+
+// Mensagens já despachadas pelo worker na passada atual ainda podem chegar ao sink removido
+bool LogSystem::RemoveSink(const ILogSink* sink) {
+    std::shared_ptr<SinkChannel> removed;
+    {
+        std::lock_guard<std::mutex> lock(sinksMutex);
+        auto list = std::make_shared<SinkList>(*sinkList);
+        auto it = std::find_if(list->begin(), list->end(), [&](const std::shared_ptr<SinkChannel>& channel) {
+            return &channel->GetSink() == sink && channel != fileChannel &&
+                   channel != displayChannels[0] && channel != displayChannels[1];
+        });
+        if (it == list->end()) {
+            return false;
+        }
+        removed = *it;
+        list->erase(it);
+        sinkList = std::move(list);
+    }
+    sinksVersion.fetch_add(1, std::memory_order_release);
+
+    UpdateActiveLevels();
+    removed->Stop();
+    return true;
+}
+
+// Sinks internos seguem EnableFileLevel/EnableDisplayLevel
+bool LogSystem::SetSinkLevelMask(const ILogSink* sink, uint32_t levelMask) {
+    bool found = false;
+    for (const auto& channel : *GetSinkList()) {
+        if (&channel->GetSink() == sink && channel != fileChannel &&
+            channel != displayChannels[0] && channel != displayChannels[1]) {
+            channel->SetLevelMask(levelMask & ALL_LEVELS_MASK);
+            found = true;
+        }
+    }
+
+    if (found) {
+        UpdateActiveLevels();
+    }
+    return found;
+}
+
+std::vector<SinkStats> LogSystem::GetSinkStats() const {
+    std::vector<SinkStats> result;
+    for (const auto& channel : *GetSinkList()) {
+        result.push_back(channel->GetStats());
+    }
+    return result;
+}
+
+void LogSystem::StartSinks() {
+    for (const auto& channel : *GetSinkList()) {
+        channel->Start();
+    }
+}
+
+void LogSystem::StopSinks() {
+    for (const auto& channel : *GetSinkList()) {
+        channel->Stop();
+    }
+}
+
+// =======================
+// SinkChannel: fila limitada + thread de um sink
+// =======================
+void SinkChannel::Start() {
+    if (worker.joinable()) {
+        return;
+    }
+    stopping.store(false, std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+    worker = std::thread(&SinkChannel::Run, this);
+}
+
+void SinkChannel::Stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+
+    stopping.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        parked.store(false, std::memory_order_relaxed);
+    }
+    parkCV.notify_one();
+
+    worker.join();
+    running.store(false, std::memory_order_release);
+
+    // Entregues depois que a thread saiu: não serão mais gravados
+    std::shared_ptr<const LogMessage> item;
+    while (queue.TryPop(item)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SinkChannel::Push(std::shared_ptr<const LogMessage> msg) {
+    if (!queue.TryPush(std::move(msg))) {
+        switch (policy) {
+        case SinkOverflowPolicy::DropNewest:
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+
+        case SinkOverflowPolicy::DropOldest: {
+            std::shared_ptr<const LogMessage> oldest;
+            while (!queue.TryPush(std::move(msg))) {
+                if (queue.TryPop(oldest)) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    oldest.reset();
+                }
+            }
+            break;
+        }
+
+        case SinkOverflowPolicy::Block:
+            stalls.fetch_add(1, std::memory_order_relaxed);
+            while (!queue.TryPush(std::move(msg))) {
+                if (stopping.load(std::memory_order_acquire)) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                Wake();
+                std::this_thread::yield();
+            }
+            break;
+        }
+    }
+
+    // Par do fence em Run: ou este lado vê parked == true, ou o sink vê a mensagem
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed)) {
+        Wake();
+    }
+}
+
+void SinkChannel::WriteInline(const LogMessage& msg) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    try {
+        sink->Write(msg);
+        sink->Flush(false);
+        written.fetch_add(1, std::memory_order_relaxed);
+    }
+    catch (...) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void SinkChannel::Wake() {
+    if (!parked.exchange(false, std::memory_order_relaxed)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(parkMutex);
+    }
+    parkCV.notify_one();
+}
+
+// =======================
+// Dreno de emergência em andamento: o sink publica o item que retirou e não gravou, e não toca
+// mais na fila nem no sink até o dreno terminar e o Stop pedir
+// =======================
+void SinkChannel::HaltForCrash(const LogMessage* held) {
+    haltedItem = held;
+    halted.store(true, std::memory_order_release);
+
+    while (haltRequested.load(std::memory_order_acquire) || !stopping.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WORKER_PARK_TIMEOUT_MS));
+    }
+}
+
+// Mesmo esquema do worker principal: drena em lotes, yield curto e estaciona na parkCV.
+// O pedido do dreno de emergência é conferido antes de cada TryPop, Write e Flush
+void SinkChannel::Run() {
+    std::shared_ptr<const LogMessage> item;
+    int idleRounds = 0;
+
+    // true depois de parado: nada mais é retirado, gravado ou descarregado
+    auto halting = [&]() {
+        if (!halted.load(std::memory_order_relaxed) && haltRequested.load(std::memory_order_acquire)) {
+            HaltForCrash(item.get());
+        }
+        return halted.load(std::memory_order_relaxed);
+    };
+
+    auto writeItem = [&]() {
+        try {
+            sink->Write(*item);
+            written.fetch_add(1, std::memory_order_relaxed);
+        }
+        catch (...) {
+            dropped.fetch_add(1, std::memory_order_relaxed);  // Um sink com erro não derruba a thread
+        }
+        item.reset();
+    };
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        size_t count = 0;
+        while (count < WORKER_DRAIN_BATCH && !halting() && queue.TryPop(item)) {
+            if (halting()) return;
+            writeItem();
+            ++count;
+        }
+        if (halting()) return;
+
+        if (count > 0) {
+            sink->Flush(false);
+            idleRounds = 0;
+            continue;
+        }
+
+        if (++idleRounds <= SINK_YIELD_COUNT) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Nada mais vai chegar enquanto o sink dorme: grava o que estiver pendente
+        if (halting()) return;
+        sink->Flush(true);
+
+        std::unique_lock<std::mutex> lock(parkMutex);
+        parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (queue.IsEmpty() && !stopping.load(std::memory_order_acquire)) {
+            parkCV.wait_for(lock, std::chrono::milliseconds(WORKER_PARK_TIMEOUT_MS), [this] {
+                return !parked.load(std::memory_order_relaxed);
+            });
+        }
+
+        parked.store(false, std::memory_order_relaxed);
+        idleRounds = 0;
+    }
+
+    // Encerramento: grava o que restou na fila (max 100ms)
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    while (std::chrono::steady_clock::now() < deadline && !halting() && queue.TryPop(item)) {
+        if (halting()) return;
+        writeItem();
+    }
+    if (halting()) return;
+    sink->Flush(true);
+}
+
+SinkStats SinkChannel::GetStats() const {
+    SinkStats result;
+    result.name = sink->GetName();
+    result.levelMask = GetLevelMask();
+    result.depth = queue.Size();
+    result.capacity = queue.GetCapacity();
+    result.written = written.load(std::memory_order_relaxed);
+    result.dropped = dropped.load(std::memory_order_relaxed);
+    result.stalls = stalls.load(std::memory_order_relaxed);
+    return result;
+}
+
+// =======================
+// Sinks internos
+// =======================
+bool FileSink::NeedsText() const {
+    return owner.fileFormat.load(std::memory_order_relaxed) != FileFormat::Binary;
+}
+
+void FileSink::Write(const LogMessage& msg) {
+    owner.WriteFileRecord(msg);
+}
+
+// Lote pendente há mais de writeBatchDelayMs vai para o disco mesmo sem encher;
+// com a fila vazia vai tudo
+void FileSink::Flush(bool idle) {
+    owner.FlushPendingWrites(idle);
+}
+
+void RichEditSink::Write(const LogMessage& msg) {
+    batcher.Append(msg.fullText, (uint32_t)owner.GetColor(msg.level));
+}
+
+// Publica o quadro acumulado respeitando displayFps; com a fila vazia (ou no modo síncrono,
+// em que não há outro Flush para entregar o resto) publica na hora
+void RichEditSink::Flush(bool idle) {
+    if (resetRequested.exchange(false, std::memory_order_acquire)) {
+        batcher.ResetLineCount();
+    }
+    batcher.SetMaxFps(owner.displayFps.load(std::memory_order_relaxed));
+    batcher.SetMaxLines((size_t)owner.maxRichEditLines.load(std::memory_order_relaxed));
+
+    bool force = idle || !owner.asyncLogging;
+    if (batcher.Publish(surface, LogClock::Now(), force)) {
+        frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RichEditSurface::Apply(const Display::Frame& frame) {
+    owner.ApplyDisplayFrame(side, frame);
+}
+
+// =======================
+// Função para abrir o arquivo de log com base na data atual e índice de rotação
+// =======================
+std::string LogSystem::GetLogFileName(int index) const {
+    return logDir + "/server_" + currentDate + "_" + std::to_string(index) +
+        (fileFormat.load(std::memory_order_relaxed) == FileFormat::Binary ? Segment::FILE_EXTENSION : ".log") +
+        (segmentCompression ? Compress::FILE_EXTENSION : "");
+}
+
+// Troca o formato em tempo de execução; o arquivo aberto é fechado e o próximo já sai no novo formato
+void LogSystem::SetFileFormat(FileFormat format) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (fileFormat.exchange(format, std::memory_order_relaxed) != format && IsLogFileOpen()) {
+        CloseLogFile();
+    }
+}
+
+// Liga/desliga a compressão na escrita; como na troca de formato, o próximo segmento já sai com o novo nome
+void LogSystem::SetSegmentCompression(bool enabled, size_t blockBytes) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    compressionBlockBytes = blockBytes;
+    if (segmentCompression != enabled) {
+        segmentCompression = enabled;
+        if (IsLogFileOpen()) {
+            CloseLogFile();
+        }
+    }
+}
+
+void LogSystem::OpenLogFile() {
+    currentDate = GetDate();
+    nextMidnightTick.store(ComputeNextMidnightTick(), std::memory_order_relaxed);
+    utcOffsetSeconds.store(ComputeUtcOffset(), std::memory_order_relaxed);
+    std::string filename = GetLogFileName(fileIndex);
+
+    // O lote pendente pertence ao arquivo anterior; o segmento preparado em background
+    // era para outro nome (troca de dia/formato) e é descartado
+    CloseLogFile();
+    DiscardPreparedSegment();
+
+    ActivateSegment(CreateSegmentFile(filename, maxLogSize, fileWriter == FileWriter::Overlapped));
+    PrepareNextSegment();
+}
+
+// =======================
+// Motor de rotação: o próximo segmento (mesmo dia, fileIndex + 1) é criado e pré-alocado
+// por uma tarefa em background, e a rotação só troca o handle
+// =======================
+PreparedSegment LogSystem::CreateSegmentFile(const std::string& filename, uint64_t preallocate, bool overlapped) {
+    PreparedSegment segment;
+    segment.filename = filename;
+    segment.overlapped = overlapped;
+
+    // Handle cru: o texto já sai com \r\n do renderizador e cada lote é um único WriteFile
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | (overlapped ? FILE_FLAG_OVERLAPPED : 0);
+    auto openFile = [&filename, flags]() {
+        return CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr, OPEN_ALWAYS, flags, nullptr);
+    };
+
+    segment.handle = WinHandle(openFile());
+    if (!segment.handle.IsValid()) {
+        // Tentar criar diretório se não existir
+        std::error_code ec;
+        fs::create_directories(fs::path(filename).parent_path(), ec);
+        segment.handle = WinHandle(openFile());
+        if (!segment.handle.IsValid()) {
+            return segment;
+        }
+    }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(segment.handle, &size)) {
+        segment.size = (uint64_t)size.QuadPart;
+    }
+
+    // Continua no fim de um arquivo existente (único escritor)
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    SetFilePointerEx(segment.handle, zero, nullptr, FILE_END);
+
+    // Reserva os clusters sem mudar o EOF: o arquivo cresce sem realocação e o
+    // excedente é liberado pelo NTFS ao fechar
+    if (preallocate > segment.size) {
+        FILE_ALLOCATION_INFO allocation;
+        allocation.AllocationSize.QuadPart = (LONGLONG)preallocate;
+        SetFileInformationByHandle(segment.handle, FileAllocationInfo, &allocation, sizeof(allocation));
+    }
+
+    return segment;
+}
+
+void LogSystem::PrepareNextSegment() {
+    std::string filename = GetLogFileName(fileIndex + 1);
+
+    try {
+        nextSegment = std::async(std::launch::async, &LogSystem::CreateSegmentFile, std::move(filename),
+            (uint64_t)maxLogSize, fileWriter == FileWriter::Overlapped);
+    }
+    catch (const std::system_error&) {
+        // Sem thread disponível: a próxima rotação abre o arquivo de forma síncrona
+        nextSegment = std::future<PreparedSegment>();
+    }
+}
+
+// Chamada com fileMutex adquirido, depois de fileIndex avançar
+void LogSystem::SwitchToNextSegment() {
+    CloseLogFile();
+
+    bool stalled = true;
+    if (nextSegment.valid()) {
+        stalled = nextSegment.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+
+        PreparedSegment segment = nextSegment.get();
+        if (segment.handle.IsValid() && segment.filename == GetLogFileName(fileIndex) &&
+            segment.overlapped == (fileWriter == FileWriter::Overlapped)) {
+            if (stalled) {
+                stats.rotationStalls.fetch_add(1, std::memory_order_relaxed);
+            }
+            ActivateSegment(std::move(segment));
+            PrepareNextSegment();
+            return;
+        }
+        if (segment.handle.IsValid() && segment.size == 0) {
+            segment.handle = WinHandle();
+            DeleteFileA(segment.filename.c_str());
+        }
+    }
+
+    // Segmento não preparado (falha ou nome diferente): abre no caminho do log
+    stats.rotationStalls.fetch_add(1, std::memory_order_relaxed);
+    OpenLogFile();
+}
+
+// Descarta o segmento preparado; se ficou vazio o arquivo é removido
+void LogSystem::DiscardPreparedSegment() {
+    if (!nextSegment.valid()) {
+        return;
+    }
+
+    PreparedSegment segment = nextSegment.get();
+    if (segment.handle.IsValid() && segment.size == 0) {
+        segment.handle = WinHandle();
+        DeleteFileA(segment.filename.c_str());
+    }
+}
+
+void LogSystem::ActivateSegment(PreparedSegment&& segment) {
+    CloseLogFile();
+    logFile = std::move(segment.handle);
+    currentFileSize = IsLogFileOpen() ? segment.size : 0;
+    writeOffset = currentFileSize;
+    overlappedFile = IsLogFileOpen() && segment.overlapped;
+    nextTimedRotation = ComputeNextTimedRotation();
+
+    if (!IsLogFileOpen()) {
+        return;
+    }
+
+    // A partir daqui o segmento existe para a limpeza; reabrir no mesmo dia só atualiza o tamanho
+    currentSegmentName = fs::path(segment.filename).filename().string();
+    manifest.OpenSegment(currentSegmentName, currentFileSize);
+
+    // Segmento comprimido: um membro gzip novo (um arquivo existente do mesmo dia recebe membros concatenados)
+    if (segmentCompression && !gzipStream.Begin(Compress::LIVE_LEVEL, compressionBlockBytes)) {
+        Warning("Falha ao iniciar a compressão do segmento; gravando sem compressão");
+    }
+
+    // Segmento mapeado com o tamanho da rotação mais uma folga para a linha que a dispara.
+    // Se o mapeamento falhar (ex.: espaço de endereçamento em 32 bits) o segmento usa WriteFile.
+    // Com compressão os bytes só existem depois do deflate do lote: sempre WriteFile.
+    if (fileWriter == FileWriter::Mapped && !gzipStream.IsActive()) {
+        uint64_t capacity = (std::max)((uint64_t)maxLogSize, currentFileSize) + MAPPED_SEGMENT_SLACK;
+        mappedView.Map(logFile, currentFileSize, capacity);
+    }
+
+    OpenSegmentIndex(segment.filename);
+
+    if (fileFormat.load(std::memory_order_relaxed) == FileFormat::Binary) {
+        // Segmento novo recebe o cabeçalho; um já existente (reinício no mesmo dia)
+        // recebe um registro de reset que zera a tabela de strings e a base de tempo
+        uint64_t nowMicros = clock.ToWallMicros(LogClock::Now());
+
+        segmentBuffer.clear();
+        if (currentFileSize == 0) {
+            segmentEncoder.WriteHeader(nowMicros, segmentBuffer);
+        }
+        else {
+            segmentEncoder.WriteReset(nowMicros, segmentBuffer);
+        }
+        AppendToFile(segmentBuffer);
+    }
+}
+
+// Desligar fecha o .idx na hora; ligar vale a partir do próximo segmento
+void LogSystem::SetSegmentIndex(bool enabled, size_t blockBytes) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    indexBuilder.SetBlockBytes(blockBytes);
+    segmentIndex = enabled;
+    if (!enabled) {
+        CloseSegmentIndex();
+    }
+}
+
+// =======================
+// Índice lateral: blocos de indexBlockBytes do segmento com intervalo de tempo, níveis e Bloom dos IPs
+// =======================
+void LogSystem::OpenSegmentIndex(const std::string& segmentFile) {
+    CloseSegmentIndex();
+
+    // Segmento .gz reaberto: o tamanho no disco não é a posição no stream descomprimido
+    if (!segmentIndex || (gzipStream.IsActive() && currentFileSize > 0)) {
+        return;
+    }
+
+    std::string path = segmentFile + Index::FILE_EXTENSION;
+    std::error_code ec;
+    uint64_t existing = currentFileSize > 0 ? (uint64_t)fs::file_size(path, ec) : 0;
+
+    if (currentFileSize > 0 && !ec && existing >= Index::HEADER_SIZE) {
+        // Reinício no mesmo dia: continua o índice; uma entrada cortada por queda é descartada
+        uint64_t whole = Index::HEADER_SIZE + (existing - Index::HEADER_SIZE) / Index::ENTRY_SIZE * Index::ENTRY_SIZE;
+        if (whole != existing) {
+            fs::resize_file(path, whole, ec);
+        }
+        indexFile.open(path, std::ios::binary | std::ios::app);
+    }
+    else {
+        // O que já havia num segmento reaberto sem índice fica fora dos blocos
+        uint16_t flags = (gzipStream.IsActive() ? Index::FLAG_COMPRESSED : 0) |
+            (fileFormat.load(std::memory_order_relaxed) == FileFormat::Binary ? Index::FLAG_BINARY : 0);
+        indexBuffer.clear();
+        Index::WriteHeader(flags, (uint32_t)indexBuilder.GetBlockBytes(), indexBuffer);
+        indexFile.open(path, std::ios::binary | std::ios::trunc);
+        indexFile.write(indexBuffer.data(), (std::streamsize)indexBuffer.size());
+    }
+
+    if (indexFile.is_open()) {
+        indexBuilder.Begin(currentFileSize);
+    }
+}
+
+void LogSystem::CloseSegmentIndex() {
+    if (!indexFile.is_open()) {
+        return;
+    }
+
+    indexBuffer.clear();
+    if (indexBuilder.Finish(currentFileSize, indexBuffer)) {
+        indexFile.write(indexBuffer.data(), (std::streamsize)indexBuffer.size());
+        stats.indexBlocks.fetch_add(1, std::memory_order_relaxed);
+    }
+    indexFile.close();
+}
+
+// Chamada com fileMutex antes de gravar o registro: currentFileSize é onde ele começa
+void LogSystem::IndexRecord(uint64_t tick, LogLevel level, unsigned int ip) {
+    if (!indexBuilder.IsOpen()) {
+        return;
+    }
+
+    uint64_t micros = clock.ToWallMicros(tick);
+    if (indexBuilder.IsFull(currentFileSize)) {
+        // Uma entrada por bloco, com flush: o índice acompanha o segmento em caso de queda
+        indexBuffer.clear();
+        indexBuilder.Finish(currentFileSize, indexBuffer);
+        indexFile.write(indexBuffer.data(), (std::streamsize)indexBuffer.size());
+        indexFile.flush();
+        stats.indexBlocks.fetch_add(1, std::memory_order_relaxed);
+
+        indexBuilder.Begin(currentFileSize);
+        if (fileFormat.load(std::memory_order_relaxed) == FileFormat::Binary) {
+            // Reset no início do bloco: a tabela de strings e a base de tempo recomeçam, o bloco decodifica sozinho
+            segmentBuffer.clear();
+            segmentEncoder.WriteReset(micros, segmentBuffer);
+            AppendToFile(segmentBuffer);
+        }
+    }
+    indexBuilder.Add(micros, (uint8_t)level, ip);
+}
+
+// =======================
+// Limpeza dos logs antigos: CleanupOldLogs só agenda a varredura no MaintenancePool; cada dia
+// (compressMode=day) ou arquivo (file/none) vira uma tarefa, compactadas em paralelo
+// =======================
+void LogSystem::CleanupOldLogs() {
+    auto settings = std::make_shared<CleanupSettings>();
+    settings->logDir = logDir;
+    settings->compressMode = compressMode;
+    settings->compressLevel = compressLevel;
+    // Threads de compressão por pacote; automático divide os núcleos entre as threads de manutenção
+    settings->compressThreads = compressThreads > 0 ? compressThreads :
+        (std::max)(1, (int)std::thread::hardware_concurrency() / (std::max)(1, maintenance.GetThreadCount()));
+    settings->retentionDays = retentionDays;
+    settings->uploadBackup = uploadBackup;
+
+    std::shared_ptr<const CleanupSettings> snapshot = std::move(settings);
+    maintenance.Post("scan", [this, snapshot]() { return ScanOldLogs(snapshot); });
+}
+
+bool LogSystem::ScanOldLogs(const std::shared_ptr<const CleanupSettings>& settings) {
+    auto cycle = std::make_shared<CleanupCycle>();
+    cycle->start = std::chrono::steady_clock::now();
+
+    try {
+        // Último dia expirado: idade >= retentionDays dias. Datas YYYY-MM-DD comparam como texto
+        std::time_t limit = std::time(nullptr) - (std::time_t)settings->retentionDays * 24 * 60 * 60;
+        std::tm tm;
+        localtime_s(&tm, &limit);
+        char lastDay[16];
+        std::strftime(lastDay, sizeof(lastDay), "%Y-%m-%d", &tm);
+
+        // Só os dias expirados saem do manifesto: o custo não depende do tamanho de logDir
+        std::map<std::string, std::vector<std::string>> filesByDay;
+        for (auto& [day, names] : manifest.Expired(lastDay)) {
+            for (const auto& name : names) {
+                // Segmento já comprimido na escrita é o próprio arquivo final do modo file
+                if (settings->compressMode == "file" && fs::path(name).extension() == Compress::FILE_EXTENSION) {
+                    manifest.ArchiveSegment(name);
+                    continue;
+                }
+                filesByDay[day].push_back(settings->logDir + "/" + name);
+            }
+        }
+
+        // day: um ZIP por dia; file/none: cada arquivo é independente
+        std::vector<std::pair<std::string, MaintenancePool::Task>> tasks;
+        for (auto& [day, files] : filesByDay) {
+            if (settings->compressMode == "day") {
+                tasks.emplace_back("day:" + day, [this, settings, cycle, day = day, files = files]() {
+                    bool ok = CleanupOldFiles(*settings, day, files);
+                    FinishCleanupTask(cycle);
+                    return ok;
+                });
+            }
+            else {
+                for (const auto& f : files) {
+                    tasks.emplace_back("file:" + f, [this, settings, cycle, day = day, f]() {
+                        bool ok = CleanupOldFiles(*settings, day, { f });
+                        FinishCleanupTask(cycle);
+                        return ok;
+                    });
+                }
+            }
+        }
+
+        cycle->remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+        for (auto& [key, task] : tasks) {
+            if (!maintenance.Post(key, std::move(task))) {
+                FinishCleanupTask(cycle);   // Já agendado por uma limpeza anterior, ou encerrando
+            }
+        }
+        FinishCleanupTask(cycle);           // A própria varredura
+        return true;
+    }
+    catch (const std::exception& e) {
+        Error("Exceção em CleanupOldLogs: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void LogSystem::FinishCleanupTask(const std::shared_ptr<CleanupCycle>& cycle) {
+    if (cycle->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cycle->start);
+        stats.lastCleanupMicros.store((uint64_t)elapsed.count(), std::memory_order_relaxed);
+    }
+}
+
+// Roda numa thread de manutenção: files são os arquivos de um dia (day) ou um único arquivo (file/none)
+bool LogSystem::CleanupOldFiles(const CleanupSettings& settings, const std::string& day, const std::vector<std::string>& files) {
+    bool ok = true;
+    try {
+        if (settings.compressMode == "none") {
+            // Apenas deletar arquivos antigos
+            for (auto& f : files) {
+                try {
+                    fs::remove(f);
+                    fs::remove(f + Index::FILE_EXTENSION);
+                    manifest.DeleteSegment(fs::path(f).filename().string());
+                    Info("Arquivo excluído: " + f);
+                }
+                catch (const std::exception& e) {
+                    Error("Falha ao excluir arquivo: " + f + " - " + e.what());
+                    ok = false;
+                }
+            }
+        }
+        else if (settings.compressMode == "file") {
+            // Compactar cada arquivo individualmente
+            for (auto& f : files) {
+                if (!CompressFile(settings, f)) {
+                    ok = false;
+                    continue;
+                }
+
+                stats.compressionCount.fetch_add(1, std::memory_order_relaxed);
+                Info("Compactação concluída: " + f + ".zip");
+                try {
+                    fs::remove(f);
+                    fs::remove(f + Index::FILE_EXTENSION);
+                    Info("Arquivo excluído após compactação: " + f);
+                }
+                catch (const std::exception& e) {
+                    Error("Falha ao excluir arquivo: " + f + " - " + e.what());
+                }
+                manifest.ArchiveSegment(fs::path(f).filename().string());
+
+                if (settings.uploadBackup) {
+                    QueueUpload(f + ".zip");
+                }
+            }
+        }
+        else if (settings.compressMode == "day") {
+            // Compactar todos os arquivos do dia em um único ZIP
+            Info("Iniciando compactação dos logs do dia " + day);
+
+            if (CompressDayLogs(settings, day, files)) {
+                stats.compressionCount.fetch_add(1, std::memory_order_relaxed);
+                Info("Compactação concluída: logpack_" + day + ".zip");
+
+                for (auto& f : files) {
+                    try {
+                        fs::remove(f);
+                        fs::remove(f + Index::FILE_EXTENSION);
+                        Info("Arquivo excluído após compactação: " + f);
+                    }
+                    catch (const std::exception& e) {
+                        Error("Falha ao excluir arquivo: " + f + " - " + e.what());
+                    }
+                    manifest.ArchiveSegment(fs::path(f).filename().string());
+                }
+
+                if (settings.uploadBackup) {
+                    QueueUpload(settings.logDir + "/logpack_" + day + ".zip");
+                }
+            }
+            else {
+                if (!maintenance.StopRequested()) {
+                    Error("Falha ao compactar logs do dia " + day);
+                }
+                ok = false;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        Error("Exceção em CleanupOldLogs: " + std::string(e.what()));
+        ok = false;
+    }
+    return ok;
+}
+
+// =======================
+// Upload dos pacotes: a limpeza só registra o pacote como pendente no manifesto e o coloca na fila;
+// o envio, as novas tentativas e a retomada rodam nas threads da UploadQueue
+// =======================
+void LogSystem::StartUploads() {
+    if (!uploadBackup) {
+        return;     // Pendentes continuam no manifesto até o upload ser habilitado
+    }
+
+    Upload::TransportFactory factory;
+    if (uploadTransport == "directory") {
+        if (uploadDirectory.empty()) {
+            Error("uploadTransport=directory sem uploadDirectory; upload desabilitado");
+            return;
+        }
+        factory = [dir = uploadDirectory]() { return std::make_unique<Upload::DirectoryTransport>(dir); };
+    }
+    else {
+        factory = [server = ftpServer, user = ftpUser, pass = ftpPass, path = ftpPath]() {
+            return std::make_unique<FtpTransport>(server, user, pass, path);
+        };
+    }
+
+    Upload::Settings settings;
+    settings.threads = uploadThreads;
+    settings.bandwidthBytes = (uint64_t)uploadBandwidthKB * 1024;
+    settings.retryBase = std::chrono::seconds(uploadRetrySeconds);
+    uploads.Start(std::move(factory), settings,
+        [this](const std::string& localZip, const std::string& remote, Upload::UploadQueue::Result result,
+            std::chrono::milliseconds retryIn) {
+            OnUploadFinished(localZip, remote, result, retryIn);
+        });
+
+    // Pacotes que não terminaram de subir numa execução anterior
+    for (const auto& archive : manifest.GetPendingUploads()) {
+        uploads.Enqueue(logDir + "/" + archive, archive);
+    }
+}
+
+void LogSystem::QueueUpload(const std::string& localZip) {
+    std::string archive = fs::path(localZip).filename().string();
+    manifest.AddPendingUpload(archive);
+    uploads.Enqueue(localZip, archive);
+}
+
+// Roda numa thread da fila de upload
+void LogSystem::OnUploadFinished(const std::string& localZip, const std::string& remote,
+    Upload::UploadQueue::Result result, std::chrono::milliseconds retryIn) {
+    std::string archive = fs::path(localZip).filename().string();
+
+    switch (result) {
+    case Upload::UploadQueue::Result::Done:
+        manifest.MarkUploaded(archive);
+        Info("Upload concluído: " + remote);
+        break;
+    case Upload::UploadQueue::Result::Retry:
+        Warning("Falha no upload para " + remote + "; nova tentativa em " +
+            std::to_string(retryIn.count() / 1000) + "s");
+        break;
+    case Upload::UploadQueue::Result::Abandon:
+        manifest.DropUpload(archive);
+        Error("Pacote não encontrado para upload: " + localZip);
+        break;
+    }
+}
+
+// =======================
+// MaintenancePool: fila de tarefas + threads de manutenção
+// =======================
+void MaintenancePool::Start(int threads, bool lowPriority) {
+    if (!workers.empty()) {
+        return;
+    }
+
+    threads = (std::clamp)(threads, 1, MAINTENANCE_MAX_THREADS);
+    stopping.store(false, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        accepting = true;
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&MaintenancePool::Run, this, lowPriority);
+    }
+    threadCount.store(threads, std::memory_order_relaxed);
+}
+
+void MaintenancePool::Stop() {
+    if (workers.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        accepting = false;
+        stopping.store(true, std::memory_order_relaxed);
+
+        // Pendentes são só descartados: os arquivos continuam no disco para a próxima limpeza
+        stats.maintenanceQueued.fetch_sub(tasks.size(), std::memory_order_relaxed);
+        for (const auto& item : tasks) {
+            keys.erase(item.first);
+        }
+        tasks.clear();
+    }
+    cv.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    threadCount.store(0, std::memory_order_relaxed);
+}
+
+bool MaintenancePool::Post(const std::string& key, Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!accepting || !keys.insert(key).second) {
+            return false;
+        }
+        tasks.emplace_back(key, std::move(task));
+        stats.maintenanceQueued.fetch_add(1, std::memory_order_relaxed);
+    }
+    cv.notify_one();
+    return true;
+}
+
+void MaintenancePool::Run(bool lowPriority) {
+    if (lowPriority) {
+        // Modo background do Windows: CPU, I/O e memória com prioridade baixa; worker de log e jogo passam na frente
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+    }
+
+    for (;;) {
+        std::pair<std::string, Task> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping.load(std::memory_order_relaxed) || !tasks.empty(); });
+            if (stopping.load(std::memory_order_relaxed)) {
+                break;
+            }
+            item = std::move(tasks.front());
+            tasks.pop_front();
+            stats.maintenanceQueued.fetch_sub(1, std::memory_order_relaxed);
+            stats.maintenanceActive.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = false;
+        try {
+            ok = item.second();
+        }
+        catch (...) {
+            ok = false;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        stats.maintenanceMicros.fetch_add((uint64_t)elapsed.count(), std::memory_order_relaxed);
+        (ok ? stats.maintenanceDone : stats.maintenanceFailed).fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            keys.erase(item.first);
+        }
+        stats.maintenanceActive.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    if (lowPriority) {
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+    }
+}
+
+// =======================
+// Função para carregar as configurações do arquivo INI de log se nao existir cria um novo
+// =======================
+void LogSystem::LoadConfig(const std::string& filename) {
+    try {
+        fs::path configDir = fs::current_path() / "Config";
+        if (!fs::exists(configDir)) {
+            fs::create_directory(configDir);
+        }
+
+        fs::path configFile = configDir / filename;
+        if (!fs::exists(configFile)) {
+            std::ofstream ini(configFile);
+            if (!ini.is_open()) {
+                Error("Não foi possível criar o arquivo de configuração: " + configFile.string());
+                return;
+            }
+
+            ini << "[Log]\n";
+            ini << "# Quantos dias os arquivos de log devem ser mantidos antes de serem compactados/excluídos\n";
+            ini << "retentionDays=7\n\n";
+
+            ini << "# Tamanho máximo (em bytes) de cada arquivo de log antes de rotacionar\n";
+            ini << "# Exemplo: 1048576 = 1 MB, 5242880 = 5 MB\n";
+            ini << "maxLogSize=1048576\n\n";
+
+            ini << "# Modo de compressão dos logs antigos:\n";
+            ini << "# none = não compacta, apenas deleta\n";
+            ini << "# file = compacta cada arquivo individualmente\n";
+            ini << "# day  = compacta todos os arquivos de um mesmo dia em um único .zip\n";
+            ini << "compressMode=day\n\n";
+
+            ini << "# Compactação dos modos file/day: nível do deflate (0 = sem compressão, 1 = mais rápido,\n";
+            ini << "# 9 = menor arquivo, 6 = padrão) e threads por arquivo/pacote (0 = automático, núcleos\n";
+            ini << "# divididos entre as threads de manutenção)\n";
+            ini << "compressLevel=6\n";
+            ini << "compressThreads=0\n\n";
+
+            ini << "# Threads de manutenção (compactação, exclusão e upload dos logs antigos),\n";
+            ini << "# fora do worker de log. 0 = automático (metade dos núcleos, no máximo 4)\n";
+            ini << "maintenanceThreads=0\n\n";
+
+            ini << "# Prioridade das threads de manutenção:\n";
+            ini << "# low    = modo background do Windows, CPU e disco com prioridade baixa (padrão)\n";
+            ini << "# normal = prioridade normal\n";
+            ini << "maintenancePriority=low\n\n";
+
+            ini << "# Número máximo de linhas no RichEdit antes de limpar as antigas\n";
+            ini << "maxRichEditLines=10000\n\n";
+
+            ini << "# Atualizações por segundo de cada janela de log (1-240); as linhas entre\n";
+            ini << "# dois quadros são acrescentadas de uma vez\n";
+            ini << "displayFps=30\n\n";
+
+            ini << "# Habilitar logging assíncrono (recomendado)\n";
+            ini << "asyncLogging=true\n\n";
+
+            ini << "# Fila do logging assíncrono:\n";
+            ini << "# perThread = um anel por thread produtora (escala com muitas threads)\n";
+            ini << "# shared    = uma única fila MPMC compartilhada\n";
+            ini << "queueMode=perThread\n\n";
+
+            ini << "# Formatação adiada: a thread que loga só copia os argumentos,\n";
+            ini << "# o texto final é montado pelo worker (menor custo no hot path)\n";
+            ini << "deferredFormatting=true\n\n";
+
+            ini << "# Formato dos arquivos de log:\n";
+            ini << "# text   = texto legível (.log)\n";
+            ini << "# binary = segmento binário compacto (.lsb), converta com a ferramenta logdecode\n";
+            ini << "fileFormat=text\n\n";
+
+            ini << "# Escrita em lote no arquivo: um único WriteFile por lote\n";
+            ini << "# writeBatchBytes   = tamanho do lote em bytes (4096 - 16777216)\n";
+            ini << "# writeBatchDelayMs = tempo máximo que uma linha espera no lote (0 - 1000)\n";
+            ini << "writeBatchBytes=65536\n";
+            ini << "writeBatchDelayMs=10\n\n";
+
+            ini << "# Compressão dos segmentos na escrita:\n";
+            ini << "# none = sem compressão (padrão)\n";
+            ini << "# gzip = cada lote gravado já comprimido (.log.gz / .lsb.gz, leia com gzip -dc);\n";
+            ini << "#        dispensa a segunda passada do compressMode\n";
+            ini << "# compressionBlockKB = entrada de cada membro gzip independente (64 - 16384)\n";
+            ini << "segmentCompression=none\n";
+            ini << "compressionBlockKB=1024\n\n";
+
+            ini << "# Índice lateral de cada segmento (<segmento>.idx): intervalo de tempo, níveis e IPs\n";
+            ini << "# por bloco de indexBlockKB (4 - 4096), para buscas lerem só os blocos relevantes\n";
+            ini << "segmentIndex=true\n";
+            ini << "indexBlockKB=64\n\n";
+
+            ini << "# Rotação por tempo além do tamanho (maxLogSize):\n";
+            ini << "# daily  = um novo arquivo por dia (padrão)\n";
+            ini << "# hourly = também a cada hora cheia\n";
+            ini << "rotationInterval=daily\n\n";
+
+            ini << "# Escrita no arquivo:\n";
+            ini << "# buffered = lote em memória + WriteFile (padrão)\n";
+            ini << "# mapped   = segmento mapeado em memória, registros copiados direto para o arquivo\n";
+            ini << "# overlapped = WriteFile assíncrono, o worker não espera o disco\n";
+            ini << "fileWriter=buffered\n\n";
+
+            ini << "# Precisão do timestamp das linhas de log\n";
+            ini << "# s  = [YYYY-MM-DD HH:MM:SS]\n";
+            ini << "# ms = [YYYY-MM-DD HH:MM:SS.mmm] (padrão)\n";
+            ini << "# us = [YYYY-MM-DD HH:MM:SS.uuuuuu]\n";
+            ini << "timestampPrecision=ms\n\n";
+
+            ini << "# Escape de msg/extra antes de gravar (texto de jogador não quebra nem forja linhas)\n";
+            ini << "# control = \\r, \\n, \\t e demais controles viram sequências de escape (padrão)\n";
+            ini << "# utf8    = control + bytes fora de UTF-8 válido viram \\xHH\n";
+            ini << "# none    = grava como recebido\n";
+            ini << "messageEscape=control\n\n";
+
+            ini << "# Modo headless (sem GUI, apenas arquivo)\n";
+            ini << "headlessMode=false\n\n";
+
+            ini << "# Gravador de voo: guarda os últimos registros de cada thread em todos os níveis\n";
+            ini << "# (inclusive Trace/Debug desabilitados) e grava em Log/flight_YYYY-MM-DD.log\n";
+            ini << "# a cada Error e no encerramento\n";
+            ini << "flightRecorder=false\n\n";
+
+            ini << "# Em crash (exceção não tratada ou abort), grava no arquivo de log o que\n";
+            ini << "# ainda estava em memória e nas filas antes do processo terminar\n";
+            ini << "crashHandler=true\n\n";
+
+            ini << "[Backup]\n";
+            ini << "# Define se os arquivos compactados devem ser enviados para FTP\n";
+            ini << "# true = habilita envio\n";
+            ini << "# false = desabilita envio (padrão)\n";
+            ini << "uploadBackup=false\n\n";
+
+            ini << "# Endereço do servidor FTP\n";
+            ini << "ftpServer=ftp.meuservidor.com\n\n";
+
+            ini << "# Usuário para login no FTP\n";
+            ini << "ftpUser=usuario\n\n";
+
+            ini << "# Senha do usuário FTP (será criptografada automaticamente)\n";
+            ini << "ftpPass=\n\n";
+
+            ini << "# Pasta remota no servidor FTP onde os arquivos serão armazenhados\n";
+            ini << "# Exemplo: /backup/\n";
+            ini << "ftpPath=/backup/\n\n";
+
+            ini << "# Destino do upload: ftp (servidor acima) ou directory (cópia para uma pasta local/de rede)\n";
+            ini << "uploadTransport=ftp\n\n";
+
+            ini << "# Pasta de destino com uploadTransport=directory (ex.: \\\\nas\\backup\\logs)\n";
+            ini << "uploadDirectory=\n\n";
+
+            ini << "# Uploads em paralelo (1-8), cada um com sua própria conexão\n";
+            ini << "uploadThreads=2\n\n";
 
-            ini << "# Senha do usuário FTP (será criptografada automaticamente)\n";
-            ini << "ftpPass=\n\n";
+            ini << "# Limite de banda em KB/s somando todos os uploads (0 = sem limite)\n";
+            ini << "uploadBandwidthKB=0\n\n";
 
-            ini << "# Pasta remota no servidor FTP onde os arquivos serão armazenhados\n";
-            ini << "# Exemplo: /backup/\n";
-            ini << "ftpPath=/backup/\n";
+            ini << "# Espera antes da primeira nova tentativa de um upload que falhou, em segundos;\n";
+            ini << "# dobra a cada falha até 30 minutos. O envio continua de onde parou\n";
+            ini << "uploadRetrySeconds=15\n";
 
             ini.close();
             Info("Arquivo de configuração criado: " + configFile.string());
@@ -523,20 +2391,176 @@ void LogSystem::LoadConfig(const std::string& filename) {
             compressMode = "day";
         }
 
+        // compressLevel / compressThreads
+        GetPrivateProfileString("Log", "compressLevel", "6", tempbuffer, 512, configFile.string().c_str());
+        compressLevel = (std::clamp)(atoi(tempbuffer), 0, 9);
+
+        GetPrivateProfileString("Log", "compressThreads", "0", tempbuffer, 512, configFile.string().c_str());
+        compressThreads = (std::clamp)(atoi(tempbuffer), 0, 64);
+
+        // maintenanceThreads (0 = automático)
+        GetPrivateProfileString("Log", "maintenanceThreads", "0", tempbuffer, 512, configFile.string().c_str());
+        maintenanceThreads = (std::clamp)(atoi(tempbuffer), 0, MAINTENANCE_MAX_THREADS);
+
+        // maintenancePriority
+        GetPrivateProfileString("Log", "maintenancePriority", "low", tempbuffer, 512, configFile.string().c_str());
+        maintenanceLowPriority = true;
+        if (_stricmp(tempbuffer, "normal") == 0) {
+            maintenanceLowPriority = false;
+        }
+        else if (_stricmp(tempbuffer, "low") != 0) {
+            Warning("maintenancePriority inválido '" + std::string(tempbuffer) + "', usando 'low'");
+        }
+
         // maxRichEditLines
         GetPrivateProfileString("Log", "maxRichEditLines", "10000", tempbuffer, 512, configFile.string().c_str());
-        maxRichEditLines = atoi(tempbuffer);
-        if (maxRichEditLines < 100) maxRichEditLines = 100;
-        if (maxRichEditLines > 100000) maxRichEditLines = 100000;
+        maxRichEditLines = (std::clamp)(atoi(tempbuffer), 100, 100000);
+
+        // displayFps
+        GetPrivateProfileString("Log", "displayFps", "30", tempbuffer, 512, configFile.string().c_str());
+        displayFps = (std::clamp)(atoi(tempbuffer), 1, 240);
 
         // asyncLogging
         GetPrivateProfileString("Log", "asyncLogging", "true", tempbuffer, 512, configFile.string().c_str());
         asyncLogging = (_stricmp(tempbuffer, "true") == 0);
 
+        // queueMode
+        GetPrivateProfileString("Log", "queueMode", "perThread", tempbuffer, 512, configFile.string().c_str());
+        if (_stricmp(tempbuffer, "shared") == 0) {
+            queueMode = QueueMode::Shared;
+        }
+        else {
+            if (_stricmp(tempbuffer, "perThread") != 0) {
+                Warning("queueMode inválido '" + std::string(tempbuffer) + "', usando 'perThread'");
+            }
+            queueMode = QueueMode::PerThread;
+        }
+
+        // deferredFormatting
+        GetPrivateProfileString("Log", "deferredFormatting", "true", tempbuffer, 512, configFile.string().c_str());
+        deferredFormatting.store(_stricmp(tempbuffer, "true") == 0, std::memory_order_relaxed);
+
+        // fileFormat
+        GetPrivateProfileString("Log", "fileFormat", "text", tempbuffer, 512, configFile.string().c_str());
+        FileFormat newFormat = FileFormat::Text;
+        if (_stricmp(tempbuffer, "binary") == 0) {
+            newFormat = FileFormat::Binary;
+        }
+        else if (_stricmp(tempbuffer, "text") != 0) {
+            Warning("fileFormat inválido '" + std::string(tempbuffer) + "', usando 'text'");
+        }
+        SetFileFormat(newFormat);
+
+        // writeBatchBytes / writeBatchDelayMs
+        GetPrivateProfileString("Log", "writeBatchBytes", "65536", tempbuffer, 512, configFile.string().c_str());
+        size_t batchBytes = (size_t)atoi(tempbuffer);
+        if (batchBytes < 4096) batchBytes = 4096;
+        if (batchBytes > 16777216) batchBytes = 16777216;
+
+        GetPrivateProfileString("Log", "writeBatchDelayMs", "10", tempbuffer, 512, configFile.string().c_str());
+        int batchDelay = atoi(tempbuffer);
+        if (batchDelay < 0) batchDelay = 0;
+        if (batchDelay > 1000) batchDelay = 1000;
+
+        // segmentCompression / compressionBlockKB
+        GetPrivateProfileString("Log", "segmentCompression", "none", tempbuffer, 512, configFile.string().c_str());
+        bool compression = false;
+        if (_stricmp(tempbuffer, "gzip") == 0) {
+            compression = true;
+        }
+        else if (_stricmp(tempbuffer, "none") != 0) {
+            Warning("segmentCompression inválido '" + std::string(tempbuffer) + "', usando 'none'");
+        }
+
+        GetPrivateProfileString("Log", "compressionBlockKB", "1024", tempbuffer, 512, configFile.string().c_str());
+        size_t blockBytes = (size_t)(std::clamp)(atoi(tempbuffer), 64, 16384) * 1024;
+        SetSegmentCompression(compression, blockBytes);
+
+        // segmentIndex / indexBlockKB
+        GetPrivateProfileString("Log", "segmentIndex", "true", tempbuffer, 512, configFile.string().c_str());
+        bool index = (_stricmp(tempbuffer, "true") == 0);
+        GetPrivateProfileString("Log", "indexBlockKB", "64", tempbuffer, 512, configFile.string().c_str());
+        SetSegmentIndex(index, (size_t)(std::clamp)(atoi(tempbuffer), 4, 4096) * 1024);
+
+        // rotationInterval
+        GetPrivateProfileString("Log", "rotationInterval", "daily", tempbuffer, 512, configFile.string().c_str());
+        RotationInterval interval = RotationInterval::Daily;
+        if (_stricmp(tempbuffer, "hourly") == 0) {
+            interval = RotationInterval::Hourly;
+        }
+        else if (_stricmp(tempbuffer, "daily") != 0) {
+            Warning("rotationInterval inválido '" + std::string(tempbuffer) + "', usando 'daily'");
+        }
+
+        // timestampPrecision
+        GetPrivateProfileString("Log", "timestampPrecision", "ms", tempbuffer, 512, configFile.string().c_str());
+        if (_stricmp(tempbuffer, "s") == 0) {
+            timestampPrecision.store(TimestampPrecision::Seconds, std::memory_order_relaxed);
+        }
+        else if (_stricmp(tempbuffer, "us") == 0) {
+            timestampPrecision.store(TimestampPrecision::Microseconds, std::memory_order_relaxed);
+        }
+        else {
+            if (_stricmp(tempbuffer, "ms") != 0) {
+                Warning("timestampPrecision inválido '" + std::string(tempbuffer) + "', usando 'ms'");
+            }
+            timestampPrecision.store(TimestampPrecision::Milliseconds, std::memory_order_relaxed);
+        }
+
+        // messageEscape
+        GetPrivateProfileString("Log", "messageEscape", "control", tempbuffer, 512, configFile.string().c_str());
+        if (_stricmp(tempbuffer, "utf8") == 0) {
+            messageEscape.store(Segment::EscapeMode::Utf8, std::memory_order_relaxed);
+        }
+        else if (_stricmp(tempbuffer, "none") == 0) {
+            messageEscape.store(Segment::EscapeMode::None, std::memory_order_relaxed);
+        }
+        else {
+            if (_stricmp(tempbuffer, "control") != 0) {
+                Warning("messageEscape inválido '" + std::string(tempbuffer) + "', usando 'control'");
+            }
+            messageEscape.store(Segment::EscapeMode::Control, std::memory_order_relaxed);
+        }
+
+        // fileWriter
+        GetPrivateProfileString("Log", "fileWriter", "buffered", tempbuffer, 512, configFile.string().c_str());
+        FileWriter writer = FileWriter::Buffered;
+        if (_stricmp(tempbuffer, "mapped") == 0) {
+            writer = FileWriter::Mapped;
+        }
+        else if (_stricmp(tempbuffer, "overlapped") == 0) {
+            writer = FileWriter::Overlapped;
+        }
+        else if (_stricmp(tempbuffer, "buffered") != 0) {
+            Warning("fileWriter inválido '" + std::string(tempbuffer) + "', usando 'buffered'");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(fileMutex);
+            fileWriter = writer;
+            rotationInterval = interval;
+            nextTimedRotation = ComputeNextTimedRotation();
+            writeBatchBytes = batchBytes;
+            writeBatchDelayMs = batchDelay;
+            writeBuffer.reserve(writeBatchBytes + 4096);
+            for (auto& slot : overlappedSlots) {
+                if (!slot.inFlight) slot.buffer.reserve(writeBatchBytes + 4096);
+            }
+        }
+
         // headlessMode
         GetPrivateProfileString("Log", "headlessMode", "false", tempbuffer, 512, configFile.string().c_str());
         headlessMode = (_stricmp(tempbuffer, "true") == 0);
 
+        // flightRecorder
+        GetPrivateProfileString("Log", "flightRecorder", "false", tempbuffer, 512, configFile.string().c_str());
+        flightRecorderEnabled = (_stricmp(tempbuffer, "true") == 0);
+        UpdateActiveLevels();
+
+        // crashHandler
+        GetPrivateProfileString("Log", "crashHandler", "true", tempbuffer, 512, configFile.string().c_str());
+        crashHandler = (_stricmp(tempbuffer, "true") == 0);
+
         GetPrivateProfileString("Backup", "uploadBackup", "false", tempbuffer, 512, configFile.string().c_str());
         uploadBackup = (_stricmp(tempbuffer, "true") == 0);
 
@@ -562,6 +2586,27 @@ void LogSystem::LoadConfig(const std::string& filename) {
             ftpPath += '/';
         }
 
+        // Fila de upload
+        GetPrivateProfileString("Backup", "uploadTransport", "ftp", tempbuffer, 512, configFile.string().c_str());
+        std::string transport = tempbuffer;
+        if (transport != "ftp" && transport != "directory") {
+            Warning("uploadTransport inválido '" + transport + "', usando 'ftp'");
+            transport = "ftp";
+        }
+        uploadTransport = transport;
+
+        GetPrivateProfileString("Backup", "uploadDirectory", "", tempbuffer, 512, configFile.string().c_str());
+        uploadDirectory = tempbuffer;
+
+        GetPrivateProfileString("Backup", "uploadThreads", "2", tempbuffer, 512, configFile.string().c_str());
+        uploadThreads = (std::clamp)(atoi(tempbuffer), 1, Upload::MAX_THREADS);
+
+        GetPrivateProfileString("Backup", "uploadBandwidthKB", "0", tempbuffer, 512, configFile.string().c_str());
+        uploadBandwidthKB = (std::clamp)(atoi(tempbuffer), 0, 1024 * 1024);
+
+        GetPrivateProfileString("Backup", "uploadRetrySeconds", "15", tempbuffer, 512, configFile.string().c_str());
+        uploadRetrySeconds = (std::clamp)(atoi(tempbuffer), 1, 3600);
+
         Info("Configurações carregadas: retention=" + std::to_string(retentionDays) + 
                 "d, maxSize=" + std::to_string(maxLogSize) + 
                 "b, compress=" + compressMode);
@@ -574,8 +2619,27 @@ void LogSystem::LoadConfig(const std::string& filename) {
         compressMode = "day";
         uploadBackup = false;
         maxRichEditLines = 10000;
+        displayFps = 30;
         asyncLogging = true;
+        queueMode = QueueMode::PerThread;
+        deferredFormatting.store(true, std::memory_order_relaxed);
+        timestampPrecision.store(TimestampPrecision::Milliseconds, std::memory_order_relaxed);
+        messageEscape.store(Segment::EscapeMode::Control, std::memory_order_relaxed);
+        SetFileFormat(FileFormat::Text);
+        SetSegmentCompression(false, Compress::DEFAULT_BLOCK_BYTES);
+        SetSegmentIndex(true, Index::DEFAULT_BLOCK_BYTES);
         headlessMode = false;
+        flightRecorderEnabled = false;
+        crashHandler = true;
+        maintenanceThreads = 0;
+        maintenanceLowPriority = true;
+        compressLevel = 6;
+        compressThreads = 0;
+        uploadTransport = "ftp";
+        uploadThreads = 2;
+        uploadBandwidthKB = 0;
+        uploadRetrySeconds = 15;
+        UpdateActiveLevels();
     }
 }
 
@@ -661,126 +2725,425 @@ std::string LogSystem::LevelToString(LogLevel level) {
 }
 
 // =======================
-// Função para retornar o timestamp atual no formato [YYYY-MM-DD HH:MM:SS]
+// Função para retornar a data atual no formato YYYY-MM-DD
 // =======================
-std::string LogSystem::GetTimestamp() {
+std::string LogSystem::GetDate() {
     auto t = std::time(nullptr);
     std::tm tm;
     localtime_s(&tm, &t);
     std::ostringstream oss;
-    oss << "[" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "]";
+    oss << std::put_time(&tm, "%Y-%m-%d");
     return oss.str();
 }
 
 // =======================
-// Função para retornar a data atual no formato YYYY-MM-DD
+// Tick do LogClock correspondente à próxima meia-noite local (troca de dia)
 // =======================
-std::string LogSystem::GetDate() {
-    auto t = std::time(nullptr);
+// Deslocamento local - UTC em segundos, para o dreno de emergência montar a hora sem localtime
+int64_t LogSystem::ComputeUtcOffset() const {
+    time_t t = std::time(nullptr);
     std::tm tm;
     localtime_s(&tm, &t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d");
-    return oss.str();
+    return (int64_t)_mkgmtime(&tm) - (int64_t)t;
+}
+
+uint64_t LogSystem::ComputeNextMidnightTick() const {
+    time_t t = std::time(nullptr);
+    std::tm tm;
+    localtime_s(&tm, &t);
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_mday += 1;
+    tm.tm_isdst = -1;
+    uint64_t midnightMicros = (uint64_t)std::mktime(&tm) * 1000000ull;
+    return clock.FromWallMicros(midnightMicros);
+}
+
+// =======================
+// Função para escrever os logs em arquivo com rotação baseada em tamanho - otimizado
+// =======================
+void LogSystem::WriteToFile(const std::string& text, uint64_t tick, LogLevel level, unsigned int ip) {
+    RotateLogFileIfNeeded(tick);
+
+    if (IsLogFileOpen()) {
+        IndexRecord(tick, level, ip);
+        AppendToFile(text, tick);  // text já termina em \r\n
+    }
 }
 
 // =======================
-// Função para adicionar texto colorido ao controle RichEdit
+// Função para escrever um registro no segmento binário (fileFormat=binary)
 // =======================
-void LogSystem::AppendColoredText(HWND target, const std::string& text, COLORREF textColor) {
-    if (!target || !IsWindow(target)) {
+void LogSystem::WriteBinaryRecord(const LogMessage& msg) {
+    RotateLogFileIfNeeded(msg.tick);
+
+    if (!IsLogFileOpen()) {
         return;
     }
 
-    CHARRANGE cr{ -1, -1 };
-    SendMessageA(target, EM_EXSETSEL, 0, (LPARAM)&cr);
+    IndexRecord(msg.tick, msg.level, msg.ip);
+    uint64_t micros = clock.ToWallMicros(msg.tick);
+
+    // Mensagens de Log() costumam ser literais repetidos: entram na tabela de strings.
+    // As de LogFormat<"..."> já vêm com os argumentos aplicados e vão literais.
+    // msg/extra com bytes a escapar são gravados já escapados, como no modo texto.
+    std::string_view message = msg.Message();
+    std::string_view extra = msg.Extra();
+    Segment::EscapeMode escape = messageEscape.load(std::memory_order_relaxed);
+    if (!Segment::IsClean(message, escape)) {
+        escapedMessage.clear();
+        Segment::AppendEscaped(escapedMessage, message, escape);
+        message = escapedMessage;
+    }
+    if (!Segment::IsClean(extra, escape)) {
+        escapedExtra.clear();
+        Segment::AppendEscaped(escapedExtra, extra, escape);
+        extra = escapedExtra;
+    }
 
-    CHARFORMAT2A cf{};
-    cf.cbSize = sizeof(CHARFORMAT2A);
-    cf.dwMask = CFM_COLOR | CFM_BACKCOLOR | CFM_FACE | CFM_SIZE;
-    cf.crTextColor = textColor;
-    cf.crBackColor = RGB(20, 20, 20);
-    strcpy_s(cf.szFaceName, "Consolas");
-    cf.yHeight = 200;
+    segmentBuffer.clear();
+    segmentEncoder.Encode((uint8_t)msg.level, micros, msg.ip, message, extra,
+        msg.formatId == 0, segmentBuffer);
+    AppendToFile(segmentBuffer, msg.tick);
 
-    SendMessageA(target, EM_SETCHARFORMAT, SCF_SELECTION, (LPARAM)&cf);
-    SendMessageA(target, EM_REPLACESEL, FALSE, (LPARAM)text.c_str());
+    if (msg.fullText.empty()) {
+        stats.RecordLog(msg.level, segmentBuffer.size());
+    }
+}
 
-    SendMessageA(target, EM_SETSEL, -1, -1);
-    SendMessageA(target, EM_SCROLLCARET, 0, 0);
+// Rotação por tamanho usando o tamanho mantido em memória (sem consultar o disco a cada linha)
+// e por hora quando rotationInterval=hourly. A troca de dia continua em ProcessLogMessage.
+void LogSystem::RotateLogFileIfNeeded(uint64_t tick) {
+    if (!IsLogFileOpen()) {
+        OpenLogFile();
+        return;
+    }
+
+    if (currentFileSize >= maxLogSize || tick >= nextTimedRotation) {
+        fileIndex++;
+        stats.filesRotated.fetch_add(1, std::memory_order_relaxed);
+        SwitchToNextSegment();
+    }
+}
+
+// Tick do LogClock da próxima hora cheia (rotationInterval=hourly); comparado direto com LogMessage::tick
+uint64_t LogSystem::ComputeNextTimedRotation() const {
+    if (rotationInterval != RotationInterval::Hourly) {
+        return UINT64_MAX;
+    }
+
+    // Próxima hora cheia no horário local
+    time_t t = std::time(nullptr);
+    std::tm tm;
+    localtime_s(&tm, &t);
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_hour += 1;
+    tm.tm_isdst = -1;
+    return clock.FromWallMicros((uint64_t)std::mktime(&tm) * 1000000ull);
 }
 
 // =======================
-// Função para escrever os logs em arquivo com rotação baseada em tamanho - otimizado
+// Escrita em lote: chamadas com fileMutex adquirido
 // =======================
-void LogSystem::WriteToFile(const std::string& text) {
-    if (!logFile.is_open()) {
-        OpenLogFile();
+void LogSystem::AppendToFile(std::string_view data, uint64_t tick) {
+    if (!HasPendingWrites()) {
+        writeBufferSince = std::chrono::steady_clock::now();
     }
 
-    std::error_code ec;
-    std::string filename = logDir + "/server_" + currentDate + "_" + std::to_string(fileIndex) + ".log";
-    auto size = fs::file_size(filename, ec);
+    currentFileSize += data.size();
 
-    if (!ec && size >= maxLogSize) {
-        fileIndex++;
-        stats.filesRotated.fetch_add(1, std::memory_order_relaxed);
-        OpenLogFile();
+    if (mappedView.IsMapped()) {
+        if (mappedView.Append(data) || (mappedView.Grow(logFile, data.size()) && mappedView.Append(data))) {
+            // Na view o registro já está no cache de páginas do arquivo
+            if (tick != 0) {
+                writeBufferTicks.assign(1, tick);
+                RecordDiskLatency(writeBufferTicks);
+                writeBufferTicks.clear();
+            }
+            return;
+        }
+        // Sem espaço de endereçamento para crescer: trunca e segue com WriteFile no fim do arquivo
+        mappedView.Close(logFile);
     }
 
-    if (logFile.is_open()) {
-        logFile << text << "\n";  // Usar \n ao invés de std::endl
-            
-        // Flush periódico usando atomic counter (thread-safe)
-        int currentCount = flushCounter.fetch_add(1, std::memory_order_relaxed);
-        if (currentCount >= 10) {
-            logFile.flush();
-            flushCounter.store(0, std::memory_order_relaxed);
+    writeBuffer.append(data);
+    if (tick != 0) {
+        writeBufferTicks.push_back(tick);
+    }
+
+    // Sem worker (modo síncrono) ninguém faria o flush por tempo
+    if (writeBuffer.size() >= writeBatchBytes || !asyncLogging) {
+        FlushWriteBuffer();
+    }
+}
+
+void LogSystem::FlushWriteBuffer() {
+    if (writeBuffer.empty() || !IsLogFileOpen()) {
+        return;
+    }
+
+    if (gzipStream.IsActive()) {
+        // O lote vira deflate terminado em sync flush: o arquivo é decodificável até aqui
+        compressBuffer.clear();
+        gzipStream.Compress(writeBuffer, compressBuffer);
+        stats.liveCompressedIn.fetch_add(writeBuffer.size(), std::memory_order_relaxed);
+        stats.liveCompressedOut.fetch_add(compressBuffer.size(), std::memory_order_relaxed);
+        std::swap(writeBuffer, compressBuffer);
+    }
+
+    if (overlappedFile) {
+        SubmitOverlappedWrite();
+        return;
+    }
+
+    const char* data = writeBuffer.data();
+    size_t remaining = writeBuffer.size();
+    while (remaining > 0) {
+        DWORD written = 0;
+        DWORD chunk = (DWORD)(std::min)(remaining, (size_t)(1u << 30));
+        if (!WriteFile(logFile, data, chunk, &written, nullptr) || written == 0) {
+            break;  // Disco cheio/erro: descarta o lote em vez de travar o worker
+        }
+        stats.fileWrites.fetch_add(1, std::memory_order_relaxed);
+        data += written;
+        remaining -= written;
+    }
+
+    RecordDiskLatency(writeBufferTicks);
+    writeBuffer.clear();
+    writeBufferTicks.clear();
+}
+
+// =======================
+// fileWriter=overlapped: cada lote vira um WriteFile assíncrono com offset explícito e o
+// worker segue processando. Com todos os slots em voo, espera o mais antigo (writeStalls).
+// O NTFS pode completar de forma síncrona escritas que estendem o arquivo; nesse caso
+// WriteFile retorna TRUE e o slot é liberado na hora, como no modo buffered.
+// =======================
+void LogSystem::SubmitOverlappedWrite() {
+    OverlappedWriteSlot& slot = overlappedSlots[nextOverlappedSlot];
+    nextOverlappedSlot = (nextOverlappedSlot + 1) % OVERLAPPED_WRITE_SLOTS;
+
+    if (slot.inFlight && !ReapOverlappedWrite(slot, false)) {
+        stats.writeStalls.fetch_add(1, std::memory_order_relaxed);
+        ReapOverlappedWrite(slot, true);
+    }
+
+    if (!slot.event.IsValid()) {
+        slot.event = WinHandle(CreateEventA(nullptr, TRUE, FALSE, nullptr));
+    }
+
+    std::swap(slot.buffer, writeBuffer);
+    std::swap(slot.ticks, writeBufferTicks);
+    writeBuffer.clear();
+    writeBufferTicks.clear();
+
+    slot.overlapped = OVERLAPPED{};
+    slot.overlapped.Offset = (DWORD)(writeOffset & 0xFFFFFFFF);
+    slot.overlapped.OffsetHigh = (DWORD)(writeOffset >> 32);
+    slot.overlapped.hEvent = slot.event;
+
+    DWORD size = (DWORD)slot.buffer.size();
+    writeOffset += size;
+    stats.fileWrites.fetch_add(1, std::memory_order_relaxed);
+
+    if (WriteFile(logFile, slot.buffer.data(), size, nullptr, &slot.overlapped)) {
+        RecordDiskLatency(slot.ticks);  // Completou de forma síncrona
+        slot.buffer.clear();
+        slot.ticks.clear();
+    }
+    else if (GetLastError() == ERROR_IO_PENDING) {
+        slot.inFlight = true;
+    }
+    else {
+        slot.buffer.clear();  // Disco cheio/erro: descarta o lote
+        slot.ticks.clear();
+    }
+}
+
+// true se o slot terminou (com sucesso ou erro) e pode ser reutilizado
+bool LogSystem::ReapOverlappedWrite(OverlappedWriteSlot& slot, bool wait) {
+    if (!slot.inFlight) {
+        return true;
+    }
+
+    DWORD transferred = 0;
+    if (GetOverlappedResult(logFile, &slot.overlapped, &transferred, wait ? TRUE : FALSE)) {
+        RecordDiskLatency(slot.ticks);
+    }
+    else if (GetLastError() == ERROR_IO_INCOMPLETE) {
+        return false;
+    }
+
+    slot.inFlight = false;
+    slot.buffer.clear();
+    slot.ticks.clear();
+    return true;
+}
+
+void LogSystem::ReapOverlappedWrites(bool wait) {
+    for (auto& slot : overlappedSlots) {
+        ReapOverlappedWrite(slot, wait);
+    }
+}
+
+void LogSystem::RecordDiskLatency(const std::vector<uint64_t>& ticks) {
+    if (ticks.empty()) {
+        return;
+    }
+
+    uint64_t now = LogClock::Now();
+    for (uint64_t tick : ticks) {
+        stats.diskLatency.Record(now > tick ? (now - tick) / 1000 : 0);
+    }
+}
+
+void LogSystem::FlushPendingWrites(bool force) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (overlappedFile) {
+        ReapOverlappedWrites(false);
+    }
+
+    if (!HasPendingWrites()) {
+        return;
+    }
+
+    if (force || std::chrono::steady_clock::now() - writeBufferSince >= std::chrono::milliseconds(writeBatchDelayMs)) {
+        FlushWriteBuffer();
+        mappedView.FlushDirty();
+    }
+}
+
+// Fecha o segmento atual: grava o lote pendente ou, no modo mapeado, trunca no tamanho real
+void LogSystem::CloseLogFile() {
+    if (gzipStream.IsActive()) {
+        // Último lote comprimido e trailer do membro aberto: o segmento fecha pronto para arquivar
+        FlushWriteBuffer();
+        gzipStream.Finish(writeBuffer);
+        gzipStream.End();
+    }
+    FlushWriteBuffer();
+    if (IsLogFileOpen()) {
+        if (overlappedFile) {
+            ReapOverlappedWrites(true);  // Os buffers em voo não podem ser liberados antes do I/O
+        }
+        mappedView.Close(logFile);
+
+        CloseSegmentIndex();
+
+        // Tamanho final no disco (truncado, comprimido) para o manifesto
+        LARGE_INTEGER size;
+        if (!currentSegmentName.empty() && GetFileSizeEx(logFile, &size)) {
+            manifest.CloseSegment(currentSegmentName, (uint64_t)size.QuadPart);
+        }
+    }
+    logFile = WinHandle();
+    overlappedFile = false;
+    currentSegmentName.clear();
+}
+
+// Troca o modo de escrita em tempo de execução; o segmento atual é fechado e reaberto no novo modo
+void LogSystem::SetFileWriter(FileWriter writer) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (fileWriter != writer) {
+        fileWriter = writer;
+        CloseLogFile();
+    }
+}
+
+// =======================
+// Adiciona um arquivo ao ZIP aberto. O stream deflate é montado pelo ParallelDeflater e gravado cru
+// (zipCloseFileInZipRaw64 recebe tamanho e CRC); segmentos .gz entram sem deflate.
+// false em falha de leitura/escrita ou encerramento (o ZIP deve ser descartado)
+// =======================
+bool LogSystem::AddFileToZip(zipFile zf, const std::string& file, Compress::ParallelDeflater& deflater) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        Warning("Não foi possível abrir arquivo para compactação: " + file);
+        return true;    // Arquivo sumiu/travado: o resto do pacote segue
+    }
+
+    std::error_code ec;
+    uint64_t fileSize = fs::file_size(file, ec);
+    int zip64 = (!ec && fileSize >= 0xFFFFFFFFull) ? 1 : 0;
+    bool stored = fs::path(file).extension() == Compress::FILE_EXTENSION;
+
+    zip_fileinfo zi = {};
+    if (zipOpenNewFileInZip2_64(zf, fs::path(file).filename().string().c_str(), &zi,
+        nullptr, 0, nullptr, 0, nullptr,
+        stored ? 0 : Z_DEFLATED, stored ? 0 : deflater.GetLevel(), stored ? 0 : 1, zip64) != ZIP_OK) {
+        Warning("Falha ao adicionar arquivo ao ZIP: " + file);
+        return false;
+    }
+
+    auto read = [&](char* buffer, size_t capacity) -> std::streamsize {
+        if (maintenance.StopRequested()) {
+            return -1;
+        }
+        in.read(buffer, (std::streamsize)capacity);
+        return in.bad() ? -1 : in.gcount();
+    };
+    auto write = [&](const char* data, size_t size) {
+        return zipWriteInFileInZip(zf, data, static_cast<unsigned int>(size)) == ZIP_OK;
+    };
+
+    if (stored) {
+        const size_t chunkSize = 1024 * 1024;
+        std::vector<char> buffer(chunkSize);
+        std::streamsize n;
+        while ((n = read(buffer.data(), buffer.size())) > 0) {
+            if (!write(buffer.data(), (size_t)n)) {
+                n = -1;
+                break;
+            }
         }
+        zipCloseFileInZip(zf);
+        return n == 0;
     }
+
+    uint64_t rawSize = 0;
+    unsigned long crc = 0;
+    bool ok = deflater.Deflate(read, write, rawSize, crc);
+    zipCloseFileInZipRaw64(zf, rawSize, crc);
+    return ok;
 }
 
 // =======================
 // Função para compactar um único arquivo
 // =======================
-bool LogSystem::CompressFile(const std::string& file) {
+bool LogSystem::CompressFile(const CleanupSettings& settings, const std::string& file) {
     try {
         std::string zipName = file + ".zip";
 
-        zipFile zf = zipOpen(zipName.c_str(), APPEND_STATUS_CREATE);
+        zipFile zf = zipOpen64(zipName.c_str(), APPEND_STATUS_CREATE);
         if (!zf) {
             Error("Falha ao criar ZIP: " + zipName);
             return false;
         }
 
-        zip_fileinfo zi = {};
+        Compress::ParallelDeflater deflater(settings.compressLevel, settings.compressThreads);
+        bool ok = AddFileToZip(zf, file, deflater);
 
-        if (zipOpenNewFileInZip(zf, fs::path(file).filename().string().c_str(), &zi,
-            nullptr, 0, nullptr, 0, nullptr,
-            Z_DEFLATED, Z_DEFAULT_COMPRESSION) != ZIP_OK) {
-            Error("Falha ao adicionar arquivo ao ZIP: " + file);
-            zipClose(zf, nullptr);
-            return false;
-        }
-
-        std::ifstream in(file, std::ios::binary);
-        if (!in.is_open()) {
-            Error("Não foi possível abrir arquivo para compactação: " + file);
-            zipCloseFileInZip(zf);
-            zipClose(zf, nullptr);
-            return false;
+        // O índice lateral vai junto no mesmo ZIP
+        std::string index = file + Index::FILE_EXTENSION;
+        if (ok && fs::exists(index)) {
+            ok = AddFileToZip(zf, index, deflater);
         }
+        zipClose(zf, nullptr);
 
-        const size_t chunkSize = 1024 * 1024;
-        std::vector<char> buffer(chunkSize);
-        while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
-            zipWriteInFileInZip(zf, buffer.data(), static_cast<unsigned int>(in.gcount()));
+        if (!ok) {
+            // ZIP incompleto é removido e o arquivo fica para a próxima limpeza
+            fs::remove(zipName);
+            if (maintenance.StopRequested()) {
+                Warning("Compactação interrompida pelo encerramento: " + file);
+            }
+            else {
+                Error("Falha ao compactar arquivo: " + file);
+            }
         }
-
-        zipCloseFileInZip(zf);
-        zipClose(zf, nullptr);
-            
-        return true;
+        return ok;
     }
     catch (const std::exception& e) {
         Error("Exceção em CompressFile: " + std::string(e.what()));
@@ -791,44 +3154,36 @@ bool LogSystem::CompressFile(const std::string& file) {
 // =======================
 // Função para compactar vários arquivos de um mesmo dia em um único ZIP
 // =======================
-bool LogSystem::CompressDayLogs(const std::string& day, const std::vector<std::string>& files) {
+bool LogSystem::CompressDayLogs(const CleanupSettings& settings, const std::string& day, const std::vector<std::string>& files) {
     try {
-        std::string zipName = logDir + "/logpack_" + day + ".zip";
+        std::string zipName = settings.logDir + "/logpack_" + day + ".zip";
 
-        zipFile zf = zipOpen(zipName.c_str(), APPEND_STATUS_CREATE);
+        zipFile zf = zipOpen64(zipName.c_str(), APPEND_STATUS_CREATE);
         if (!zf) {
             Error("Falha ao criar ZIP: " + zipName);
             return false;
         }
 
+        // Um deflater por pacote: as threads de compressão são reaproveitadas entre os arquivos do dia
+        Compress::ParallelDeflater deflater(settings.compressLevel, settings.compressThreads);
+        bool ok = true;
         for (const auto& file : files) {
-            zip_fileinfo zi = {};
-
-            if (zipOpenNewFileInZip(zf, fs::path(file).filename().string().c_str(), &zi,
-                nullptr, 0, nullptr, 0, nullptr,
-                Z_DEFLATED, Z_DEFAULT_COMPRESSION) != ZIP_OK) {
-                Warning("Falha ao adicionar arquivo ao ZIP: " + file);
-                continue;
-            }
-
-            std::ifstream in(file, std::ios::binary);
-            if (!in.is_open()) {
-                Warning("Não foi possível abrir arquivo para compactação: " + file);
-                zipCloseFileInZip(zf);
-                continue;
+            std::string index = file + Index::FILE_EXTENSION;
+            if (!AddFileToZip(zf, file, deflater) || (fs::exists(index) && !AddFileToZip(zf, index, deflater))) {
+                ok = false;
+                break;
             }
+        }
+        zipClose(zf, nullptr);
 
-            const size_t chunkSize = 1024 * 1024;
-            std::vector<char> buffer(chunkSize);
-            while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
-                zipWriteInFileInZip(zf, buffer.data(), static_cast<unsigned int>(in.gcount()));
+        if (!ok) {
+            // Encerrando ou falha de leitura/escrita: ZIP incompleto removido, arquivos do dia mantidos
+            fs::remove(zipName);
+            if (maintenance.StopRequested()) {
+                Warning("Compactação interrompida pelo encerramento: logpack_" + day + ".zip");
             }
-
-            zipCloseFileInZip(zf);
         }
-
-        zipClose(zf, nullptr);
-        return true;
+        return ok;
     }
     catch (const std::exception& e) {
         Error("Exceção em CompressDayLogs: " + std::string(e.what()));
@@ -837,49 +3192,90 @@ bool LogSystem::CompressDayLogs(const std::string& day, const std::vector<std::s
 }
 
 // =======================
-// Função para upload dos logs antigos via FTP
+// Transporte FTP da fila de upload. A conexão fica aberta entre arquivos da mesma thread;
+// Disconnect só na falha ou com a fila vazia
 // =======================
-bool LogSystem::UploadToFTP(const std::string& localFile, const std::string& server,
-    const std::string& user, const std::string& pass, const std::string& remotePath) {
-        
-    HINTERNET hInternet = nullptr;
-    HINTERNET hFtp = nullptr;
-    bool result = false;
+bool FtpTransport::Connect() {
+    if (connection) {
+        return true;
+    }
 
-    try {
-        hInternet = InternetOpenA("LogUploader", INTERNET_OPEN_TYPE_DIRECT, NULL, NULL, 0);
-        if (!hInternet) {
-            Error("Falha ao inicializar InternetOpen");
-            return false;
-        }
+    session = InternetOpenA("LogUploader", INTERNET_OPEN_TYPE_DIRECT, NULL, NULL, 0);
+    if (!session) {
+        return false;
+    }
 
-        hFtp = InternetConnectA(hInternet, server.c_str(), INTERNET_DEFAULT_FTP_PORT,
-            user.c_str(), pass.c_str(), INTERNET_SERVICE_FTP, 0, 0);
-            
-        if (!hFtp) {
-            Error("Falha ao conectar ao servidor FTP: " + server);
-            InternetCloseHandle(hInternet);
-            return false;
-        }
+    connection = InternetConnectA(session, server.c_str(), INTERNET_DEFAULT_FTP_PORT,
+        user.c_str(), pass.c_str(), INTERNET_SERVICE_FTP, 0, 0);
+    if (!connection) {
+        Disconnect();
+        return false;
+    }
+    return true;
+}
 
-        result = FtpPutFileA(hFtp, localFile.c_str(), remotePath.c_str(), FTP_TRANSFER_TYPE_BINARY, 0);
-            
-        if (result) {
-            Info("Upload concluído: " + remotePath);
+void FtpTransport::Disconnect() {
+    if (file) InternetCloseHandle(file);
+    if (connection) InternetCloseHandle(connection);
+    if (session) InternetCloseHandle(session);
+    file = nullptr;
+    connection = nullptr;
+    session = nullptr;
+}
+
+bool FtpTransport::RemoteSize(const std::string& name, uint64_t& size) {
+    WIN32_FIND_DATAA data;
+    HINTERNET find = FtpFindFirstFileA(connection, (remoteDir + name).c_str(), &data, INTERNET_FLAG_RELOAD, 0);
+    if (!find) {
+        return false;
+    }
+    InternetCloseHandle(find);
+    size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    return true;
+}
+
+bool FtpTransport::Begin(const std::string& name, uint64_t offset) {
+    std::string path = remoteDir + name;
+    if (offset == 0) {
+        file = FtpOpenFileA(connection, path.c_str(), GENERIC_WRITE, FTP_TRANSFER_TYPE_BINARY, 0);
+    }
+    else {
+        // APPE continua o .part do ponto em que o servidor parou (offset veio de RemoteSize)
+        if (!FtpCommandA(connection, TRUE, FTP_TRANSFER_TYPE_BINARY, ("APPE " + path).c_str(), 0, &file)) {
+            file = nullptr;
         }
-        else {
-            DWORD error = GetLastError();
-            Error("Falha no upload para FTP: " + remotePath + " (erro: " + std::to_string(error) + ")");
+    }
+    return file != nullptr;
+}
+
+bool FtpTransport::Write(const char* data, size_t size) {
+    while (size > 0) {
+        DWORD written = 0;
+        if (!InternetWriteFile(file, data, (DWORD)size, &written) || written == 0) {
+            return false;
         }
+        data += written;
+        size -= written;
     }
-    catch (const std::exception& e) {
-        Error("Exceção em UploadToFTP: " + std::string(e.what()));
-        result = false;
+    return true;
+}
+
+bool FtpTransport::End() {
+    if (!file) {
+        return false;
     }
+    BOOL ok = InternetCloseHandle(file);
+    file = nullptr;
+    return ok != FALSE;
+}
 
-    // Cleanup
-    if (hFtp) InternetCloseHandle(hFtp);
-    if (hInternet) InternetCloseHandle(hInternet);
+bool FtpTransport::Rename(const std::string& from, const std::string& to) {
+    std::string target = remoteDir + to;
+    if (FtpRenameFileA(connection, (remoteDir + from).c_str(), target.c_str())) {
+        return true;
+    }
 
-    return result;
+    // Alguns servidores não sobrescrevem no RNTO
+    FtpDeleteFileA(connection, target.c_str());
+    return FtpRenameFileA(connection, (remoteDir + from).c_str(), target.c_str()) != FALSE;
 }
@@ -4,6 +4,8 @@
 #include <windows.h>
 #include <string>
 #include <set>
+#include <deque>
+#include <functional>
 #include <fstream>
 #include <filesystem>
 #include <chrono>
@@ -24,161 +26,605 @@
 #include <atomic>
 #include <memory>
 #include <array>
+#include <string_view>
+#include <cstring>
+#include <algorithm>
+#include <future>
+#include <bit>
+#include <csignal>
+
+#include "LogSegment.h"
+#include "LogDisplay.h"
+#include "LogCrash.h"
+#include "LogCompress.h"
+#include "LogManifest.h"
+#include "LogUpload.h"
+#include "LogIndex.h"
 
 // Definio da macro para usar com CreateWindowExA
 #define MSFTEDIT_CLASSA "RICHEDIT50W"
 
+// Bytes de msg + extra guardados dentro do slot da fila; acima disso usa-se um buffer no heap
+#ifndef LOGSYSTEM_INLINE_PAYLOAD
+#define LOGSYSTEM_INLINE_PAYLOAD 192
+#endif
+
+// Registros guardados pelo gravador de voo de cada thread (potncia de 2; 128 bytes cada)
+#ifndef LOGSYSTEM_FLIGHT_RECORDER_SLOTS
+#define LOGSYSTEM_FLIGHT_RECORDER_SLOTS 4096
+#endif
+
+// Nvel mnimo compilado (mesma ordem de LogLevel). Chamadas LOG_* abaixo dele somem do binrio,
+// inclusive a avaliao dos argumentos. Ex.: /DLOGSYSTEM_MIN_LEVEL=2 remove Trace e Debug.
+#define LOGSYSTEM_LEVEL_TRACE   0
+#define LOGSYSTEM_LEVEL_DEBUG   1
+#define LOGSYSTEM_LEVEL_INFO    2
+#define LOGSYSTEM_LEVEL_WARNING 3
+#define LOGSYSTEM_LEVEL_ERROR   4
+#define LOGSYSTEM_LEVEL_QUEST   5
+#define LOGSYSTEM_LEVEL_PACKETS 6
+
+#ifndef LOGSYSTEM_MIN_LEVEL
+#define LOGSYSTEM_MIN_LEVEL LOGSYSTEM_LEVEL_TRACE
+#endif
+
 namespace WYD_Server {
 
     static constexpr int TARGET_COUNT = 2;
 	static constexpr int LOG_LEVEL_COUNT = 7;
     static constexpr size_t LOCK_FREE_QUEUE_SIZE = 8192; // Must be power of 2
-    static constexpr size_t STRING_POOL_SIZE = 32;
+    static constexpr size_t PRODUCER_RING_SIZE = 1024;   // Must be power of 2 (anel por thread)
+    static constexpr size_t WORKER_DRAIN_BATCH = 256;    // Mensagens por anel em cada passada do worker
+    static constexpr size_t SINK_QUEUE_SIZE = 4096;      // Must be power of 2 (fila de cada sink)
+    static constexpr int SINK_YIELD_COUNT = 64;          // Passadas vazias com yield antes do sink estacionar
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr size_t MAPPED_SEGMENT_SLACK = 1 << 20;  // Folga do segmento mapeado alm de maxLogSize
+    static constexpr size_t OVERLAPPED_WRITE_SLOTS = 4;      // Lotes em voo no modo fileWriter=overlapped
+    static constexpr int WORKER_SPIN_COUNT = 2000;       // Passadas vazias com pause antes de ceder a CPU
+    static constexpr int WORKER_YIELD_COUNT = 64;        // Passadas vazias com yield antes de estacionar
+    static constexpr int WORKER_PARK_TIMEOUT_MS = 100;   // Worker estacionado acorda sozinho para stats/limpeza
+    static constexpr int QUEUE_FULL_WAIT_MS = 50;        // Fila cheia: produtor espera o worker antes de gravar na prpria thread
+    static constexpr size_t CRASH_DRAIN_RINGS = 256;     // Anis por thread visveis ao dreno de emergncia
+    static constexpr int CRASH_HALT_WAIT_MS = 250;       // Dreno de emergncia: espera o worker largar as filas
+    static constexpr int MAINTENANCE_MAX_THREADS = 16;   // Teto de maintenanceThreads
+    static constexpr size_t LOG_INLINE_PAYLOAD = LOGSYSTEM_INLINE_PAYLOAD;
+    static constexpr size_t FLIGHT_RECORDER_SLOTS = LOGSYSTEM_FLIGHT_RECORDER_SLOTS;
+    static constexpr size_t FLIGHT_RECORD_SIZE = 128;    // Bytes por registro do gravador de voo (msg/extra truncados)
     
     enum class LogLevel { Trace, Debug, Info, Warning, Error, Quest, Packets };
+
+    // Mscara de nveis: bit (1 << level)
+    inline constexpr uint32_t LevelBit(LogLevel level) { return 1u << (int)level; }
+    static constexpr uint32_t ALL_LEVELS_MASK = (1u << LOG_LEVEL_COUNT) - 1;
+
+    // false para nveis removidos em compilao por LOGSYSTEM_MIN_LEVEL
+    inline constexpr bool IsLevelCompiled(LogLevel level) { return (int)level >= LOGSYSTEM_MIN_LEVEL; }
     enum class TargetSide { Left = 0, Right = 1 };
+    enum class QueueMode { Shared, PerThread };
+    enum class FileFormat { Text, Binary };
+    enum class RotationInterval { Daily, Hourly };
+    enum class FileWriter { Buffered, Mapped, Overlapped };
+    enum class TimestampPrecision { Seconds, Milliseconds, Microseconds };
+    enum class SinkOverflowPolicy { Block, DropNewest, DropOldest };
+
+    // Casas decimais do segundo para cada preciso (usado tambm pelo logdecode via TextRenderer)
+    inline int FractionDigits(TimestampPrecision precision) {
+        return precision == TimestampPrecision::Seconds ? 0 :
+               precision == TimestampPrecision::Milliseconds ? 3 : 6;
+    }
 
-    // Estrutura para mensagem de log na fila
+    // Estrutura para mensagem de log na fila.
+    // msg e extra so guardados crus em payload (bytes de msg seguidos dos de extra);
+    // fullText s  preenchido quando a mensagem  renderizada, seja na thread que
+    // chamou Log (formatao imediata) ou no worker (formatao adiada).
     struct LogMessage {
-        LogLevel level;
-        std::string message;
-        std::string extra;
-        unsigned int ip;
-        std::string timestamp;
+        LogLevel level = LogLevel::Info;
+        unsigned int ip = 0;
+        uint64_t tick = 0;          // LogClock::Now() na chamada a Log (ns monotnicos, ordena entre anis)
+        uint32_t formatId = 0;      // FormatRegistry id quando veio de LogFormat<"...">, 0 caso contrrio
+        uint32_t messageLength = 0;
+        uint32_t extraLength = 0;
+        std::array<char, LOG_INLINE_PAYLOAD> payload;
+        std::string overflow;       // Usado quando msg + extra no cabem em payload
         std::string fullText;
         
+        void SetPayload(std::string_view msg, std::string_view extra) {
+            messageLength = (uint32_t)msg.size();
+            extraLength = (uint32_t)extra.size();
+
+            char* dst;
+            if (msg.size() + extra.size() <= LOG_INLINE_PAYLOAD) {
+                overflow.clear();
+                dst = payload.data();
+            }
+            else {
+                overflow.resize(msg.size() + extra.size());
+                dst = overflow.data();
+            }
+            if (!msg.empty()) memcpy(dst, msg.data(), msg.size());
+            if (!extra.empty()) memcpy(dst + msg.size(), extra.data(), extra.size());
+        }
+
+        std::string_view Message() const {
+            return std::string_view(PayloadData(), messageLength);
+        }
+
+        std::string_view Extra() const {
+            return std::string_view(PayloadData() + messageLength, extraLength);
+        }
+
         LogMessage() = default;
         LogMessage(const LogMessage&) = default;
         LogMessage& operator=(const LogMessage&) = default;
         LogMessage(LogMessage&&) noexcept = default;
         LogMessage& operator=(LogMessage&&) noexcept = default;
+
+    private:
+        const char* PayloadData() const {
+            return overflow.empty() ? payload.data() : overflow.data();
+        }
     };
 
-    // Lock-Free Queue simplificada (SPSC - Single Producer Single Consumer)
-    template<typename T, size_t Size>
+    // Lock-Free Queue limitada MPMC (Multi Producer Multi Consumer)
+    // Cada slot carrega um nmero de sequncia: o produtor reserva uma posio com CAS
+    // em enqueuePos e publica o slot com sequence = pos + 1; o consumidor libera o slot
+    // para a prxima volta do anel com sequence = pos + Capacity.
+    // Em caso de falha (fila cheia/vazia) o item no  tocado.
+    template<typename T, size_t Capacity>
     class LockFreeQueue {
     private:
-        std::array<T, Size> buffer;
-        std::atomic<size_t> writeIndex{0};
-        std::atomic<size_t> readIndex{0};
-        
-        static constexpr size_t Mask = Size - 1;
-        static_assert((Size & Mask) == 0, "Size must be power of 2");
-        
+        struct alignas(CACHE_LINE_SIZE) Slot {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        static constexpr size_t Mask = Capacity - 1;
+        static_assert(Capacity >= 2 && (Capacity & Mask) == 0, "Capacity must be power of 2");
+
+        // head/tail em cache lines separadas para evitar false sharing entre produtores e consumidor
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueuePos{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeuePos{0};
+        alignas(CACHE_LINE_SIZE) std::unique_ptr<Slot[]> slots;
+
     public:
+        LockFreeQueue() : slots(std::make_unique<Slot[]>(Capacity)) {
+            for (size_t i = 0; i < Capacity; ++i) {
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        LockFreeQueue(const LockFreeQueue&) = delete;
+        LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
         bool TryPush(T&& item) {
-            size_t currentWrite = writeIndex.load(std::memory_order_relaxed);
-            size_t nextWrite = (currentWrite + 1) & Mask;
-            
-            if (nextWrite == readIndex.load(std::memory_order_acquire)) {
-                return false; // Queue full
+            Slot* slot;
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+            for (;;) {
+                slot = &slots[pos & Mask];
+                size_t seq = slot->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+                if (diff == 0) {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false; // Queue full
+                }
+                else {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
             }
-            
-            buffer[currentWrite] = std::move(item);
-            writeIndex.store(nextWrite, std::memory_order_release);
+
+            slot->data = std::move(item);
+            slot->sequence.store(pos + 1, std::memory_order_release);
             return true;
         }
-        
+
         bool TryPop(T& item) {
-            size_t currentRead = readIndex.load(std::memory_order_relaxed);
-            
-            if (currentRead == writeIndex.load(std::memory_order_acquire)) {
-                return false; // Queue empty
+            Slot* slot;
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+            for (;;) {
+                slot = &slots[pos & Mask];
+                size_t seq = slot->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+                if (diff == 0) {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false; // Queue empty
+                }
+                else {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
             }
-            
-            item = std::move(buffer[currentRead]);
-            readIndex.store((currentRead + 1) & Mask, std::memory_order_release);
+
+            item = std::move(slot->data);
+            slot->sequence.store(pos + Capacity, std::memory_order_release);
             return true;
         }
-        
+
         bool IsEmpty() const {
-            return readIndex.load(std::memory_order_acquire) == 
-                   writeIndex.load(std::memory_order_acquire);
+            return Size() == 0;
         }
-        
+
+        // Aproximado quando h produtores/consumidores concorrentes
         size_t Size() const {
-            size_t write = writeIndex.load(std::memory_order_acquire);
-            size_t read = readIndex.load(std::memory_order_acquire);
-            return (write - read) & Mask;
+            size_t tail = enqueuePos.load(std::memory_order_acquire);
+            size_t head = dequeuePos.load(std::memory_order_acquire);
+            return tail > head ? (tail - head) : 0;
+        }
+
+        static constexpr size_t GetCapacity() { return Capacity; }
+
+        // S para o dreno de emergncia: visita os itens publicados e ainda no consumidos sem
+        // retir-los da fila (nada  movido nem destrudo, ento no h alocao nem free)
+        template<typename Fn>
+        void VisitPending(Fn&& fn) const {
+            size_t end = enqueuePos.load(std::memory_order_acquire);
+            for (size_t pos = dequeuePos.load(std::memory_order_acquire); pos != end; ++pos) {
+                const Slot& slot = slots[pos & Mask];
+                if (slot.sequence.load(std::memory_order_acquire) == pos + 1) {
+                    fn(slot.data);
+                }
+            }
         }
     };
 
-    // String Pool para reduzir alocaes
-    class StringPool {
+    // Anel SPSC usado como fila privada de cada thread produtora.
+    // Cada lado mantm uma cpia em cache do ndice do outro para evitar
+    // trfego de cache line a cada operao.
+    template<typename T, size_t Capacity>
+    class SpscRing {
     private:
-        struct PoolEntry {
-            std::string buffer;
-            std::atomic<bool> inUse{false};
-        };
-        
-        std::array<PoolEntry, STRING_POOL_SIZE> pool;
-        std::atomic<size_t> nextIndex{0};
-        
+        static constexpr size_t Mask = Capacity - 1;
+        static_assert(Capacity >= 2 && (Capacity & Mask) == 0, "Capacity must be power of 2");
+
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};   // escrito pelo produtor
+        size_t cachedHead = 0;
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};   // escrito pelo consumidor
+        size_t cachedTail = 0;
+        alignas(CACHE_LINE_SIZE) std::unique_ptr<T[]> buffer;
+
     public:
-        std::string* Acquire() {
-            // Try to find free entry
-            for (size_t i = 0; i < STRING_POOL_SIZE; ++i) {
-                size_t idx = (nextIndex.fetch_add(1, std::memory_order_relaxed) % STRING_POOL_SIZE);
-                bool expected = false;
-                if (pool[idx].inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
-                    pool[idx].buffer.clear();
-                    return &pool[idx].buffer;
+        SpscRing() : buffer(std::make_unique<T[]>(Capacity)) {}
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        bool TryPush(T&& item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - cachedHead == Capacity) {
+                cachedHead = head.load(std::memory_order_acquire);
+                if (t - cachedHead == Capacity) {
+                    return false; // Ring full
                 }
             }
-            // All busy, return new allocation
-            return new std::string();
+
+            buffer[t & Mask] = std::move(item);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
         }
-        
-        void Release(std::string* str) {
-            // Check if from pool
-            for (auto& entry : pool) {
-                if (&entry.buffer == str) {
-                    entry.inUse.store(false, std::memory_order_release);
-                    return;
+
+        bool TryPop(T& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == cachedTail) {
+                cachedTail = tail.load(std::memory_order_acquire);
+                if (h == cachedTail) {
+                    return false; // Ring empty
                 }
             }
-            // Was allocated, delete it
-            delete str;
+
+            item = std::move(buffer[h & Mask]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t Size() const {
+            size_t t = tail.load(std::memory_order_acquire);
+            size_t h = head.load(std::memory_order_acquire);
+            return t - h;
+        }
+
+        bool IsEmpty() const { return Size() == 0; }
+
+        static constexpr size_t GetCapacity() { return Capacity; }
+
+        // S para o dreno de emergncia (ver LockFreeQueue::VisitPending)
+        template<typename Fn>
+        void VisitPending(Fn&& fn) const {
+            size_t t = tail.load(std::memory_order_acquire);
+            for (size_t h = head.load(std::memory_order_acquire); h != t; ++h) {
+                fn(buffer[h & Mask]);
+            }
         }
     };
 
-    // Timestamp cache para evitar chamadas repetidas
-    class TimestampCache {
-    private:
-        std::atomic<std::chrono::system_clock::time_point> lastUpdate;
-        std::atomic<bool> updateFlag{false};
-        std::string cached;
-        std::mutex cacheMutex;
-        
+    // Anel de uma thread produtora registrado no LogSystem.
+    // orphaned  marcado quando a thread termina; o worker recupera o anel depois de esvazi-lo.
+    struct ProducerRing {
+        SpscRing<LogMessage, PRODUCER_RING_SIZE> ring;
+        DWORD threadId = 0;
+        std::atomic<uint64_t> pushed{0};
+        std::atomic<uint64_t> drops{0};
+        std::atomic<bool> orphaned{false};
+    };
+
+    // Registro cru do gravador de voo: sem texto montado, msg e extra truncados para caber no slot
+    struct FlightEntry {
+        LogLevel level = LogLevel::Info;
+        unsigned int ip = 0;
+        uint64_t tick = 0;
+        std::string message;
+        std::string extra;
+    };
+
+    // Gravador de voo de uma thread: anel fixo com os ltimos FLIGHT_RECORDER_SLOTS registros de
+    // todos os nveis, inclusive os que nenhum sink consome. S a thread dona escreve (sem lock nem CAS);
+    // qualquer thread l com Snapshot. Cada slot tem um seqlock (mpar durante a escrita) e a posio
+    // absoluta que ocupa, ento um slot sobrescrito durante a cpia  descartado.
+    class FlightRecorderRing {
     public:
-        std::string Get() {
-            auto now = std::chrono::system_clock::now();
-            auto last = lastUpdate.load(std::memory_order_relaxed);
-            
-            // Update cache if older than 1 second
-            if (std::chrono::duration_cast<std::chrono::seconds>(now - last).count() >= 1) {
-                bool expected = false;
-                if (updateFlag.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
-                    auto t = std::chrono::system_clock::to_time_t(now);
-                    std::tm tm;
-                    localtime_s(&tm, &t);
-                    
-                    std::ostringstream oss;
-                    oss << "[" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "]";
-                    
-                    {
-                        std::lock_guard<std::mutex> lock(cacheMutex);
-                        cached = oss.str();
-                    }
-                    
-                    lastUpdate.store(now, std::memory_order_release);
-                    updateFlag.store(false, std::memory_order_release);
+        static constexpr size_t Mask = FLIGHT_RECORDER_SLOTS - 1;
+        static_assert(FLIGHT_RECORDER_SLOTS >= 2 && (FLIGHT_RECORDER_SLOTS & Mask) == 0, "FLIGHT_RECORDER_SLOTS must be power of 2");
+        static constexpr size_t PAYLOAD = FLIGHT_RECORD_SIZE - 8 - 8 - 4 - 4 - 3;   // Bytes de msg + extra por registro
+
+        FlightRecorderRing() : slots(std::make_unique<Slot[]>(FLIGHT_RECORDER_SLOTS)) {}
+
+        // Thread dona
+        void Record(LogLevel level, uint64_t tick, unsigned int ip, std::string_view msg, std::string_view extra) {
+            uint64_t pos = head.load(std::memory_order_relaxed);
+            Slot& slot = slots[pos & Mask];
+
+            uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            size_t msgLength = (std::min)(msg.size(), PAYLOAD);
+            size_t extraLength = (std::min)(extra.size(), PAYLOAD - msgLength);
+            slot.position = pos;
+            slot.tick = tick;
+            slot.ip = ip;
+            slot.level = (uint8_t)level;
+            slot.messageLength = (uint8_t)msgLength;
+            slot.extraLength = (uint8_t)extraLength;
+            if (msgLength) memcpy(slot.payload, msg.data(), msgLength);
+            if (extraLength) memcpy(slot.payload + msgLength, extra.data(), extraLength);
+
+            slot.sequence.store(seq + 2, std::memory_order_release);
+            head.store(pos + 1, std::memory_order_release);
+        }
+
+        // Copia os registros a partir da posio absoluta from (os mais antigos j sobrescritos so
+        // pulados) e devolve a posio seguinte ao ltimo lido
+        uint64_t Snapshot(uint64_t from, std::vector<FlightEntry>& out) const {
+            uint64_t end = head.load(std::memory_order_acquire);
+            uint64_t pos = (std::max)(from, end > FLIGHT_RECORDER_SLOTS ? end - FLIGHT_RECORDER_SLOTS : 0);
+
+            for (; pos < end; ++pos) {
+                const Slot& slot = slots[pos & Mask];
+                uint32_t before = slot.sequence.load(std::memory_order_acquire);
+                if (before & 1) continue;
+
+                FlightEntry entry;
+                entry.level = (LogLevel)slot.level;
+                entry.ip = slot.ip;
+                entry.tick = slot.tick;
+                entry.message.assign(slot.payload, slot.messageLength);
+                entry.extra.assign(slot.payload + slot.messageLength, slot.extraLength);
+                uint64_t position = slot.position;
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != before || position != pos) {
+                    continue;   // Sobrescrito pela thread dona durante a cpia
                 }
+                out.push_back(std::move(entry));
             }
-            
-            std::lock_guard<std::mutex> lock(cacheMutex);
-            return cached;
+            return end;
+        }
+
+        uint64_t GetHead() const { return head.load(std::memory_order_acquire); }
+
+        // Reaproveitado por outra thread depois que a dona terminou: o que a anterior deixou sem
+        // despejar  descartado (head continua crescendo, ento um despejo em andamento no se perde)
+        void Reset() {
+            dumpedUpTo.store(head.load(std::memory_order_acquire), std::memory_order_release);
+            dumpRequested.store(false, std::memory_order_relaxed);
         }
+
+        DWORD threadId = 0;         // Escrito sob flightMutex
+        std::atomic<bool> orphaned{false};
+        std::atomic<bool> dumpRequested{false};     // Error nesta thread; o despejo roda no MaintenancePool
+        std::atomic<uint64_t> dumpedUpTo{0};        // Posio j despejada em arquivo (avana sob flightDumpMutex)
+
+    private:
+        struct Slot {
+            uint64_t position = 0;
+            uint64_t tick = 0;
+            std::atomic<uint32_t> sequence{0};
+            uint32_t ip = 0;
+            uint8_t level = 0;
+            uint8_t messageLength = 0;
+            uint8_t extraLength = 0;
+            char payload[PAYLOAD];
+        };
+        static_assert(PAYLOAD < 256, "comprimentos do slot usam uint8_t");
+        static_assert(sizeof(Slot) == FLIGHT_RECORD_SIZE, "slot do gravador de voo fora do tamanho fixo");
+
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head{0};
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    // Relgio do LogSystem. No hot path s se l o tick monotnico (steady_clock em ns,
+    // QueryPerformanceCounter no Windows); a converso para hora de parede usa uma base
+    // (tick, micros de system_clock) publicada por seqlock e recalibrada periodicamente.
+    class LogClock {
+    public:
+        static uint64_t Now() {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        LogClock() { Calibrate(); }
+
+        // Republica a base; escritores so serializados por calibrateMutex (raro)
+        void Calibrate() {
+            std::lock_guard<std::mutex> lock(calibrateMutex);
+            uint64_t tick = Now();
+            uint64_t wall = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            uint32_t seq = sequence.load(std::memory_order_relaxed);
+            sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            baseTick.store(tick, std::memory_order_relaxed);
+            baseWallMicros.store(wall, std::memory_order_relaxed);
+            sequence.store(seq + 2, std::memory_order_release);
+
+            nextCalibration.store(tick + CALIBRATION_INTERVAL_NS, std::memory_order_relaxed);
+        }
+
+        // Recalibra uma vez por CALIBRATION_INTERVAL_NS (ajustes de NTP/relgio do sistema)
+        void CalibrateIfDue(uint64_t tick) {
+            if (tick >= nextCalibration.load(std::memory_order_relaxed)) {
+                Calibrate();
+            }
+        }
+
+        uint64_t ToWallMicros(uint64_t tick) const {
+            uint64_t base, wall;
+            ReadBase(base, wall);
+            return (tick >= base) ? wall + (tick - base) / 1000 : wall - (base - tick) / 1000;
+        }
+
+        // Leitura nica, sem esperar o seqlock: usada no dreno de emergncia, em que a thread que
+        // morreu pode ter ficado no meio de uma calibrao
+        uint64_t ToWallMicrosNoWait(uint64_t tick) const {
+            uint64_t base = baseTick.load(std::memory_order_relaxed);
+            uint64_t wall = baseWallMicros.load(std::memory_order_relaxed);
+            return (tick >= base) ? wall + (tick - base) / 1000 : wall - (base - tick) / 1000;
+        }
+
+        uint64_t FromWallMicros(uint64_t wallMicros) const {
+            uint64_t base, wall;
+            ReadBase(base, wall);
+            return (wallMicros >= wall) ? base + (wallMicros - wall) * 1000 : base - (wall - wallMicros) * 1000;
+        }
+
+    private:
+        static constexpr uint64_t CALIBRATION_INTERVAL_NS = 1000000000ull;
+
+        void ReadBase(uint64_t& base, uint64_t& wall) const {
+            uint32_t before, after;
+            do {
+                before = sequence.load(std::memory_order_acquire);
+                base = baseTick.load(std::memory_order_relaxed);
+                wall = baseWallMicros.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = sequence.load(std::memory_order_relaxed);
+            } while ((before & 1) || before != after);
+        }
+
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint64_t> baseTick{0};
+        std::atomic<uint64_t> baseWallMicros{0};
+        std::atomic<uint64_t> nextCalibration{0};
+        std::mutex calibrateMutex;
+    };
+
+    // String literal usada como parmetro de template: pLog.Info<"player {} moved to {},{}">(id, x, y)
+    template<size_t N>
+    struct FormatLiteral {
+        char value[N];
+
+        constexpr FormatLiteral(const char (&str)[N]) {
+            std::copy_n(str, N, value);
+        }
+
+        constexpr std::string_view View() const { return std::string_view(value, N - 1); }
+    };
+
+    // Registro dos formatos usados pela API checada em tempo de compilao.
+    // Cada formato distinto recebe um id estvel durante a execuo do processo.
+    class FormatRegistry {
+    public:
+        static uint32_t Register(std::string_view fmt);
+        static std::string Get(uint32_t id);
+        static size_t Count();
+    };
+
+    // Um id por formato: a inicializao roda uma vez, na carga do programa
+    template<FormatLiteral Fmt>
+    struct FormatSite {
+        static inline const uint32_t id = FormatRegistry::Register(Fmt.View());
+    };
+
+    // Snapshot de um anel por thread (profundidade e descartes)
+    struct RingStats {
+        DWORD threadId = 0;
+        size_t depth = 0;
+        size_t capacity = 0;
+        uint64_t pushed = 0;
+        uint64_t drops = 0;
+        bool orphaned = false;
+    };
+
+    // Histograma de latncia lock-free em microssegundos: buckets log2 com 4 subdivises
+    // (erro mximo de ~25% por bucket), de 0 us a ~2^41 us
+    struct LatencyHistogram {
+        static constexpr int BUCKETS = 160;
+        using Snapshot = std::array<uint64_t, BUCKETS>;
+
+        void Record(uint64_t micros) {
+            buckets[BucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Snapshot Take() const {
+            Snapshot snap{};
+            for (int i = 0; i < BUCKETS; ++i) snap[i] = buckets[i].load(std::memory_order_relaxed);
+            return snap;
+        }
+
+        // Limite superior (us) do bucket que contm o percentil p (0..1) do snapshot
+        static uint64_t Percentile(const Snapshot& snap, double p) {
+            uint64_t total = 0;
+            for (uint64_t c : snap) total += c;
+            if (total == 0) return 0;
+
+            uint64_t target = (uint64_t)(p * (double)total);
+            if (target >= total) target = total - 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; ++i) {
+                seen += snap[i];
+                if (seen > target) return BucketUpper(i);
+            }
+            return BucketUpper(BUCKETS - 1);
+        }
+
+        uint64_t Percentile(double p) const { return Percentile(Take(), p); }
+
+        static int BucketOf(uint64_t v) {
+            if (v < 4) return (int)v;
+            int msb = 63 - std::countl_zero(v);
+            int sub = (int)((v >> (msb - 2)) & 3);
+            return (std::min)((msb - 1) * 4 + sub, BUCKETS - 1);
+        }
+
+        static uint64_t BucketUpper(int i) {
+            if (i < 4) return (uint64_t)i;
+            int msb = i / 4 + 1;
+            int sub = i % 4;
+            return ((uint64_t)(4 + sub + 1) << (msb - 2)) - 1;
+        }
+
+    private:
+        std::atomic<uint64_t> buckets[BUCKETS]{};
     };
 
     // Performance statistics
@@ -186,10 +632,30 @@ namespace WYD_Server {
         std::atomic<uint64_t> totalLogs{0};
         std::atomic<uint64_t> logsPerLevel[LOG_LEVEL_COUNT]{};
         std::atomic<uint64_t> bytesWritten{0};
+        std::atomic<uint64_t> fileWrites{0};       // Chamadas WriteFile no arquivo de log (uma por lote)
+        std::atomic<uint64_t> writeStalls{0};      // Lotes que esperaram um slot overlapped livre
+        LatencyHistogram diskLatency;              // Submit() at o lote que contm a mensagem ser gravado
         std::atomic<uint64_t> filesRotated{0};
+        std::atomic<uint64_t> rotationStalls{0};   // Rotaes que esperaram/abriram o prximo segmento no caminho do log
         std::atomic<uint64_t> compressionCount{0};
+        std::atomic<uint64_t> liveCompressedIn{0};     // segmentCompression=gzip: bytes dos lotes antes do deflate
+        std::atomic<uint64_t> liveCompressedOut{0};    // ... e gravados no arquivo
+        std::atomic<uint64_t> indexBlocks{0};          // Blocos gravados nos ndices laterais (.idx)
         std::atomic<uint64_t> queueFull{0};
         std::atomic<uint64_t> queuePeak{0};
+        std::atomic<uint64_t> ringsRegistered{0};
+        std::atomic<uint64_t> ringsReclaimed{0};
+        std::atomic<uint64_t> workerParks{0};      // Vezes que o worker dormiu na condition variable
+        std::atomic<uint64_t> workerWakeups{0};    // Sinais enviados por produtores ao worker estacionado
+        std::atomic<uint64_t> flightDumps{0};      // Despejos do gravador de voo (Error, sob demanda, Shutdown)
+        // Manuteno (compactao/limpeza dos logs antigos), fora do caminho de escrita
+        std::atomic<uint64_t> maintenanceQueued{0};     // Tarefas aguardando uma thread de manuteno
+        std::atomic<uint64_t> maintenanceActive{0};     // Tarefas rodando agora
+        std::atomic<uint64_t> maintenanceDone{0};
+        std::atomic<uint64_t> maintenanceFailed{0};
+        std::atomic<uint64_t> maintenanceMicros{0};     // Tempo somado das tarefas
+        std::atomic<uint64_t> lastCleanupMicros{0};     // ltima limpeza: da varredura at a ltima tarefa
+        Upload::Stats upload;                           // Fila de upload dos pacotes (uploadBackup=true)
         std::chrono::steady_clock::time_point startTime;
         
         PerformanceStats() : startTime(std::chrono::steady_clock::now()) {}
@@ -209,6 +675,27 @@ namespace WYD_Server {
             double uptime = GetUptime();
             return uptime > 0 ? totalLogs.load(std::memory_order_relaxed) / uptime : 0;
         }
+
+        void UpdatePeak(size_t depth) {
+            uint64_t peak = queuePeak.load(std::memory_order_relaxed);
+            while (depth > peak &&
+                !queuePeak.compare_exchange_weak(peak, depth, std::memory_order_relaxed));
+        }
+
+        // Atualizado periodicamente pelo worker
+        void UpdateRingStats(std::vector<RingStats>&& snapshot) {
+            std::lock_guard<std::mutex> lock(ringStatsMutex);
+            ringStats = std::move(snapshot);
+        }
+
+        std::vector<RingStats> GetRingStats() const {
+            std::lock_guard<std::mutex> lock(ringStatsMutex);
+            return ringStats;
+        }
+
+    private:
+        mutable std::mutex ringStatsMutex;
+        std::vector<RingStats> ringStats;
     };
 
     // RAII wrapper para handles do Windows
@@ -229,61 +716,567 @@ namespace WYD_Server {
         }
         operator HANDLE() const { return handle; }
         HANDLE get() const { return handle; }
+        bool IsValid() const { return handle && handle != INVALID_HANDLE_VALUE; }
     private:
         HANDLE handle;
     };
 
+    // Segmento de log mapeado em memria (fileWriter=mapped): os registros so copiados direto
+    // para a view, sem WriteFile por lote. Ao fechar, o arquivo  truncado para o tamanho real.
+    class MappedSegmentView {
+    public:
+        MappedSegmentView() = default;
+        MappedSegmentView(const MappedSegmentView&) = delete;
+        MappedSegmentView& operator=(const MappedSegmentView&) = delete;
+
+        // Mapeia capacity bytes do arquivo (estendendo-o se preciso); escrita continua em position
+        bool Map(HANDLE file, uint64_t position, uint64_t capacity) {
+            Unmap();
+            mapping = WinHandle(CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                (DWORD)(capacity >> 32), (DWORD)(capacity & 0xFFFFFFFF), nullptr));
+            if (!mapping.IsValid()) {
+                return false;
+            }
+
+            view = (char*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (size_t)capacity);
+            if (!view) {
+                mapping = WinHandle();
+                return false;
+            }
+
+            this->capacity = capacity;
+            this->position = position;
+            flushed = position;
+            return true;
+        }
+
+        bool Append(std::string_view data) {
+            if (!view || position + data.size() > capacity) {
+                return false;
+            }
+            memcpy(view + position, data.data(), data.size());
+            position += data.size();
+            return true;
+        }
+
+        // Remapeia com mais espao quando um registro no cabe (linha maior que a folga)
+        bool Grow(HANDLE file, size_t needed) {
+            uint64_t pos = position;
+            uint64_t newCapacity = capacity + (std::max)((uint64_t)needed, capacity / 4);
+            FlushDirty();
+            return Map(file, pos, newCapacity);
+        }
+
+        // Inicia a escrita das pginas sujas desde o ltimo flush (no espera o disco)
+        void FlushDirty() {
+            if (view && position > flushed) {
+                FlushViewOfFile(view + flushed, (size_t)(position - flushed));
+                flushed = position;
+            }
+        }
+
+        // Desfaz o mapeamento e trunca o arquivo no ltimo byte escrito
+        void Close(HANDLE file) {
+            if (!view) {
+                return;
+            }
+            FlushDirty();
+            Unmap();
+
+            LARGE_INTEGER end;
+            end.QuadPart = (LONGLONG)position;
+            if (SetFilePointerEx(file, end, nullptr, FILE_BEGIN)) {
+                SetEndOfFile(file);
+            }
+        }
+
+        bool IsMapped() const { return view != nullptr; }
+        bool HasDirty() const { return view && position > flushed; }
+
+    private:
+        void Unmap() {
+            if (view) {
+                UnmapViewOfFile(view);
+                view = nullptr;
+            }
+            mapping = WinHandle();
+        }
+
+        WinHandle mapping;
+        char* view = nullptr;
+        uint64_t capacity = 0;
+        uint64_t position = 0;
+        uint64_t flushed = 0;
+    };
+
+    // Prximo segmento de log, criado e pr-alocado em background antes da rotao
+    struct PreparedSegment {
+        std::string filename;
+        WinHandle handle;
+        uint64_t size = 0;      // Tamanho real (arquivo j existente  continuado)
+        bool overlapped = false;  // Aberto com FILE_FLAG_OVERLAPPED
+    };
+
+    // Lote em voo no modo fileWriter=overlapped. O buffer  trocado (swap) com writeBuffer,
+    // ento os OVERLAPPED_WRITE_SLOTS buffers so reaproveitados sem realocao.
+    struct OverlappedWriteSlot {
+        OVERLAPPED overlapped{};
+        WinHandle event;
+        std::string buffer;
+        std::vector<uint64_t> ticks;    // Ticks das mensagens do lote, para diskLatency
+        bool inFlight = false;
+    };
+
+    // Destino de log. Write/Flush de um sink nunca rodam em paralelo: na thread do prprio
+    // sink (modo assncrono) ou na thread chamadora, serializados pelo SinkChannel (modo sncrono).
+    class ILogSink {
+    public:
+        virtual ~ILogSink() = default;
+
+        virtual const char* GetName() const = 0;
+
+        // false se o sink s usa os campos crus (nvel, tick, ip, Message/Extra); sem nenhum sink
+        // pedindo texto, o worker no monta fullText
+        virtual bool NeedsText() const { return true; }
+
+        // A mensagem  formatada uma vez e compartilhada (somente leitura) entre todos os sinks
+        virtual void Write(const LogMessage& msg) = 0;
+
+        // idle = false depois de cada lote; true quando a fila do sink esvaziou
+        virtual void Flush(bool idle) { (void)idle; }
+    };
+
+    struct SinkStats {
+        std::string name;
+        uint32_t levelMask = 0;
+        size_t depth = 0;
+        size_t capacity = 0;
+        uint64_t written = 0;
+        uint64_t dropped = 0;       // Descartes por DropNewest/DropOldest
+        uint64_t stalls = 0;        // Esperas do worker por espao (Block)
+    };
+
+    // Fila limitada, thread e poltica de overflow de um sink. Um sink lento s atrasa a
+    // prpria fila: o worker do LogSystem segue entregando aos demais.
+    class SinkChannel {
+    public:
+        SinkChannel(std::shared_ptr<ILogSink> sink, uint32_t levelMask, SinkOverflowPolicy policy)
+            : sink(std::move(sink)), levelMask(levelMask), policy(policy) {}
+        ~SinkChannel() { Stop(); }
+
+        SinkChannel(const SinkChannel&) = delete;
+        SinkChannel& operator=(const SinkChannel&) = delete;
+
+        ILogSink& GetSink() const { return *sink; }
+        bool Accepts(LogLevel level) const { return (levelMask.load(std::memory_order_relaxed) & LevelBit(level)) != 0; }
+        uint32_t GetLevelMask() const { return levelMask.load(std::memory_order_relaxed); }
+        void SetLevelMask(uint32_t mask) { levelMask.store(mask, std::memory_order_relaxed); }
+        bool IsRunning() const { return running.load(std::memory_order_acquire); }
+
+        void Start();
+        void Stop();    // Grava o que restou na fila (at 100ms), Flush(true) e encerra a thread
+
+        void Push(std::shared_ptr<const LogMessage> msg);   // Modo assncrono
+        void WriteInline(const LogMessage& msg);            // Modo sncrono / sink parado
+
+        // Dreno de emergncia: a thread do sink para antes de retirar, gravar ou fazer Flush e
+        // publica o item que j tinha retirado (HaltedItem); ReleaseHalt a deixa sair no Stop
+        void RequestHalt() { haltRequested.store(true, std::memory_order_release); }
+        void ReleaseHalt() { haltRequested.store(false, std::memory_order_release); }
+        bool IsHalted() const { return halted.load(std::memory_order_acquire); }
+        bool IsSinkThread() const { return std::this_thread::get_id() == worker.get_id(); }
+        const LogMessage* HaltedItem() const { return IsHalted() ? haltedItem : nullptr; }
+
+        // Dreno de emergncia: mensagens ainda na fila, sem retir-las
+        template<typename Fn>
+        void VisitPending(Fn&& fn) const {
+            queue.VisitPending([&](const std::shared_ptr<const LogMessage>& msg) {
+                if (msg) fn(*msg);
+            });
+        }
+
+        SinkStats GetStats() const;
+
+    private:
+        void Run();
+        void Wake();
+        void HaltForCrash(const LogMessage* held);
+
+        std::shared_ptr<ILogSink> sink;
+        std::atomic<uint32_t> levelMask;
+        const SinkOverflowPolicy policy;
+
+        LockFreeQueue<std::shared_ptr<const LogMessage>, SINK_QUEUE_SIZE> queue;
+        std::mutex writeMutex;      // Serializa WriteInline entre threads chamadoras
+        std::mutex parkMutex;
+        std::condition_variable parkCV;
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> parked{false};
+        std::atomic<bool> running{false};
+        std::atomic<bool> stopping{false};
+        std::atomic<bool> haltRequested{false};
+        std::atomic<bool> halted{false};
+        const LogMessage* haltedItem = nullptr;     // Retirado e ainda no gravado quando parou
+        std::thread worker;
+
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> stalls{0};
+    };
+
+    // Executor das tarefas de manuteno (compactao, excluso, upload). Threads prprias, com
+    // prioridade de CPU/I/O reduzida opcional; uma chave por tarefa evita agendar o mesmo dia duas vezes.
+    class MaintenancePool {
+    public:
+        using Task = std::function<bool()>;     // false = falhou (contado em maintenanceFailed)
+
+        explicit MaintenancePool(PerformanceStats& stats) : stats(stats) {}
+        ~MaintenancePool() { Stop(); }
+
+        MaintenancePool(const MaintenancePool&) = delete;
+        MaintenancePool& operator=(const MaintenancePool&) = delete;
+
+        void Start(int threads, bool lowPriority);
+        void Stop();    // Descarta as tarefas na fila e espera as que esto rodando (que checam StopRequested)
+
+        // false se a chave j est na fila/rodando ou se o executor est parado
+        bool Post(const std::string& key, Task task);
+
+        bool StopRequested() const { return stopping.load(std::memory_order_relaxed); }
+        int GetThreadCount() const { return threadCount.load(std::memory_order_relaxed); }
+
+    private:
+        void Run(bool lowPriority);
+
+        PerformanceStats& stats;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::pair<std::string, Task>> tasks;
+        std::set<std::string> keys;         // Tarefas na fila ou rodando
+        std::vector<std::thread> workers;
+        bool accepting = false;             // Protegido por mutex
+        std::atomic<bool> stopping{false};
+        std::atomic<int> threadCount{0};
+    };
+
+    // Transporte FTP da fila de upload (WinINet). A sesso fica aberta entre arquivos da mesma thread;
+    // a retomada usa APPE sobre o .part j enviado
+    class FtpTransport : public Upload::ITransport {
+    public:
+        FtpTransport(std::string server, std::string user, std::string pass, std::string remoteDir)
+            : server(std::move(server)), user(std::move(user)), pass(std::move(pass)), remoteDir(std::move(remoteDir)) {}
+        ~FtpTransport() override { Disconnect(); }
+
+        bool Connect() override;
+        void Disconnect() override;
+        bool RemoteSize(const std::string& name, uint64_t& size) override;
+        bool Begin(const std::string& name, uint64_t offset) override;
+        bool Write(const char* data, size_t size) override;
+        bool End() override;
+        bool Rename(const std::string& from, const std::string& to) override;
+        std::string Describe(const std::string& name) const override { return "ftp://" + server + remoteDir + name; }
+
+    private:
+        std::string server;
+        std::string user;
+        std::string pass;
+        std::string remoteDir;      // Termina com '/'
+        HINTERNET session = nullptr;
+        HINTERNET connection = nullptr;
+        HINTERNET file = nullptr;
+    };
+
+    class LogSystem;
+
+    // Arquivo de log do LogSystem (texto ou segmento binrio)
+    class FileSink : public ILogSink {
+    public:
+        explicit FileSink(LogSystem& owner) : owner(owner) {}
+        const char* GetName() const override { return "file"; }
+        bool NeedsText() const override;
+        void Write(const LogMessage& msg) override;
+        void Flush(bool idle) override;
+
+    private:
+        LogSystem& owner;
+    };
+
+    // Adaptador Win32 do estgio de exibio: aplica um quadro ao RichEdit do lado informado
+    class RichEditSurface : public Display::ISurface {
+    public:
+        RichEditSurface(LogSystem& owner, TargetSide side) : owner(owner), side(side) {}
+        void Apply(const Display::Frame& frame) override;
+
+    private:
+        LogSystem& owner;
+        TargetSide side;
+    };
+
+    // Janela RichEdit de um lado; recebe os nveis roteados para ele pela tabela routing.
+    // As linhas so agrupadas pelo Display::Batcher e publicadas no mximo displayFps vezes por segundo
+    class RichEditSink : public ILogSink {
+    public:
+        RichEditSink(LogSystem& owner, TargetSide side) : owner(owner), side(side), surface(owner, side) {}
+        const char* GetName() const override { return side == TargetSide::Left ? "display-left" : "display-right"; }
+        void Write(const LogMessage& msg) override;
+        void Flush(bool idle) override;
+
+        // Janela limpa ou trocada: a contagem local de linhas volta a zero no prximo Flush
+        void RequestReset() { resetRequested.store(true, std::memory_order_release); }
+        uint64_t GetFrames() const { return frames.load(std::memory_order_relaxed); }
+
+    private:
+        LogSystem& owner;
+        TargetSide side;
+        RichEditSurface surface;
+        Display::Batcher batcher;
+        std::atomic<bool> resetRequested{false};
+        std::atomic<uint64_t> frames{0};
+    };
+
     class LogSystem {
+        friend class FileSink;
+        friend class RichEditSink;
+        friend class RichEditSurface;
+
     public:
         LogSystem();
         ~LogSystem();
 
         void Initialize();
 		void SetTarget(TargetSide side, HWND editHandle);
-        void Log(LogLevel level, const std::string& msg, const std::string& extra = "", unsigned int ip = 0);
+        void Log(LogLevel level, std::string_view msg, std::string_view extra = {}, unsigned int ip = 0);
 
-        inline void Trace(const std::string& msg, const std::string& extra = "", unsigned int ip = 0) { Log(LogLevel::Trace, msg, extra, ip); }
-        inline void Debug(const std::string& msg, const std::string& extra = "", unsigned int ip = 0) { Log(LogLevel::Debug, msg, extra, ip); }
-        inline void Info(const std::string& msg, const std::string& extra = "", unsigned int ip = 0) { Log(LogLevel::Info, msg, extra, ip); }
-        inline void Warning(const std::string& msg, const std::string& extra = "", unsigned int ip = 0) { Log(LogLevel::Warning, msg, extra, ip); }
-        inline void Error(const std::string& msg, const std::string& extra = "", unsigned int ip = 0) { Log(LogLevel::Error, msg, extra, ip); }
-        inline void Quest(const std::string& msg, const std::string& extra = "", unsigned int ip = 0) { Log(LogLevel::Quest, msg, extra, ip); }
-        inline void Packets(const std::string& msg, const std::string& extra = "", unsigned int ip = 0) { Log(LogLevel::Packets, msg, extra, ip); }
+        inline void Trace(std::string_view msg, std::string_view extra = {}, unsigned int ip = 0) { Log(LogLevel::Trace, msg, extra, ip); }
+        inline void Debug(std::string_view msg, std::string_view extra = {}, unsigned int ip = 0) { Log(LogLevel::Debug, msg, extra, ip); }
+        inline void Info(std::string_view msg, std::string_view extra = {}, unsigned int ip = 0) { Log(LogLevel::Info, msg, extra, ip); }
+        inline void Warning(std::string_view msg, std::string_view extra = {}, unsigned int ip = 0) { Log(LogLevel::Warning, msg, extra, ip); }
+        inline void Error(std::string_view msg, std::string_view extra = {}, unsigned int ip = 0) { Log(LogLevel::Error, msg, extra, ip); }
+        inline void Quest(std::string_view msg, std::string_view extra = {}, unsigned int ip = 0) { Log(LogLevel::Quest, msg, extra, ip); }
+        inline void Packets(std::string_view msg, std::string_view extra = {}, unsigned int ip = 0) { Log(LogLevel::Packets, msg, extra, ip); }
 
 		void EnableFileLevel(LogLevel level);
 		void DisableFileLevel(LogLevel level);
+        void EnableDisplayLevel(LogLevel level);
+        void DisableDisplayLevel(LogLevel level);
+
+        // Sinks adicionais (rede, console, ...), cada um com mscara de nveis, fila, thread e poltica
+        // de overflow prprias. Arquivo e janelas so sinks internos controlados por Enable*Level.
+        void AddSink(std::shared_ptr<ILogSink> sink, uint32_t levelMask = ALL_LEVELS_MASK,
+                     SinkOverflowPolicy policy = SinkOverflowPolicy::DropNewest);
+        bool RemoveSink(const ILogSink* sink);
+        bool SetSinkLevelMask(const ILogSink* sink, uint32_t levelMask);
+        std::vector<SinkStats> GetSinkStats() const;
 
+        // true se algum sink consome o nvel; checado antes de qualquer formatao
+        inline bool IsLevelEnabled(LogLevel level) const {
+            return IsLevelCompiled(level) && (activeLevelMask.load(std::memory_order_relaxed) & LevelBit(level)) != 0;
+        }
+
+        // Varre, compacta, exclui e envia os logs antigos nas threads de manuteno; retorna na hora
         void CleanupOldLogs();
         void LoadConfig(const std::string& filename);
 
         void SetMaxRichEditLines(int maxLines);
+        void SetDisplayFps(int fps);
         void ClearRichEdit(TargetSide side);
 
+        // Gravador de voo (flightRecorder=true): cada thread guarda seus ltimos registros de todos os
+        // nveis, mesmo os desabilitados nos sinks. Despejado em Log/flight_YYYY-MM-DD.log a cada Error
+        // (s a thread que logou), sob demanda e no Shutdown; cada despejo grava s o que  novo.
+        void SetFlightRecorder(bool enabled);
+        bool IsFlightRecorderEnabled() const { return flightRecorderEnabled.load(std::memory_order_relaxed); }
+        size_t DumpFlightRecorder();    // Todas as threads; devolve o nmero de registros gravados
+
+        // Handler de crash (crashHandler=true, instalado por Initialize): em exceo SEH no tratada ou
+        // abort(), EmergencyDrain grava no arquivo atual o lote em memria e as mensagens ainda nas filas,
+        // s com WriteFile e buffers pr-alocados. Pode ser chamado pelo handler de crash da aplicao.
+        // Antes de ler as filas, para o worker e a thread do sink de arquivo (espera at
+        // CRASH_HALT_WAIT_MS); eles no voltam a logar.
+        void InstallCrashHandler();
+        void EmergencyDrain();
+
 		template<typename... Args>
-        std::string Format(const char* fmt, Args&&... args) {
+        std::string Format(std::format_string<Args...> fmt, Args&&... args) {
             return std::format(fmt, std::forward<Args>(args)...);
         }
 
+        // Log com formato checado em tempo de compilao.
+        // Os argumentos so formatados direto no payload inline do LogMessage;
+        // s mensagens maiores que LOGSYSTEM_INLINE_PAYLOAD alocam no heap.
+        template<FormatLiteral Fmt, typename... Args>
+        void LogFormat(LogLevel level, unsigned int ip, Args&&... args) {
+            if (!IsLevelEnabled(level)) {
+                return;
+            }
+            if (!IsLevelDelivered(level)) {
+                // S o gravador de voo consome o nvel: formata na pilha at o tamanho do slot,
+                // sem fila, lock nem heap (o que passar de PAYLOAD  truncado como no Record)
+                char flight[FlightRecorderRing::PAYLOAD];
+                auto result = std::format_to_n(flight, (std::ptrdiff_t)sizeof(flight), Fmt.value, args...);
+                size_t length = (std::min)((size_t)result.size, sizeof(flight));
+                RecordFlight(level, LogClock::Now(), ip, std::string_view(flight, length), {});
+                return;
+            }
+
+            LogMessage msg;
+            msg.level = level;
+            msg.ip = ip;
+            msg.formatId = FormatSite<Fmt>::id;
+
+            // Fmt.value  uma constante: std::format_string valida o formato contra Args na compilao
+            auto result = std::format_to_n(msg.payload.data(), (std::ptrdiff_t)LOG_INLINE_PAYLOAD, Fmt.value, args...);
+            if ((size_t)result.size <= LOG_INLINE_PAYLOAD) {
+                msg.messageLength = (uint32_t)result.size;
+            }
+            else {
+                msg.overflow.resize((size_t)result.size);
+                std::format_to(msg.overflow.data(), Fmt.value, args...);
+                msg.messageLength = (uint32_t)result.size;
+            }
+            msg.extraLength = 0;
+
+            Submit(std::move(msg));
+        }
+
+        // Log com mensagem montada sob demanda: makeMessage (e makeExtra) s rodam se o nvel
+        // tiver destino. Ex.: pLog.LogLazy(LogLevel::Debug, [&] { return "hp=" + std::to_string(hp); });
+        template<typename MsgFn>
+            requires std::is_invocable_v<MsgFn&>
+        void LogLazy(LogLevel level, MsgFn&& makeMessage, unsigned int ip = 0) {
+            if (IsLevelEnabled(level)) {
+                Log(level, std::string_view(makeMessage()), {}, ip);
+            }
+        }
+
+        template<typename MsgFn, typename ExtraFn>
+            requires std::is_invocable_v<MsgFn&> && std::is_invocable_v<ExtraFn&>
+        void LogLazy(LogLevel level, MsgFn&& makeMessage, ExtraFn&& makeExtra, unsigned int ip = 0) {
+            if (IsLevelEnabled(level)) {
+                Log(level, std::string_view(makeMessage()), std::string_view(makeExtra()), ip);
+            }
+        }
+
+        template<FormatLiteral Fmt, typename... Args> inline void Trace(Args&&... args) { LogFormat<Fmt>(LogLevel::Trace, 0, std::forward<Args>(args)...); }
+        template<FormatLiteral Fmt, typename... Args> inline void Debug(Args&&... args) { LogFormat<Fmt>(LogLevel::Debug, 0, std::forward<Args>(args)...); }
+        template<FormatLiteral Fmt, typename... Args> inline void Info(Args&&... args) { LogFormat<Fmt>(LogLevel::Info, 0, std::forward<Args>(args)...); }
+        template<FormatLiteral Fmt, typename... Args> inline void Warning(Args&&... args) { LogFormat<Fmt>(LogLevel::Warning, 0, std::forward<Args>(args)...); }
+        template<FormatLiteral Fmt, typename... Args> inline void Error(Args&&... args) { LogFormat<Fmt>(LogLevel::Error, 0, std::forward<Args>(args)...); }
+        template<FormatLiteral Fmt, typename... Args> inline void Quest(Args&&... args) { LogFormat<Fmt>(LogLevel::Quest, 0, std::forward<Args>(args)...); }
+        template<FormatLiteral Fmt, typename... Args> inline void Packets(Args&&... args) { LogFormat<Fmt>(LogLevel::Packets, 0, std::forward<Args>(args)...); }
+
         void Shutdown();
         
         // Performance queries
         const PerformanceStats& GetStats() const { return stats; }
         bool IsAsyncEnabled() const { return asyncLogging; }
+        bool IsDeferredFormatting() const { return deferredFormatting.load(std::memory_order_relaxed); }
+        void SetDeferredFormatting(bool enabled) { deferredFormatting.store(enabled, std::memory_order_relaxed); }
         bool IsHeadless() const { return headlessMode; }
+        QueueMode GetQueueMode() const { return queueMode; }
+        FileFormat GetFileFormat() const { return fileFormat.load(std::memory_order_relaxed); }
+        FileWriter GetFileWriter() const { return fileWriter; }
+        TimestampPrecision GetTimestampPrecision() const { return timestampPrecision.load(std::memory_order_relaxed); }
+        Segment::EscapeMode GetMessageEscape() const { return messageEscape.load(std::memory_order_relaxed); }
+        void SetFileWriter(FileWriter writer);
         std::string GetCompressMode() const { return compressMode; }
+        bool IsSegmentCompressed() const { return segmentCompression; }
 
     private:
 		HWND targets[TARGET_COUNT] = { nullptr, nullptr };
 		TargetSide routing[LOG_LEVEL_COUNT];
         COLORREF levelColors[LOG_LEVEL_COUNT];
 
-        std::ofstream logFile;
+        WinHandle logFile;
         std::string currentDate;
-        std::set<LogLevel> fileLevels;
+        // Mscaras dos sinks internos. UpdateActiveLevels aplica arquivo/janelas aos SinkChannels e
+        // recalcula activeLevelMask (unio de todos os sinks), lida sem lock pelo caminho de log.
+        std::atomic<uint32_t> fileLevelMask{0};
+        std::atomic<uint32_t> displayLevelMask{ALL_LEVELS_MASK};
+        std::atomic<uint32_t> targetLevelMask[TARGET_COUNT]{};     // Nveis roteados para cada janela configurada
+        std::atomic<uint32_t> activeLevelMask{0};
+        std::atomic<uint32_t> deliveryLevelMask{0};    // S os sinks (activeLevelMask sem o gravador de voo)
+
+        // Gravador de voo: um anel por thread, registrado sob demanda; anis de threads encerradas
+        // so reaproveitados pela prxima thread nova
+        std::atomic<bool> flightRecorderEnabled{false};
+        std::mutex flightMutex;                 // S o registro de anis (curto: a thread nova espera por ele)
+        std::mutex flightDumpMutex;             // Um despejo por vez: renderizao e flight_*.log
+        std::atomic<bool> flightDumpPending{false};     // Algum anel com dumpRequested ainda sem tarefa postada
+        std::vector<std::shared_ptr<FlightRecorderRing>> flightRings;
+
+        // Dreno de emergncia: tudo pr-alocado, nada de lock (a thread que morreu pode estar com fileMutex)
+        bool crashHandler = true;
+        std::atomic<bool> emergencyDrained{false};
+        std::atomic<bool> crashHalt{false};             // Pedido ao worker: parar de retirar das filas (at o fim do dreno)
+        std::atomic<bool> workerHalted{false};          // Resposta: worker parado, haltedBatch/haltedFrom publicados
+        const std::vector<LogMessage>* haltedBatch = nullptr;   // Lote que o worker no chegou a processar
+        size_t haltedFrom = 0;
+        // Anis por thread em tabela fixa (producerRings pode realocar a qualquer push_back):
+        // slot escrito no registro, zerado antes de o anel ser recuperado
+        std::array<std::atomic<ProducerRing*>, CRASH_DRAIN_RINGS> drainRings{};
+        std::atomic<size_t> drainRingCount{0};
+        std::atomic<int64_t> utcOffsetSeconds{0};      // Hora local sem localtime no handler (atualizado ao abrir o arquivo)
+        Crash::LineBuffer emergencyLine;
+
+        // Registro de sinks: lista imutvel trocada a cada alterao; o worker pega uma cpia por passada
+        using SinkList = std::vector<std::shared_ptr<SinkChannel>>;
+        mutable std::mutex sinksMutex;
+        std::shared_ptr<const SinkList> sinkList;
+        std::atomic<uint64_t> sinksVersion{0};
+        std::shared_ptr<SinkChannel> fileChannel;
+        std::shared_ptr<SinkChannel> displayChannels[TARGET_COUNT];
+        std::shared_ptr<RichEditSink> displaySinks[TARGET_COUNT];
         int retentionDays;
         std::string logDir;
         int fileIndex;
         size_t maxLogSize;
+        std::atomic<FileFormat> fileFormat{FileFormat::Text};
+        Segment::Encoder segmentEncoder;    // Estado do segmento binrio aberto (tabela de strings, ltimo tick)
+        std::string segmentBuffer;
+        std::string escapedMessage;         // msg/extra escapados para o registro binrio (s quando sujos)
+        std::string escapedExtra;
+
+        // Escrita em lote: linhas/registros acumulam em writeBuffer e vo ao disco com um nico
+        // WriteFile quando passam de writeBatchBytes ou ficam pendentes h writeBatchDelayMs
+        std::string writeBuffer;
+        std::vector<uint64_t> writeBufferTicks;
+        std::chrono::steady_clock::time_point writeBufferSince;
+        uint64_t currentFileSize = 0;       // Bytes do arquivo aberto, incluindo os ainda em writeBuffer
+
+        // Rotao: por tamanho (maxLogSize), por dia e opcionalmente por hora
+        RotationInterval rotationInterval = RotationInterval::Daily;
+        uint64_t nextTimedRotation = UINT64_MAX;        // Tick do LogClock da prxima rotao por hora
+        std::future<PreparedSegment> nextSegment;
+
+        // Manifesto dos segmentos: a limpeza escolhe os expirados sem varrer logDir
+        Manifest::SegmentManifest manifest;
+        std::string currentSegmentName;     // Nome do segmento aberto no manifesto
+
+        // Escrita direta na view do arquivo (fileWriter=mapped); vale a partir do prximo segmento
+        FileWriter fileWriter = FileWriter::Buffered;
+        MappedSegmentView mappedView;
+
+        // WriteFile assncrono (fileWriter=overlapped): offsets explcitos a partir de writeOffset
+        std::array<OverlappedWriteSlot, OVERLAPPED_WRITE_SLOTS> overlappedSlots;
+        size_t nextOverlappedSlot = 0;
+        uint64_t writeOffset = 0;
+        bool overlappedFile = false;
+        size_t writeBatchBytes = 65536;
+        int writeBatchDelayMs = 10;
+
+        // Compresso na escrita (segmentCompression=gzip): cada lote passa pelo deflate em FlushWriteBuffer.
+        // Segmentos .log.gz/.lsb.gz; maxLogSize continua contando os bytes antes da compresso.
+        bool segmentCompression = false;
+        size_t compressionBlockBytes = Compress::DEFAULT_BLOCK_BYTES;
+        Compress::GzipStream gzipStream;
+        std::string compressBuffer;
+
+        // ndice lateral (segmentIndex=true): o bloco atual do segmento aberto, fechado a cada
+        // indexBlockBytes e gravado em <segmento>.idx. Sem ndice num .gz reaberto (offset desconhecido)
+        bool segmentIndex = true;
+        Index::Builder indexBuilder;
+        std::ofstream indexFile;
+        std::string indexBuffer;
 
         std::string compressMode;
         bool uploadBackup;
@@ -292,9 +1285,37 @@ namespace WYD_Server {
         std::string ftpPass;
         std::string ftpPath;
 
-        int maxRichEditLines;
+        // Manuteno: configurao copiada a cada limpeza, j que LoadConfig pode troc-la no meio
+        struct CleanupSettings {
+            std::string logDir;
+            std::string compressMode;
+            int compressLevel = 6;
+            int compressThreads = 1;
+            int retentionDays = 7;
+            bool uploadBackup = false;
+        };
+        struct CleanupCycle {
+            std::chrono::steady_clock::time_point start;
+            std::atomic<size_t> remaining{0};
+        };
+        int compressLevel = 6;                  // Deflate dos modos file/day (0-9)
+        int compressThreads = 0;                // Threads do ParallelDeflater por pacote; 0 = automtico
+        int maintenanceThreads = 0;             // 0 = automtico; lido s na inicializao
+        bool maintenanceLowPriority = true;
+
+        // Fila de upload (lida s na inicializao): transporte, threads, banda e espera entre tentativas
+        std::string uploadTransport = "ftp";
+        std::string uploadDirectory;
+        int uploadThreads = 2;
+        int uploadBandwidthKB = 0;              // KB/s somando as threads; 0 = sem limite
+        int uploadRetrySeconds = 15;            // Primeira espera; dobra a cada falha, at 30 min
+
+        std::atomic<int> maxRichEditLines;
+        std::atomic<int> displayFps{30};       // Quadros por segundo de cada janela
         bool headlessMode;
         bool asyncLogging;
+        QueueMode queueMode;
+        std::atomic<bool> deferredFormatting{true};
 
         // Thread safety
         std::mutex logMutex;
@@ -303,32 +1324,104 @@ namespace WYD_Server {
         
         // Lock-free async logging
         LockFreeQueue<LogMessage, LOCK_FREE_QUEUE_SIZE> lockFreeQueue;
+
+        // Anis por thread (queueMode=perThread), registrados sob demanda
+        const uint64_t instanceId;
+        std::mutex ringsMutex;
+        std::vector<std::shared_ptr<ProducerRing>> producerRings;
+        std::atomic<uint64_t> ringsVersion{0};
+
+        // Espera do worker: spin -> yield -> park. Produtores s sinalizam quando workerParked,
+        // ento o caminho rpido do Log() no faz syscall
+        std::mutex parkMutex;
         std::condition_variable queueCV;
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> workerParked{false};
         std::thread workerThread;
+        std::vector<LogMessage> mergePending;   // Drenadas e ainda retidas pelo merge entre passadas (s o worker)
         std::atomic<bool> stopWorker;
         
         // Performance optimizations
-        StringPool stringPool;
-        TimestampCache timestampCache;
+        LogClock clock;
+        std::atomic<TimestampPrecision> timestampPrecision{TimestampPrecision::Milliseconds};
+        std::atomic<Segment::EscapeMode> messageEscape{Segment::EscapeMode::Control};   // Escape de msg/extra
+        std::atomic<uint64_t> nextMidnightTick{0};     // Troca de dia: tick da prxima meia-noite local
         PerformanceStats stats;
-        std::atomic<int> flushCounter{0};
+        MaintenancePool maintenance{stats};
+        Upload::UploadQueue uploads{stats.upload};
 
+        void UpdateActiveLevels();
+        bool IsLevelDelivered(LogLevel level) const { return (deliveryLevelMask.load(std::memory_order_relaxed) & LevelBit(level)) != 0; }
+        void RecordFlight(LogLevel level, uint64_t tick, unsigned int ip, std::string_view msg, std::string_view extra);
+        FlightRecorderRing* GetFlightRing(bool create);
+        size_t DumpFlightRings(bool allThreads, const char* reason);
+        void RequestFlightDump();
+        void PostFlightDump();
+        std::shared_ptr<const SinkList> GetSinkList() const;
+        void StartSinks();
+        void StopSinks();
+        void WriteFileRecord(const LogMessage& msg);
+        void ApplyDisplayFrame(TargetSide side, const Display::Frame& frame);
         COLORREF GetColor(LogLevel level);
         std::string LevelToString(LogLevel level);
-        std::string GetTimestamp();
         std::string GetDate();
-        void AppendColoredText(HWND target, const std::string& text, COLORREF textColor);
-        void WriteToFile(const std::string& text);
+        uint64_t ComputeNextMidnightTick() const;
+        int64_t ComputeUtcOffset() const;
+        void EmergencyWrite(const char* data, size_t size);
+        void EmergencyWriteFile(const char* data, size_t size);
+        void WriteToFile(const std::string& text, uint64_t tick, LogLevel level, unsigned int ip);
+        void OpenSegmentIndex(const std::string& segmentFile);
+        void CloseSegmentIndex();
+        void IndexRecord(uint64_t tick, LogLevel level, unsigned int ip);
+        void WriteBinaryRecord(const LogMessage& msg);
+        void RotateLogFileIfNeeded(uint64_t tick);
+        void AppendToFile(std::string_view data, uint64_t tick = 0);
+        void SubmitOverlappedWrite();
+        bool ReapOverlappedWrite(OverlappedWriteSlot& slot, bool wait);
+        void ReapOverlappedWrites(bool wait);
+        void RecordDiskLatency(const std::vector<uint64_t>& ticks);
+        void FlushWriteBuffer();
+        void FlushPendingWrites(bool force);
+        bool HasPendingWrites() const { return !writeBuffer.empty() || mappedView.HasDirty(); }
+        void CloseLogFile();
+        bool IsLogFileOpen() const { return logFile.IsValid(); }
+        void ActivateSegment(PreparedSegment&& segment);
+        void PrepareNextSegment();
+        void SwitchToNextSegment();
+        void DiscardPreparedSegment();
+        uint64_t ComputeNextTimedRotation() const;
+        static PreparedSegment CreateSegmentFile(const std::string& filename, uint64_t preallocate, bool overlapped);
+        std::string GetLogFileName(int index) const;
+        void SetFileFormat(FileFormat format);
+        void SetSegmentCompression(bool enabled, size_t blockBytes);
+        void SetSegmentIndex(bool enabled, size_t blockBytes);
         void OpenLogFile();
 
-        bool CompressFile(const std::string& file);
-        bool CompressDayLogs(const std::string& day, const std::vector<std::string>& files);
-        bool UploadToFTP(const std::string& localFile, const std::string& server,
-            const std::string& user, const std::string& pass, const std::string& remotePath);
+        bool ScanOldLogs(const std::shared_ptr<const CleanupSettings>& settings);
+        bool CleanupOldFiles(const CleanupSettings& settings, const std::string& day, const std::vector<std::string>& files);
+        void FinishCleanupTask(const std::shared_ptr<CleanupCycle>& cycle);
+        void StartUploads();
+        void QueueUpload(const std::string& localZip);
+        void OnUploadFinished(const std::string& localZip, const std::string& remote,
+            Upload::UploadQueue::Result result, std::chrono::milliseconds retryIn);
+        bool AddFileToZip(zipFile zf, const std::string& file, Compress::ParallelDeflater& deflater);
+        bool CompressFile(const CleanupSettings& settings, const std::string& file);
+        bool CompressDayLogs(const CleanupSettings& settings, const std::string& day, const std::vector<std::string>& files);
 
         void WorkerThreadFunc();
-        void ProcessLogMessage(const LogMessage& msg);
-        void TrimRichEdit(HWND target);
+        void ProcessLogMessage(LogMessage& msg, const SinkList& sinks);
+        void RenderLogMessage(LogMessage& msg);
+        void Submit(LogMessage&& msg);
+        bool EnqueueLogMessage(LogMessage&& msg);
+        bool PushToProducerRing(LogMessage&& msg);
+        std::shared_ptr<ProducerRing> RegisterProducerRing();
+        size_t DrainQueues(std::vector<std::shared_ptr<ProducerRing>>& rings, std::vector<LogMessage>& batch);
+        bool WaitToEnqueue(LogMessage& msg);
+        void ReclaimProducerRings(std::vector<std::shared_ptr<ProducerRing>>& rings);
+        void HaltWorkerForCrash(const std::vector<LogMessage>& batch, size_t from);
+        void PublishRingStats(const std::vector<std::shared_ptr<ProducerRing>>& rings);
+        bool HasPendingMessages(const std::vector<std::shared_ptr<ProducerRing>>& rings, uint64_t knownVersion) const;
+        void WaitForMessages(const std::vector<std::shared_ptr<ProducerRing>>& rings, uint64_t knownVersion, int& idleRounds);
+        void WakeWorker();
 
         std::string EncryptPassword(const std::string& password);
         std::string DecryptPassword(const std::string& encrypted);
@@ -355,4 +1448,68 @@ namespace WYD_Server {
 } // namespace WYD_Server
 
 #define pLog (LogManager::Instance().GetLogInst())
+
+// Atalhos LOG_*: checam a mscara de nveis antes de avaliar os argumentos, ento
+// strings montadas na chamada ("..." + std::to_string(x)) s so construdas se algum
+// destino consome o nvel. Abaixo de LOGSYSTEM_MIN_LEVEL a chamada some do binrio.
+// LOG_INFO(pLog, "msg", "extra", ip) / LOG_INFO_FMT(pLog, "player {} moved", id)
+#define LOGSYSTEM_LOG_IF_ENABLED(logger, level, call) \
+    do { if ((logger).IsLevelEnabled(WYD_Server::LogLevel::level)) (logger).call; } while (0)
+
+#if LOGSYSTEM_MIN_LEVEL <= LOGSYSTEM_LEVEL_TRACE
+#define LOG_TRACE(logger, ...)            LOGSYSTEM_LOG_IF_ENABLED(logger, Trace, Trace(__VA_ARGS__))
+#define LOG_TRACE_FMT(logger, fmt, ...)   LOGSYSTEM_LOG_IF_ENABLED(logger, Trace, Trace<fmt>(__VA_ARGS__))
+#else
+#define LOG_TRACE(logger, ...)            ((void)0)
+#define LOG_TRACE_FMT(logger, fmt, ...)   ((void)0)
+#endif
+
+#if LOGSYSTEM_MIN_LEVEL <= LOGSYSTEM_LEVEL_DEBUG
+#define LOG_DEBUG(logger, ...)            LOGSYSTEM_LOG_IF_ENABLED(logger, Debug, Debug(__VA_ARGS__))
+#define LOG_DEBUG_FMT(logger, fmt, ...)   LOGSYSTEM_LOG_IF_ENABLED(logger, Debug, Debug<fmt>(__VA_ARGS__))
+#else
+#define LOG_DEBUG(logger, ...)            ((void)0)
+#define LOG_DEBUG_FMT(logger, fmt, ...)   ((void)0)
+#endif
+
+#if LOGSYSTEM_MIN_LEVEL <= LOGSYSTEM_LEVEL_INFO
+#define LOG_INFO(logger, ...)             LOGSYSTEM_LOG_IF_ENABLED(logger, Info, Info(__VA_ARGS__))
+#define LOG_INFO_FMT(logger, fmt, ...)    LOGSYSTEM_LOG_IF_ENABLED(logger, Info, Info<fmt>(__VA_ARGS__))
+#else
+#define LOG_INFO(logger, ...)             ((void)0)
+#define LOG_INFO_FMT(logger, fmt, ...)    ((void)0)
+#endif
+
+#if LOGSYSTEM_MIN_LEVEL <= LOGSYSTEM_LEVEL_WARNING
+#define LOG_WARNING(logger, ...)          LOGSYSTEM_LOG_IF_ENABLED(logger, Warning, Warning(__VA_ARGS__))
+#define LOG_WARNING_FMT(logger, fmt, ...) LOGSYSTEM_LOG_IF_ENABLED(logger, Warning, Warning<fmt>(__VA_ARGS__))
+#else
+#define LOG_WARNING(logger, ...)          ((void)0)
+#define LOG_WARNING_FMT(logger, fmt, ...) ((void)0)
+#endif
+
+#if LOGSYSTEM_MIN_LEVEL <= LOGSYSTEM_LEVEL_ERROR
+#define LOG_ERROR(logger, ...)            LOGSYSTEM_LOG_IF_ENABLED(logger, Error, Error(__VA_ARGS__))
+#define LOG_ERROR_FMT(logger, fmt, ...)   LOGSYSTEM_LOG_IF_ENABLED(logger, Error, Error<fmt>(__VA_ARGS__))
+#else
+#define LOG_ERROR(logger, ...)            ((void)0)
+#define LOG_ERROR_FMT(logger, fmt, ...)   ((void)0)
+#endif
+
+#if LOGSYSTEM_MIN_LEVEL <= LOGSYSTEM_LEVEL_QUEST
+#define LOG_QUEST(logger, ...)            LOGSYSTEM_LOG_IF_ENABLED(logger, Quest, Quest(__VA_ARGS__))
+#define LOG_QUEST_FMT(logger, fmt, ...)   LOGSYSTEM_LOG_IF_ENABLED(logger, Quest, Quest<fmt>(__VA_ARGS__))
+#else
+#define LOG_QUEST(logger, ...)            ((void)0)
+#define LOG_QUEST_FMT(logger, fmt, ...)   ((void)0)
+#endif
+
+#if LOGSYSTEM_MIN_LEVEL <= LOGSYSTEM_LEVEL_PACKETS
+#define LOG_PACKETS(logger, ...)          LOGSYSTEM_LOG_IF_ENABLED(logger, Packets, Packets(__VA_ARGS__))
+#define LOG_PACKETS_FMT(logger, fmt, ...) LOGSYSTEM_LOG_IF_ENABLED(logger, Packets, Packets<fmt>(__VA_ARGS__))
+#else
+#define LOG_PACKETS(logger, ...)          ((void)0)
+#define LOG_PACKETS_FMT(logger, fmt, ...) ((void)0)
+#endif
+
 #endif // __LOGSYSTEM_H__
\ No newline at end of file
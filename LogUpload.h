@@ -0,0 +1,416 @@
+﻿#ifndef __LOGUPLOAD_H__
+#define __LOGUPLOAD_H__
+
+// Fila de upload dos pacotes de backup, fora da limpeza: cada thread da fila tem seu próprio
+// transporte (a conexão é reaproveitada entre arquivos seguidos), falhas voltam para a fila com
+// espera exponencial e o envio é retomado do que já chegou ao destino.
+//
+// O arquivo é enviado como <nome>.part e renomeado no fim: quem lê o destino nunca vê um pacote
+// pela metade, e o tamanho do .part é o ponto de retomada (também depois de reiniciar o servidor,
+// com os pendentes vindos do manifesto de segmentos). BandwidthLimiter divide uploadBandwidthKB
+// entre todas as threads.
+//
+// O transporte FTP (WinINet) fica no LogSystem; DirectoryTransport copia
+// para uma pasta local ou de rede (\\servidor\share) e serve de destino local em testes.
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+namespace WYD_Server {
+namespace Upload {
+
+    static constexpr const char* PARTIAL_EXTENSION = ".part";
+    static constexpr size_t CHUNK_BYTES = 64 * 1024;        // Leitura/escrita e unidade da cota de banda
+    static constexpr int MAX_THREADS = 8;
+
+    // Destino dos uploads. Uma instância por thread da fila: não precisa ser thread-safe
+    class ITransport {
+    public:
+        virtual ~ITransport() = default;
+
+        // Chamado antes de cada arquivo; deve reaproveitar a conexão aberta
+        virtual bool Connect() = 0;
+        virtual void Disconnect() = 0;
+
+        // Tamanho de name no destino; false se não existe
+        virtual bool RemoteSize(const std::string& name, uint64_t& size) = 0;
+
+        // Abre name para escrita a partir de offset (0 = cria/trunca, > 0 = continua um envio anterior)
+        virtual bool Begin(const std::string& name, uint64_t offset) = 0;
+        virtual bool Write(const char* data, size_t size) = 0;
+        virtual bool End() = 0;
+
+        // Substitui to, se existir
+        virtual bool Rename(const std::string& from, const std::string& to) = 0;
+
+        virtual std::string Describe(const std::string& name) const = 0;
+    };
+
+    using TransportFactory = std::function<std::unique_ptr<ITransport>()>;
+
+    // Cópia para uma pasta (disco local, NFS/SMB mapeado)
+    class DirectoryTransport : public ITransport {
+    public:
+        explicit DirectoryTransport(std::string directory) : directory(std::move(directory)) {}
+
+        bool Connect() override {
+            std::error_code ec;
+            std::filesystem::create_directories(directory, ec);
+            return std::filesystem::is_directory(directory, ec);
+        }
+
+        void Disconnect() override {
+            out.close();
+        }
+
+        bool RemoteSize(const std::string& name, uint64_t& size) override {
+            std::error_code ec;
+            uintmax_t n = std::filesystem::file_size(Path(name), ec);
+            if (ec) {
+                return false;
+            }
+            size = (uint64_t)n;
+            return true;
+        }
+
+        bool Begin(const std::string& name, uint64_t offset) override {
+            out.close();
+            out.clear();
+            if (offset == 0) {
+                out.open(Path(name), std::ios::binary | std::ios::out | std::ios::trunc);
+                return out.is_open();
+            }
+
+            // Retomada: o que passou de offset (escrita interrompida no meio) é sobrescrito
+            out.open(Path(name), std::ios::binary | std::ios::in | std::ios::out);
+            if (!out.is_open()) {
+                return false;
+            }
+            out.seekp((std::streamoff)offset);
+            return out.good();
+        }
+
+        bool Write(const char* data, size_t size) override {
+            out.write(data, (std::streamsize)size);
+            return out.good();
+        }
+
+        bool End() override {
+            out.flush();
+            bool ok = out.good();
+            out.close();
+            return ok;
+        }
+
+        bool Rename(const std::string& from, const std::string& to) override {
+            std::error_code ec;
+            std::filesystem::rename(Path(from), Path(to), ec);
+            return !ec;
+        }
+
+        std::string Describe(const std::string& name) const override {
+            return Path(name).string();
+        }
+
+    private:
+        std::filesystem::path Path(const std::string& name) const {
+            return std::filesystem::path(directory) / name;
+        }
+
+        std::string directory;
+        std::fstream out;
+    };
+
+    // Cota de banda compartilhada: cada bloco reserva sua fatia de tempo; até 1 s de folga acumula
+    class BandwidthLimiter {
+    public:
+        void SetRate(uint64_t bytesPerSecond) {
+            std::lock_guard<std::mutex> lock(mutex);
+            rate = bytesPerSecond;
+            stopping = false;
+            next = std::chrono::steady_clock::now();
+        }
+
+        // false se Stop() foi chamado durante a espera
+        bool Acquire(size_t bytes) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (rate == 0) {
+                return !stopping;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            next = (std::max)(next, now - std::chrono::seconds(1));
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>((double)bytes / (double)rate));
+
+            auto wakeAt = next;
+            cv.wait_until(lock, wakeAt, [this] { return stopping; });
+            return !stopping;
+        }
+
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            cv.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint64_t rate = 0;      // Bytes por segundo; 0 = sem limite
+        bool stopping = false;
+        std::chrono::steady_clock::time_point next;
+    };
+
+    struct Stats {
+        std::atomic<uint64_t> queued{0};        // Aguardando (inclusive em espera para nova tentativa)
+        std::atomic<uint64_t> active{0};
+        std::atomic<uint64_t> done{0};
+        std::atomic<uint64_t> failed{0};        // Tentativas que falharam (cada uma volta para a fila)
+        std::atomic<uint64_t> resumed{0};       // Envios retomados de um .part existente
+        std::atomic<uint64_t> bytesSent{0};
+    };
+
+    struct Settings {
+        int threads = 2;
+        uint64_t bandwidthBytes = 0;                                    // Por segundo, somando as threads
+        std::chrono::milliseconds retryBase = std::chrono::seconds(15);
+        std::chrono::milliseconds retryMax = std::chrono::minutes(30);
+    };
+
+    class UploadQueue {
+    public:
+        enum class Result { Done, Retry, Abandon };
+
+        // Chamado numa thread da fila ao fim de cada tentativa; retryIn só vale para Result::Retry
+        using Callback = std::function<void(const std::string& localFile, const std::string& remote,
+            Result result, std::chrono::milliseconds retryIn)>;
+
+        explicit UploadQueue(Stats& stats) : stats(stats) {}
+        ~UploadQueue() { Stop(); }
+
+        UploadQueue(const UploadQueue&) = delete;
+        UploadQueue& operator=(const UploadQueue&) = delete;
+
+        void Start(TransportFactory factory, const Settings& settings, Callback callback) {
+            if (!workers.empty()) {
+                return;
+            }
+
+            this->settings = settings;
+            this->callback = std::move(callback);
+            limiter.SetRate(settings.bandwidthBytes);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = false;
+                accepting = true;
+            }
+
+            int threads = (std::clamp)(settings.threads, 1, MAX_THREADS);
+            for (int i = 0; i < threads; ++i) {
+                workers.emplace_back(&UploadQueue::Run, this, factory());
+            }
+        }
+
+        // Envios em andamento são interrompidos no próximo bloco; o .part fica para a retomada
+        void Stop() {
+            if (workers.empty()) {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                accepting = false;
+                stats.queued.fetch_sub(jobs.size(), std::memory_order_relaxed);
+                jobs.clear();
+                keys.clear();
+            }
+            cv.notify_all();
+            limiter.Stop();
+
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            workers.clear();
+        }
+
+        // remoteName é só o nome do arquivo no destino. false se já está na fila ou a fila parou
+        bool Enqueue(const std::string& localFile, const std::string& remoteName) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!accepting || !keys.insert(localFile).second) {
+                    return false;
+                }
+                jobs.emplace(std::chrono::steady_clock::now(), Job{ localFile, remoteName, 0 });
+                stats.queued.fetch_add(1, std::memory_order_relaxed);
+            }
+            cv.notify_one();
+            return true;
+        }
+
+        bool IsRunning() const {
+            return !workers.empty();
+        }
+
+    private:
+        struct Job {
+            std::string localFile;
+            std::string remoteName;
+            int attempts;
+        };
+
+        void Run(std::unique_ptr<ITransport> transport) {
+            while (true) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    while (!stopping) {
+                        if (jobs.empty()) {
+                            // Fila vazia: a conexão não fica aberta parada
+                            lock.unlock();
+                            transport->Disconnect();
+                            lock.lock();
+                            cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+                            continue;
+                        }
+                        if (jobs.begin()->first <= std::chrono::steady_clock::now()) {
+                            break;
+                        }
+                        cv.wait_until(lock, jobs.begin()->first);
+                    }
+                    if (stopping) {
+                        break;
+                    }
+
+                    job = std::move(jobs.begin()->second);
+                    jobs.erase(jobs.begin());
+                    stats.queued.fetch_sub(1, std::memory_order_relaxed);
+                    stats.active.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                Result result = Send(*transport, job);
+                if (result != Result::Done) {
+                    transport->Disconnect();
+                }
+
+                std::chrono::milliseconds retryIn{0};
+                bool stopped;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopped = stopping;
+                    if (result == Result::Retry && !stopped) {
+                        // Espera exponencial: retryBase, 2x, 4x ... até retryMax
+                        int shift = (std::min)(job.attempts, 16);
+                        retryIn = (std::min)(settings.retryMax, std::chrono::milliseconds(settings.retryBase.count() << shift));
+                        ++job.attempts;
+                        jobs.emplace(std::chrono::steady_clock::now() + retryIn, job);
+                        stats.queued.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    else {
+                        keys.erase(job.localFile);
+                    }
+                    stats.active.fetch_sub(1, std::memory_order_relaxed);
+                }
+
+                if (result == Result::Done) {
+                    stats.done.fetch_add(1, std::memory_order_relaxed);
+                }
+                else if (!stopped) {
+                    stats.failed.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                // Interrompido pelo Stop(): continua pendente no manifesto, sem aviso
+                if (callback && !(stopped && result != Result::Done)) {
+                    callback(job.localFile, transport->Describe(job.remoteName), result, retryIn);
+                }
+                cv.notify_one();    // Uma nova tentativa pode ter virado a primeira da fila
+            }
+            transport->Disconnect();
+        }
+
+        Result Send(ITransport& transport, const Job& job) {
+            std::error_code ec;
+            uint64_t localSize = (uint64_t)std::filesystem::file_size(job.localFile, ec);
+            if (ec) {
+                return Result::Abandon;     // Pacote apagado: não há o que enviar
+            }
+
+            std::ifstream in(job.localFile, std::ios::binary);
+            if (!in.is_open()) {
+                return Result::Retry;       // Ainda aberto por outro processo
+            }
+            if (!transport.Connect()) {
+                return Result::Retry;
+            }
+
+            // Já no destino (queda entre o rename e o registro no manifesto)
+            uint64_t remoteSize = 0;
+            if (transport.RemoteSize(job.remoteName, remoteSize) && remoteSize == localSize) {
+                return Result::Done;
+            }
+
+            std::string partial = job.remoteName + PARTIAL_EXTENSION;
+            uint64_t offset = 0;
+            if (transport.RemoteSize(partial, remoteSize) && remoteSize > 0 && remoteSize <= localSize) {
+                offset = remoteSize;
+                stats.resumed.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (!transport.Begin(partial, offset)) {
+                return Result::Retry;
+            }
+
+            in.seekg((std::streamoff)offset);
+            std::vector<char> buffer(CHUNK_BYTES);
+            uint64_t sent = offset;
+            while (sent < localSize) {
+                in.read(buffer.data(), (std::streamsize)buffer.size());
+                std::streamsize n = in.gcount();
+                if (n <= 0 || !limiter.Acquire((size_t)n) || !transport.Write(buffer.data(), (size_t)n)) {
+                    transport.End();
+                    return Result::Retry;
+                }
+                sent += (uint64_t)n;
+                stats.bytesSent.fetch_add((uint64_t)n, std::memory_order_relaxed);
+            }
+
+            if (!transport.End() || !transport.Rename(partial, job.remoteName)) {
+                return Result::Retry;
+            }
+            return Result::Done;
+        }
+
+        Stats& stats;
+        Settings settings;
+        Callback callback;
+        BandwidthLimiter limiter;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::multimap<std::chrono::steady_clock::time_point, Job> jobs;    // Por horário da próxima tentativa
+        std::set<std::string> keys;         // Arquivos na fila ou em envio
+        std::vector<std::thread> workers;
+        bool accepting = false;
+        bool stopping = false;
+    };
+
+} // namespace Upload
+} // namespace WYD_Server
+
+#endif // __LOGUPLOAD_H__
@@ -4,6 +4,7 @@
 #include <thread>
 #include <vector>
 #include <chrono>
+#include <algorithm>
 
 using namespace WYD_Server;
 using namespace std::chrono;
@@ -26,6 +27,61 @@ struct BenchmarkResults {
     uint64_t queuePeakSize;
 };
 
+// Item used by the multi-producer stress (producer/sequence detect loss and reordering)
+struct ScalingItem {
+    uint32_t producer = 0;
+    uint32_t sequence = 0;
+    std::string payload;
+};
+
+struct ScalingResult {
+    int producers;
+    double totalTimeSeconds;
+    double messagesPerSecond;
+    uint64_t lostMessages;
+    uint64_t outOfOrder;
+    uint64_t fullRetries;
+};
+
+// Stand-in for the backup server: a local directory behind a simulated link with a connection
+// setup cost and a per-connection rate. Optionally fails one write to exercise retry + resume.
+class SimulatedLinkTransport : public Upload::DirectoryTransport {
+public:
+    SimulatedLinkTransport(const std::string& directory, milliseconds connectCost, uint64_t bytesPerSecond,
+        std::atomic<int>& connects, std::atomic<int>& failCountdown)
+        : DirectoryTransport(directory), connectCost(connectCost), bytesPerSecond(bytesPerSecond),
+          connects(connects), failCountdown(failCountdown) {}
+
+    bool Connect() override {
+        if (!connected) {
+            std::this_thread::sleep_for(connectCost);
+            connects.fetch_add(1);
+            connected = true;
+        }
+        return DirectoryTransport::Connect();
+    }
+
+    void Disconnect() override {
+        connected = false;
+        DirectoryTransport::Disconnect();
+    }
+
+    bool Write(const char* data, size_t size) override {
+        if (failCountdown.fetch_sub(1) == 1) {
+            return false;
+        }
+        std::this_thread::sleep_for(duration<double>((double)size / (double)bytesPerSecond));
+        return DirectoryTransport::Write(data, size);
+    }
+
+private:
+    milliseconds connectCost;
+    uint64_t bytesPerSecond;
+    std::atomic<int>& connects;
+    std::atomic<int>& failCountdown;
+    bool connected = false;
+};
+
 class LogBenchmark {
 public:
     static BenchmarkResults RunSimpleLogging(const BenchmarkConfig& config) {
@@ -169,6 +225,671 @@ public:
         return results;
     }
 
+    // Multi-producer stress directly on LockFreeQueue (1 consumer, N producers).
+    // Verifies that no message is lost and per-producer order is preserved.
+    static std::vector<ScalingResult> RunProducerScaling(const BenchmarkConfig& config) {
+        std::cout << "\n=== Producer Scaling (LockFreeQueue MPMC) ===\n";
+        std::cout << "Messages per producer: " << config.messagesPerThread << "\n\n";
+
+        std::vector<ScalingResult> allResults;
+
+        for (int producers : { 1, 2, 4, 8, 16, 32, 64 }) {
+            auto queue = std::make_unique<LockFreeQueue<ScalingItem, LOCK_FREE_QUEUE_SIZE>>();
+            std::atomic<uint64_t> fullRetries{0};
+            std::atomic<bool> go{false};
+
+            const uint64_t expected = (uint64_t)producers * config.messagesPerThread;
+            uint64_t received = 0;
+            uint64_t outOfOrder = 0;
+            std::vector<uint32_t> nextSeq(producers, 0);
+
+            std::thread consumer([&]() {
+                ScalingItem item;
+                while (received < expected) {
+                    if (queue->TryPop(item)) {
+                        if (item.sequence != nextSeq[item.producer]) {
+                            outOfOrder++;
+                        }
+                        nextSeq[item.producer] = item.sequence + 1;
+                        received++;
+                    }
+                    else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&, p]() {
+                    while (!go.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    for (int i = 0; i < config.messagesPerThread; ++i) {
+                        ScalingItem item;
+                        item.producer = (uint32_t)p;
+                        item.sequence = (uint32_t)i;
+                        item.payload = "Stress test message";
+                        while (!queue->TryPush(std::move(item))) {
+                            fullRetries.fetch_add(1, std::memory_order_relaxed);
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+            }
+
+            auto start = high_resolution_clock::now();
+            go.store(true, std::memory_order_release);
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            consumer.join();
+
+            auto end = high_resolution_clock::now();
+
+            ScalingResult result;
+            result.producers = producers;
+            result.totalTimeSeconds = duration<double>(end - start).count();
+            result.messagesPerSecond = received / result.totalTimeSeconds;
+            result.lostMessages = expected - received;
+            result.outOfOrder = outOfOrder;
+            result.fullRetries = fullRetries.load();
+            allResults.push_back(result);
+        }
+
+        return allResults;
+    }
+
+    // Producer-side cost of pLog.Packets(...) on a single thread, with deferred
+    // formatting on and off, plus the compile-time checked LogFormat API. Calls are
+    // issued in bursts smaller than a producer ring so the synchronous fallback
+    // never kicks in; only the calls are timed.
+    template<typename Fn>
+    static double MeasureProducerCost(int calls, Fn&& logCall) {
+        const int burst = (int)(PRODUCER_RING_SIZE / 2);
+
+        nanoseconds elapsed{0};
+        int done = 0;
+        while (done < calls) {
+            int count = (std::min)(burst, calls - done);
+
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < count; ++i) {
+                logCall(i);
+            }
+            elapsed += duration_cast<nanoseconds>(high_resolution_clock::now() - start);
+
+            done += count;
+            std::this_thread::sleep_for(milliseconds(2)); // let the worker drain
+        }
+
+        return (double)elapsed.count() / calls;
+    }
+
+    static void RunProducerCost(const BenchmarkConfig& config) {
+        std::cout << "\n=== Producer Cost (pLog.Packets) ===\n";
+        std::cout << "Calls: " << config.messagesPerThread << "\n\n";
+
+        const unsigned int ip = (10 << 24) | (0 << 16) | (0 << 8) | 42;
+        bool previous = pLog.IsDeferredFormatting();
+        uint64_t fullBefore = pLog.GetStats().queueFull.load();
+
+        std::cout << std::fixed << std::setprecision(1);
+
+        for (bool deferred : { true, false }) {
+            pLog.SetDeferredFormatting(deferred);
+            double ns = MeasureProducerCost(config.messagesPerThread, [ip](int) {
+                pLog.Packets("C2S_MOVE received", "size=16", ip);
+            });
+            std::cout << (deferred ? "Deferred" : "Immediate") << " formatting: " << ns << " ns/call\n";
+        }
+
+        pLog.SetDeferredFormatting(true);
+        double ns = MeasureProducerCost(config.messagesPerThread, [ip](int i) {
+            pLog.LogFormat<"C2S_MOVE received size={} seq={}">(LogLevel::Packets, ip, 16, i);
+        });
+        std::cout << "LogFormat<\"...\"> (deferred): " << ns << " ns/call\n";
+
+        std::cout << "Sync fallbacks: " << pLog.GetStats().queueFull.load() - fullBefore << "\n";
+
+        pLog.SetDeferredFormatting(previous);
+    }
+
+    // Cost of a Debug call when no sink consumes Debug: an eager call still builds its
+    // strings before Log() discards them; LOG_DEBUG and LogLazy check the level mask first.
+    template<typename Fn>
+    static double MeasureDisabledCost(int calls, Fn&& logCall) {
+        auto start = high_resolution_clock::now();
+        for (int i = 0; i < calls; ++i) {
+            logCall(i);
+        }
+        return (double)duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / calls;
+    }
+
+    static void RunDisabledLevelCost(int calls) {
+        std::cout << "\n=== Disabled Level Cost (Debug) ===\n";
+        std::cout << "Calls: " << calls << "\n\n";
+
+        pLog.DisableFileLevel(LogLevel::Debug);
+        pLog.DisableDisplayLevel(LogLevel::Debug);
+        uint64_t debugBefore = pLog.GetStats().logsPerLevel[(int)LogLevel::Debug].load();
+
+        std::cout << std::fixed << std::setprecision(1);
+
+        double eager = MeasureDisabledCost(calls, [](int i) {
+            pLog.Debug("Test message from thread " + std::to_string(i & 7), "iteration " + std::to_string(i));
+        });
+        std::cout << "pLog.Debug(eager strings): " << eager << " ns/call\n";
+
+        double macro = MeasureDisabledCost(calls, [](int i) {
+            LOG_DEBUG(pLog, "Test message from thread " + std::to_string(i & 7), "iteration " + std::to_string(i));
+        });
+        std::cout << "LOG_DEBUG(pLog, ...):      " << macro << " ns/call\n";
+
+        double lazy = MeasureDisabledCost(calls, [](int i) {
+            pLog.LogLazy(LogLevel::Debug,
+                [i] { return "Test message from thread " + std::to_string(i & 7); },
+                [i] { return "iteration " + std::to_string(i); });
+        });
+        std::cout << "pLog.LogLazy(lambdas):     " << lazy << " ns/call\n";
+
+        double formatted = MeasureDisabledCost(calls, [](int i) {
+            LOG_DEBUG_FMT(pLog, "Test message from thread {} iteration {}", i & 7, i);
+        });
+        std::cout << "LOG_DEBUG_FMT(pLog, ...):  " << formatted << " ns/call\n";
+
+        std::cout << "Debug messages processed: "
+                  << pLog.GetStats().logsPerLevel[(int)LogLevel::Debug].load() - debugBefore << " (expected 0)\n";
+
+        pLog.EnableDisplayLevel(LogLevel::Debug);
+    }
+
+    // Debug disabled on every sink, flight recorder off vs on: the recorder copies the record into the
+    // thread's ring without touching the queue. LOG_DEBUG_FMT first formats its arguments into a
+    // slot-sized stack buffer, so it pays std::format_to_n; pLog.Debug only pays the copy.
+    // An Error then dumps the ring to flight_*.log.
+    static void RunFlightRecorderCost(int calls) {
+        std::cout << "\n=== Flight Recorder Cost (Debug disabled on sinks) ===\n";
+        std::cout << "Calls: " << calls << "\n\n";
+
+        pLog.DisableFileLevel(LogLevel::Debug);
+        pLog.DisableDisplayLevel(LogLevel::Debug);
+        bool wasEnabled = pLog.IsFlightRecorderEnabled();
+        const auto& stats = pLog.GetStats();
+
+        std::cout << std::fixed << std::setprecision(1);
+
+        pLog.SetFlightRecorder(false);
+        double off = MeasureDisabledCost(calls, [](int i) {
+            LOG_DEBUG_FMT(pLog, "Test message from thread {} iteration {}", i & 7, i);
+        });
+        std::cout << "Recorder off, LOG_DEBUG_FMT: " << off << " ns/call\n";
+
+        pLog.SetFlightRecorder(true);
+        double onFmt = MeasureDisabledCost(calls, [](int i) {
+            LOG_DEBUG_FMT(pLog, "Test message from thread {} iteration {}", i & 7, i);
+        });
+        std::cout << "Recorder on,  LOG_DEBUG_FMT: " << onFmt << " ns/call\n";
+
+        double onRaw = MeasureDisabledCost(calls, [](int) {
+            pLog.Debug("Test message from flight recorder", "raw record");
+        });
+        std::cout << "Recorder on,  pLog.Debug:    " << onRaw << " ns/call\n";
+        std::cout << "Formatting share (FMT):      " << onFmt - onRaw << " ns/call\n";
+
+        // The Error only flags the ring; the dump itself runs on a maintenance thread
+        uint64_t dumpsBefore = stats.flightDumps.load();
+        auto start = high_resolution_clock::now();
+        pLog.Error("Flight recorder benchmark error");
+        double errorUs = duration<double, std::micro>(high_resolution_clock::now() - start).count();
+        while (stats.flightDumps.load() == dumpsBefore && high_resolution_clock::now() - start < seconds(2)) {
+            std::this_thread::sleep_for(microseconds(100));
+        }
+        double dumpMs = duration<double, std::milli>(high_resolution_clock::now() - start).count();
+        std::cout << "Error call (dump requested): " << errorUs << " us\n";
+        std::cout << "Dump written after:          " << dumpMs << " ms ("
+                  << stats.flightDumps.load() - dumpsBefore << " dump, up to " << FLIGHT_RECORDER_SLOTS << " records)\n";
+        std::cout << "Ring memory per thread:      " << (FLIGHT_RECORDER_SLOTS * FLIGHT_RECORD_SIZE) / 1024 << " KB\n";
+
+        pLog.SetFlightRecorder(wasEnabled);
+        pLog.EnableDisplayLevel(LogLevel::Debug);
+    }
+
+    // Rendered text lines in the .log format, at least totalBytes long (compression benchmarks)
+    static std::string MakeSyntheticLog(size_t totalBytes) {
+        std::string input;
+        input.reserve(totalBytes + 256);
+        for (int i = 0; input.size() < totalBytes; ++i) {
+            input += std::format("[2025-01-15 12:{:02}:{:02}.{:03}] [{}] Player {} moved to map {} [pos={},{}] [IP:192.168.0.{}]\r\n",
+                (i / 60000) % 60, (i / 1000) % 60, i % 1000, (i % 5) ? "INFO" : "PACKETS",
+                i % 5000, i % 17, 2100 + i % 50, 2100 + i % 33, i % 255);
+        }
+        return input;
+    }
+
+    // Deflate cost of segmentCompression=gzip on one core: rendered lines in writeBatchBytes batches,
+    // each ending in a sync flush, as FlushWriteBuffer does on the worker
+    static void RunLiveCompressionCost(size_t totalBytes, size_t batchBytes) {
+        std::cout << "\n=== Live Segment Compression (one core) ===\n";
+        std::cout << "Input: " << totalBytes / (1024 * 1024) << " MB in " << batchBytes / 1024 << " KB batches\n\n";
+
+        std::string input = MakeSyntheticLog(totalBytes);
+
+        std::cout << std::setw(8) << "Level" << std::setw(14) << "MB/s" << std::setw(12) << "ns/byte"
+                  << std::setw(10) << "Ratio" << "\n";
+
+        for (int level : { Compress::LIVE_LEVEL, Z_DEFAULT_COMPRESSION }) {
+            Compress::GzipStream stream;
+            stream.Begin(level);
+            std::string output;
+            output.reserve(batchBytes * 2);
+            size_t compressed = 0;
+
+            auto start = high_resolution_clock::now();
+            for (size_t offset = 0; offset < input.size(); offset += batchBytes) {
+                output.clear();
+                stream.Compress(std::string_view(input).substr(offset, batchBytes), output);
+                compressed += output.size();
+            }
+            output.clear();
+            stream.Finish(output);
+            compressed += output.size();
+            double seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+            std::cout << std::setw(8) << (level == Z_DEFAULT_COMPRESSION ? 6 : level)
+                      << std::setw(14) << std::fixed << std::setprecision(1) << input.size() / seconds / 1e6
+                      << std::setw(12) << std::setprecision(2) << seconds * 1e9 / input.size()
+                      << std::setw(10) << (double)input.size() / compressed << "\n";
+        }
+    }
+
+    // Day-pack compression (compressMode=day/file): ParallelDeflater throughput versus thread count
+    static void RunParallelDeflateScaling(size_t totalBytes, int level) {
+        std::cout << "\n=== Parallel Deflate (day packs, level " << level << ") ===\n";
+        std::cout << "Input: " << totalBytes / (1024 * 1024) << " MB, "
+                  << Compress::PARALLEL_BLOCK_BYTES / 1024 << " KB blocks\n\n";
+
+        std::string input = MakeSyntheticLog(totalBytes);
+        const unsigned long expectedCrc = crc32(0L, (const Bytef*)input.data(), (uInt)input.size());
+
+        std::vector<int> threadCounts = { 1, 2, 4, 8 };
+        int cores = (int)std::thread::hardware_concurrency();
+        if (cores > 8) threadCounts.push_back(cores);
+
+        std::cout << std::setw(8) << "Threads" << std::setw(12) << "MB/s" << std::setw(10) << "Speedup"
+                  << std::setw(10) << "Ratio" << std::setw(8) << "CRC" << "\n";
+
+        double baseline = 0;
+        for (int threads : threadCounts) {
+            Compress::ParallelDeflater deflater(level, threads);
+            size_t offset = 0;
+            size_t compressed = 0;
+            uint64_t rawSize = 0;
+            unsigned long crc = 0;
+
+            auto start = high_resolution_clock::now();
+            deflater.Deflate(
+                [&](char* buffer, size_t capacity) {
+                    size_t n = (std::min)(capacity, input.size() - offset);
+                    memcpy(buffer, input.data() + offset, n);
+                    offset += n;
+                    return (std::ptrdiff_t)n;
+                },
+                [&](const char*, size_t size) { compressed += size; return true; },
+                rawSize, crc);
+            double seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+            double mbps = input.size() / seconds / 1e6;
+            if (baseline == 0) baseline = mbps;
+            std::cout << std::setw(8) << threads
+                      << std::setw(12) << std::fixed << std::setprecision(1) << mbps
+                      << std::setw(9) << std::setprecision(2) << mbps / baseline << "x"
+                      << std::setw(10) << (double)input.size() / compressed
+                      << std::setw(8) << (crc == expectedCrc && rawSize == input.size() ? "ok" : "BAD") << "\n";
+        }
+    }
+
+    // Backup upload queue against the simulated link: throughput per thread count (one connection
+    // per thread, reused across files), the shared bandwidth cap, and a failed write resumed from the .part
+    static void RunUploadPipeline(int files, size_t fileBytes) {
+        std::cout << "\n=== Upload Pipeline (simulated link: 50 ms connect, 8 MB/s per connection) ===\n";
+        std::cout << "Packs: " << files << " x " << fileBytes / (1024 * 1024) << " MB\n\n";
+
+        const std::filesystem::path root = std::filesystem::temp_directory_path() / "logsystem_upload_bench";
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "local");
+
+        std::vector<std::string> packs;
+        std::string content(fileBytes, '\0');
+        for (size_t i = 0; i < content.size(); ++i) {
+            content[i] = (char)((i * 2654435761u) >> 13);
+        }
+        for (int i = 0; i < files; ++i) {
+            packs.push_back((root / "local" / ("logpack_" + std::to_string(i) + ".zip")).string());
+            std::ofstream(packs.back(), std::ios::binary).write(content.data(), (std::streamsize)content.size());
+        }
+
+        struct Scenario { const char* name; int threads; uint64_t bandwidth; int failAfterWrites; };
+        const Scenario scenarios[] = {
+            { "1 thread", 1, 0, 0 },
+            { "2 threads", 2, 0, 0 },
+            { "4 threads", 4, 0, 0 },
+            { "4 threads, cap 12 MB/s", 4, 12 * 1024 * 1024, 0 },
+            { "1 thread, write fails", 1, 0, 40 },
+        };
+
+        std::cout << std::setw(26) << "Scenario" << std::setw(10) << "MB/s" << std::setw(10) << "Connects"
+                  << std::setw(9) << "Retries" << std::setw(9) << "Resumed" << std::setw(8) << "Check" << "\n";
+
+        for (const auto& scenario : scenarios) {
+            std::filesystem::path remote = root / "remote";
+            std::filesystem::remove_all(remote);
+
+            Upload::Stats stats;
+            std::atomic<int> connects{0};
+            std::atomic<int> failCountdown{scenario.failAfterWrites};
+            std::atomic<int> finished{0};
+
+            Upload::Settings settings;
+            settings.threads = scenario.threads;
+            settings.bandwidthBytes = scenario.bandwidth;
+            settings.retryBase = milliseconds(10);
+
+            auto start = high_resolution_clock::now();
+            {
+                Upload::UploadQueue queue(stats);
+                queue.Start([&]() {
+                        return std::make_unique<SimulatedLinkTransport>(remote.string(), milliseconds(50),
+                            8 * 1024 * 1024, connects, failCountdown);
+                    }, settings,
+                    [&](const std::string&, const std::string&, Upload::UploadQueue::Result result, milliseconds) {
+                        if (result != Upload::UploadQueue::Result::Retry) finished.fetch_add(1);
+                    });
+                for (const auto& pack : packs) {
+                    queue.Enqueue(pack, std::filesystem::path(pack).filename().string());
+                }
+                while (finished.load() < files) {
+                    std::this_thread::sleep_for(milliseconds(5));
+                }
+            }
+            double seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+            bool ok = stats.done.load() == (uint64_t)files;
+            for (const auto& pack : packs) {
+                std::error_code ec;
+                ok = ok && std::filesystem::file_size(remote / std::filesystem::path(pack).filename(), ec) == fileBytes && !ec;
+            }
+
+            std::cout << std::setw(26) << scenario.name
+                      << std::setw(10) << std::fixed << std::setprecision(1) << (double)files * fileBytes / seconds / (1024 * 1024)
+                      << std::setw(10) << connects.load()
+                      << std::setw(9) << stats.failed.load()
+                      << std::setw(9) << stats.resumed.load()
+                      << std::setw(8) << (ok ? "ok" : "BAD") << "\n";
+        }
+
+        std::filesystem::remove_all(root);
+    }
+
+    // Sidecar index (segmentIndex=true): cost per record on the worker and the fraction of a day's
+    // segment a lookup still has to read (time window, one IP, a rare level)
+    static void RunIndexSelectivity(int records, size_t blockBytes) {
+        std::cout << "\n=== Segment Index (" << records << " records over 24h, " << blockBytes / 1024 << " KB blocks) ===\n\n";
+
+        std::string idx;
+        Index::WriteHeader(0, (uint32_t)blockBytes, idx);
+        Index::Builder builder;
+        builder.SetBlockBytes(blockBytes);
+        builder.Begin(0);
+
+        const uint64_t dayMicros = 86400ull * 1000000;
+        const uint32_t targetIp = 0x0A00002A;   // 10.0.0.42, outside the background range
+        uint64_t offset = 0;
+
+        auto start = high_resolution_clock::now();
+        for (int i = 0; i < records; ++i) {
+            if (builder.IsFull(offset)) {
+                builder.Finish(offset, idx);
+                builder.Begin(offset);
+            }
+            uint64_t micros = dayMicros * i / records;
+            uint8_t level = (i % 997 == 0) ? (uint8_t)LogLevel::Error : (uint8_t)LogLevel::Info;
+            uint32_t ip = (i % 5003 == 0) ? targetIp : 0xC0A80000 + (uint32_t)i * 2654435761u % 50000;
+            builder.Add(micros, level, ip);
+            offset += 110 + i % 40;
+        }
+        builder.Finish(offset, idx);
+        double seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+        Index::Reader reader;
+        reader.Load(idx.data(), idx.size());
+        std::cout << "Build: " << std::fixed << std::setprecision(1) << seconds * 1e9 / records << " ns/record, "
+                  << reader.GetBlocks().size() << " blocks, index " << idx.size() / 1024 << " KB for "
+                  << offset / (1024 * 1024) << " MB of log\n\n";
+
+        struct Lookup {
+            const char* name;
+            Index::Query query;
+        };
+        std::vector<Lookup> lookups(3);
+        lookups[0].name = "8 minute window";
+        lookups[0].query.fromMicros = 14 * 3600ull * 1000000 + 2 * 60ull * 1000000;
+        lookups[0].query.toMicros = lookups[0].query.fromMicros + 8 * 60ull * 1000000;
+        lookups[1].name = "one IP";
+        lookups[1].query.ip = targetIp;
+        lookups[2].name = "Error only";
+        lookups[2].query.levelMask = (uint16_t)LevelBit(LogLevel::Error);
+
+        std::cout << std::setw(18) << "Lookup" << std::setw(10) << "Ranges" << std::setw(12) << "Read MB"
+                  << std::setw(10) << "Read %" << "\n";
+        for (const auto& lookup : lookups) {
+            uint64_t bytes = 0;
+            auto ranges = reader.Select(lookup.query, offset);
+            for (const auto& range : ranges) {
+                bytes += range.length;
+            }
+            std::cout << std::setw(18) << lookup.name << std::setw(10) << ranges.size()
+                      << std::setw(12) << std::setprecision(1) << bytes / (1024.0 * 1024.0)
+                      << std::setw(10) << 100.0 * bytes / offset << "\n";
+        }
+    }
+
+    // messageEscape: cost of escaping msg on every line. "append" is the old unescaped copy, "scalar"
+    // a byte-at-a-time loop doing the same escaping, the SIMD columns Segment::AppendEscaped.
+    static void RunEscapeCost(int messages) {
+        std::cout << "\n=== Message Escape (" << messages << " messages per payload, " << Simd::PathName() << ") ===\n\n";
+
+        struct Payload {
+            const char* name;
+            std::string text;
+        };
+        const Payload payloads[] = {
+            { "ASCII 48 B", "Player Arkanis moved to 2104,2087 on map 3 (ok)" },
+            { "ASCII 200 B", std::string("Trade completed: 12x Poeira de Lac, 3x Pedra da Luz, 1x Armadura ") +
+                             "Sagrada +9 between account arkanis01 and account lunaria77, gold delta 15230000, " +
+                             "channel 4, server 2, log ref 0001" },
+            { "UTF-8 chat 64 B", "Cad\xC3\xAA o l\xC3\xAD" "der? Vamos \xC3\xA0 \xC3\xA1" "rea de ca\xC3\xA7" "a agora" },
+            { "chat with CR/LF", "gg\r\n[2026-01-01 00:00:00.000] [ERROR] forged line from chat\r\n" },
+        };
+
+        auto scalar = [](std::string& out, std::string_view text) {
+            static constexpr char HEX[] = "0123456789ABCDEF";
+            for (char ch : text) {
+                unsigned char c = (unsigned char)ch;
+                if (c >= 0x20 && c != 0x7F) {
+                    out += ch;
+                }
+                else if (c == '\r') out += "\\r";
+                else if (c == '\n') out += "\\n";
+                else if (c == '\t') out += "\\t";
+                else {
+                    out += "\\x";
+                    out += HEX[c >> 4];
+                    out += HEX[c & 0x0F];
+                }
+            }
+        };
+
+        std::cout << std::setw(18) << "Payload" << std::setw(10) << "append" << std::setw(10) << "scalar"
+                  << std::setw(10) << "control" << std::setw(10) << "utf8" << std::setw(12) << "GB/s ctrl" << "  (ns/msg)\n";
+
+        std::string out;
+        size_t sink = 0;
+        for (const auto& payload : payloads) {
+            auto measure = [&](auto&& body) {
+                auto start = high_resolution_clock::now();
+                for (int i = 0; i < messages; ++i) {
+                    out.clear();
+                    body(out, std::string_view(payload.text));
+                    sink += out.size();
+                }
+                return duration<double, std::nano>(high_resolution_clock::now() - start).count() / messages;
+            };
+
+            double append = measure([](std::string& o, std::string_view t) { o.append(t); });
+            double loop = measure(scalar);
+            double control = measure([](std::string& o, std::string_view t) {
+                Segment::AppendEscaped(o, t, Segment::EscapeMode::Control);
+            });
+            double utf8 = measure([](std::string& o, std::string_view t) {
+                Segment::AppendEscaped(o, t, Segment::EscapeMode::Utf8);
+            });
+
+            std::cout << std::setw(18) << payload.name << std::fixed << std::setprecision(1)
+                      << std::setw(10) << append << std::setw(10) << loop
+                      << std::setw(10) << control << std::setw(10) << utf8
+                      << std::setw(12) << std::setprecision(2) << payload.text.size() / control << "\n";
+        }
+        std::cout << "Output checksum: " << sink << " bytes\n";   // Uses the results so the loops are not optimized away
+    }
+
+    // Time from Log() on the caller until the worker has processed the message.
+    // gap = idle time before each call: short gaps hit the spin phase, long ones a parked worker.
+    static void MeasureWakeLatency(const char* label, microseconds gap, int samples) {
+        const auto& stats = pLog.GetStats();
+        std::vector<double> latencies;
+        latencies.reserve(samples);
+        uint64_t wakeupsBefore = stats.workerWakeups.load();
+
+        for (int i = 0; i < samples; ++i) {
+            std::this_thread::sleep_for(gap);
+
+            uint64_t before = stats.totalLogs.load(std::memory_order_acquire);
+            auto start = high_resolution_clock::now();
+            pLog.Trace("wake latency probe");
+            while (stats.totalLogs.load(std::memory_order_acquire) == before) {
+                if (high_resolution_clock::now() - start > seconds(1)) break;
+            }
+            latencies.push_back(duration<double, std::micro>(high_resolution_clock::now() - start).count());
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::setw(22) << label
+                  << std::setw(12) << latencies[latencies.size() / 2]
+                  << std::setw(12) << latencies[(latencies.size() * 99) / 100]
+                  << std::setw(12) << latencies.back()
+                  << std::setw(10) << stats.workerWakeups.load() - wakeupsBefore << "\n";
+    }
+
+    static double GetProcessCpuSeconds() {
+        FILETIME creation, exitTime, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user)) {
+            return 0.0;
+        }
+        auto toSeconds = [](const FILETIME& ft) {
+            return (double)(((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 1e7;  // 100ns units
+        };
+        return toSeconds(kernel) + toSeconds(user);
+    }
+
+    static void RunWorkerWakeup() {
+        std::cout << "\n=== Worker Wakeup (spin -> yield -> park) ===\n";
+        std::cout << std::fixed << std::setprecision(2);
+
+        // Idle CPU: with no producers the worker should park and the process sit near 0%
+        const auto idleWindow = seconds(2);
+        std::this_thread::sleep_for(milliseconds(200));
+        uint64_t parksBefore = pLog.GetStats().workerParks.load();
+        double cpuBefore = GetProcessCpuSeconds();
+        std::this_thread::sleep_for(idleWindow);
+        double cpuUsed = GetProcessCpuSeconds() - cpuBefore;
+
+        std::cout << "Idle CPU: " << (cpuUsed / duration<double>(idleWindow).count()) * 100.0
+                  << "% of one core (" << pLog.GetStats().workerParks.load() - parksBefore << " parks)\n\n";
+
+        std::cout << std::setw(22) << "Wake latency (us)" << std::setw(12) << "p50"
+                  << std::setw(12) << "p99" << std::setw(12) << "max" << std::setw(10) << "Signals" << "\n";
+        MeasureWakeLatency("worker spinning", microseconds(20), 1000);
+        MeasureWakeLatency("worker parked", milliseconds(20), 200);
+    }
+
+    // p50/p99 of Submit() -> batch containing the message written, per file writer
+    static void RunDiskLatency(const BenchmarkConfig& config) {
+        std::cout << "\n=== Enqueue-to-Disk Latency (buffered vs overlapped) ===\n";
+        std::cout << "Threads: " << config.numThreads << ", messages per thread: " << config.messagesPerThread << "\n\n";
+
+        pLog.EnableFileLevel(LogLevel::Info);
+        FileWriter previous = pLog.GetFileWriter();
+
+        std::cout << std::setw(12) << "Writer" << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)"
+                  << std::setw(14) << "p99.9 (us)" << std::setw(10) << "Writes" << std::setw(10) << "Stalls" << "\n";
+
+        const std::pair<FileWriter, const char*> writers[] = {
+            { FileWriter::Buffered, "buffered" },
+            { FileWriter::Overlapped, "overlapped" },
+        };
+
+        for (const auto& [writer, name] : writers) {
+            pLog.SetFileWriter(writer);
+            const auto& stats = pLog.GetStats();
+            auto before = stats.diskLatency.Take();
+            uint64_t writesBefore = stats.fileWrites.load();
+            uint64_t stallsBefore = stats.writeStalls.load();
+
+            // Paced bursts: a steady stream rather than one burst that only measures queueing
+            std::vector<std::thread> threads;
+            for (int t = 0; t < config.numThreads; ++t) {
+                threads.emplace_back([&config, t]() {
+                    for (int i = 0; i < config.messagesPerThread; ++i) {
+                        pLog.LogFormat<"disk latency probe thread={} seq={}">(LogLevel::Info, 0, t, i);
+                        if (i % 500 == 499) std::this_thread::sleep_for(milliseconds(1));
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            std::this_thread::sleep_for(milliseconds(200));  // let the last batches reach the disk
+
+            auto after = stats.diskLatency.Take();
+            for (int i = 0; i < LatencyHistogram::BUCKETS; ++i) after[i] -= before[i];
+
+            std::cout << std::setw(12) << name
+                      << std::setw(12) << LatencyHistogram::Percentile(after, 0.50)
+                      << std::setw(12) << LatencyHistogram::Percentile(after, 0.99)
+                      << std::setw(14) << LatencyHistogram::Percentile(after, 0.999)
+                      << std::setw(10) << stats.fileWrites.load() - writesBefore
+                      << std::setw(10) << stats.writeStalls.load() - stallsBefore << "\n";
+        }
+
+        pLog.SetFileWriter(previous);
+    }
+
+    static void PrintScalingResults(const std::vector<ScalingResult>& results) {
+        std::cout << "\n--- Producer Scaling Results ---\n";
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::setw(10) << "Producers" << std::setw(16) << "msg/s"
+                  << std::setw(10) << "Lost" << std::setw(12) << "OutOfOrder"
+                  << std::setw(14) << "FullRetries" << "\n";
+        for (const auto& r : results) {
+            std::cout << std::setw(10) << r.producers << std::setw(16) << r.messagesPerSecond
+                      << std::setw(10) << r.lostMessages << std::setw(12) << r.outOfOrder
+                      << std::setw(14) << r.fullRetries << "\n";
+        }
+        std::cout << "-------------------------------\n";
+    }
+
     static void PrintResults(const std::string& testName, const BenchmarkResults& results) {
         std::cout << "\n--- " << testName << " Results ---\n";
         std::cout << std::fixed << std::setprecision(2);
@@ -189,8 +910,52 @@ public:
         std::cout << "Total logs: " << stats.totalLogs.load() << "\n";
         std::cout << "Logs/second: " << stats.GetLogsPerSecond() << "\n";
         std::cout << "Bytes written: " << stats.bytesWritten.load() << "\n";
-        std::cout << "Files rotated: " << stats.filesRotated.load() << "\n";
-        std::cout << "Compressions: " << stats.compressionCount.load() << "\n\n";
+        uint64_t fileWrites = stats.fileWrites.load();
+        std::cout << "File writes: " << fileWrites;
+        if (fileWrites > 0) {
+            std::cout << " (" << (double)stats.totalLogs.load() / fileWrites << " logs/write)";
+        }
+        std::cout << "\n";
+        std::cout << "Enqueue-to-disk p99: " << stats.diskLatency.Percentile(0.99) << " us\n";
+        std::cout << "Files rotated: " << stats.filesRotated.load()
+                  << " (stalls: " << stats.rotationStalls.load() << ")\n";
+        std::cout << "Compressions: " << stats.compressionCount.load() << "\n";
+        if (stats.liveCompressedOut.load() > 0) {
+            std::cout << "Live compression: " << stats.liveCompressedIn.load() << " -> " << stats.liveCompressedOut.load()
+                      << " bytes (" << (double)stats.liveCompressedIn.load() / stats.liveCompressedOut.load() << "x)\n";
+        }
+        std::cout << "Maintenance tasks: " << stats.maintenanceDone.load() << " done, "
+                  << stats.maintenanceFailed.load() << " failed, " << stats.maintenanceActive.load() << " running, "
+                  << stats.maintenanceQueued.load() << " queued (last cleanup: "
+                  << stats.lastCleanupMicros.load() / 1000.0 << " ms)\n";
+        std::cout << "Uploads: " << stats.upload.done.load() << " done, " << stats.upload.failed.load()
+                  << " failed attempts, " << stats.upload.queued.load() << " queued ("
+                  << stats.upload.bytesSent.load() / (1024 * 1024) << " MB sent)\n";
+        std::cout << "Index blocks written: " << stats.indexBlocks.load() << "\n";
+        std::cout << "Flight recorder dumps: " << stats.flightDumps.load() << "\n";
+        std::cout << "Producer rings registered: " << stats.ringsRegistered.load()
+                  << " (reclaimed: " << stats.ringsReclaimed.load() << ")\n";
+        std::cout << "Worker parks: " << stats.workerParks.load()
+                  << " (producer wakeups: " << stats.workerWakeups.load() << ")\n\n";
+
+        auto rings = stats.GetRingStats();
+        if (!rings.empty()) {
+            std::cout << "Producer rings:\n";
+            for (const auto& r : rings) {
+                std::cout << "  thread " << r.threadId << ": depth " << r.depth << "/" << r.capacity
+                          << ", pushed " << r.pushed << ", drops " << r.drops
+                          << (r.orphaned ? " (orphaned)" : "") << "\n";
+            }
+            std::cout << "\n";
+        }
+
+        std::cout << "Sinks:\n";
+        for (const auto& sink : pLog.GetSinkStats()) {
+            std::cout << "  " << sink.name << ": written " << sink.written
+                      << ", dropped " << sink.dropped << ", stalls " << sink.stalls
+                      << ", depth " << sink.depth << "/" << sink.capacity << "\n";
+        }
+        std::cout << "\n";
         
         std::cout << "Logs by level:\n";
         const char* levelNames[] = {"Trace", "Debug", "Info", "Warning", "Error", "Quest", "Packets"};
@@ -231,6 +996,43 @@ int main() {
     auto results3 = LogBenchmark::RunStressTest(config);
     LogBenchmark::PrintResults("Stress Test", results3);
 
+    // Test 4: Producer scaling (1 -> 64 producers)
+    config.messagesPerThread = 20000;
+    auto scaling = LogBenchmark::RunProducerScaling(config);
+    LogBenchmark::PrintScalingResults(scaling);
+
+    // Test 5: Producer-side cost
+    config.messagesPerThread = 100000;
+    LogBenchmark::RunProducerCost(config);
+
+    // Test 6: Idle CPU and wake latency of the worker
+    LogBenchmark::RunWorkerWakeup();
+
+    // Test 7: Enqueue-to-disk latency per file writer
+    config.messagesPerThread = 20000;
+    LogBenchmark::RunDiskLatency(config);
+
+    // Test 8: Cost of a call on a disabled level
+    LogBenchmark::RunDisabledLevelCost(1000000);
+
+    // Test 9: Flight recorder capture cost and Error dump
+    LogBenchmark::RunFlightRecorderCost(1000000);
+
+    // Test 10: Deflate cost per core of segmentCompression=gzip
+    LogBenchmark::RunLiveCompressionCost(64 * 1024 * 1024, 65536);
+
+    // Test 11: Day-pack deflate throughput versus thread count
+    LogBenchmark::RunParallelDeflateScaling(256 * 1024 * 1024, 6);
+
+    // Test 12: Backup upload queue (parallel transfers, bandwidth cap, resume)
+    LogBenchmark::RunUploadPipeline(8, 8 * 1024 * 1024);
+
+    // Test 13: Sidecar index build cost and lookup selectivity
+    LogBenchmark::RunIndexSelectivity(2000000, Index::DEFAULT_BLOCK_BYTES);
+
+    // Test 14: Cost of messageEscape on clean and dirty payloads
+    LogBenchmark::RunEscapeCost(2000000);
+
     // Print overall statistics
     LogBenchmark::PrintStatistics();
 
@@ -0,0 +1,254 @@
+﻿// crashtest - exercita o caminho do dreno de emergência (LogCrash.h) dentro de um handler de sinal real
+//
+// Uso: crashtest [diretório]
+//      Para cada sinal (SIGSEGV, SIGABRT) um processo filho abre um .log e um .lsb, instala o handler
+//      com sigaction e morre com o sinal. O handler monta as mensagens "pendentes" com
+//      Crash::RenderLine/EncodeRecord num LineBuffer e as grava com write(2), como o EmergencyDrain.
+//      O pai confere que o filho morreu pelo sinal e que o .log bate com o Segment::TextRenderer
+//      e o .lsb decodifica com o Segment::Decoder. Sai com 0 se tudo conferir.
+
+#include "LogCrash.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace WYD_Server;
+
+namespace {
+    constexpr uint64_t BASE_MICROS = 1705312800000000ull;  // 2024-01-15 10:00:00 UTC
+    constexpr int FRACTION_DIGITS = 3;
+
+    struct PendingMessage {
+        uint8_t level;
+        uint64_t micros;
+        uint32_t ip;
+        const char* msg;
+        const char* extra;
+    };
+
+    // Já gravadas no segmento antes do crash (tabela de strings em uso)
+    const PendingMessage WRITTEN[] = {
+        { 2, BASE_MICROS + 1000, 0, "Servidor iniciado", "" },
+        { 2, BASE_MICROS + 2500, 0, "Servidor iniciado", "canal 2" },
+    };
+
+    // Ainda nas filas no momento do crash: só o dreno as grava
+    const PendingMessage PENDING[] = {
+        { 2, BASE_MICROS + 3000, 0, "Jogador conectado", "conta=teste" },
+        { 4, BASE_MICROS + 3250, 0x0A000001, "Falha ao salvar personagem", "timeout=30s" },
+        { 3, BASE_MICROS + 1001500, 0, "Nome com\r\nquebra e \x01 controle", "" },
+        { 6, BASE_MICROS + 1002000, 0xC0A80001, "Pacote 0x1F", "len=128" },
+    };
+
+    constexpr size_t PENDING_COUNT = sizeof(PENDING) / sizeof(PENDING[0]);
+
+    // Estado do handler: tudo pronto antes do sinal, como no LogSystem
+    int textFd = -1;
+    int binaryFd = -1;
+    Crash::LineBuffer line;
+
+    void WriteAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            data += n;
+            size -= (size_t)n;
+        }
+    }
+
+    // Só funções async-signal-safe: LineBuffer fixo e write(2)
+    void DrainHandler(int sig) {
+        for (const auto& m : PENDING) {
+            line.Clear();
+            Crash::RenderLine(line, m.level, m.micros, 0, FRACTION_DIGITS, m.ip, m.msg, m.extra,
+                Segment::EscapeMode::Control);
+            WriteAll(textFd, line.Data(), line.Size());
+        }
+
+        uint64_t lastMicros = PENDING[0].micros;
+        line.Clear();
+        Crash::EncodeReset(line, lastMicros);
+        WriteAll(binaryFd, line.Data(), line.Size());
+        for (const auto& m : PENDING) {
+            line.Clear();
+            Crash::EncodeRecord(line, m.level, (int64_t)(m.micros - lastMicros), m.ip, m.msg, m.extra);
+            WriteAll(binaryFd, line.Data(), line.Size());
+            lastMicros = m.micros;
+        }
+
+        // SA_RESETHAND já devolveu o sinal ao padrão: o processo morre com ele
+        raise(sig);
+    }
+
+    [[noreturn]] void RunChild(int sig, const std::string& textPath, const std::string& binaryPath) {
+        textFd = open(textPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        binaryFd = open(binaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (textFd < 0 || binaryFd < 0) {
+            _exit(3);
+        }
+
+        // Segmento em andamento: cabeçalho e registros normais do Encoder
+        Segment::Encoder encoder;
+        std::string segment;
+        encoder.WriteHeader(BASE_MICROS, segment);
+        for (const auto& m : WRITTEN) {
+            encoder.Encode(m.level, m.micros, m.ip, m.msg, m.extra, true, segment);
+        }
+        WriteAll(binaryFd, segment.data(), segment.size());
+
+        struct sigaction action {};
+        action.sa_handler = DrainHandler;
+        action.sa_flags = SA_RESETHAND;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(sig, &action, nullptr) != 0) {
+            _exit(3);
+        }
+
+        if (sig == SIGABRT) {
+            abort();
+        }
+        raise(sig);
+        _exit(4);   // Não deveria chegar aqui
+    }
+
+    bool ReadWholeFile(const std::string& path, std::string& data) {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+
+        data.clear();
+        char buffer[1 << 16];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            data.append(buffer, n);
+        }
+
+        bool ok = !ferror(f);
+        fclose(f);
+        return ok;
+    }
+
+    bool SameRecord(const Segment::Record& rec, const PendingMessage& m) {
+        return rec.level == m.level && rec.micros == m.micros && rec.ip == m.ip &&
+            rec.message == m.msg && rec.extra == m.extra;
+    }
+
+    bool CheckText(const char* name, const std::string& path) {
+        std::string data;
+        if (!ReadWholeFile(path, data)) {
+            fprintf(stderr, "crashtest: %s: falha ao ler %s\n", name, path.c_str());
+            return false;
+        }
+
+        Segment::TextRenderer renderer(FRACTION_DIGITS, Segment::EscapeMode::Control);
+        std::string expected;
+        for (const auto& m : PENDING) {
+            Segment::Record rec;
+            rec.level = m.level;
+            rec.micros = m.micros;
+            rec.ip = m.ip;
+            rec.message = m.msg;
+            rec.extra = m.extra;
+            renderer.Render(rec, expected);
+        }
+
+        if (data != expected) {
+            fprintf(stderr, "crashtest: %s: %s difere do TextRenderer\n--- esperado\n%s--- gravado\n%s",
+                name, path.c_str(), expected.c_str(), data.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckSegment(const char* name, const std::string& path) {
+        std::string data;
+        if (!ReadWholeFile(path, data)) {
+            fprintf(stderr, "crashtest: %s: falha ao ler %s\n", name, path.c_str());
+            return false;
+        }
+
+        Segment::Decoder decoder(data.data(), data.size());
+        if (!decoder.ReadHeader()) {
+            fprintf(stderr, "crashtest: %s: %s sem cabeçalho LSMB\n", name, path.c_str());
+            return false;
+        }
+
+        std::vector<const PendingMessage*> expected;
+        for (const auto& m : WRITTEN) expected.push_back(&m);
+        for (const auto& m : PENDING) expected.push_back(&m);
+
+        Segment::Record rec;
+        size_t count = 0;
+        while (decoder.Next(rec)) {
+            if (count >= expected.size() || !SameRecord(rec, *expected[count])) {
+                fprintf(stderr, "crashtest: %s: registro %zu de %s não confere\n", name, count, path.c_str());
+                return false;
+            }
+            ++count;
+        }
+
+        if (decoder.IsCorrupt() || count != expected.size()) {
+            fprintf(stderr, "crashtest: %s: %s com %zu de %zu registros%s\n", name, path.c_str(),
+                count, expected.size(), decoder.IsCorrupt() ? " (corrompido)" : "");
+            return false;
+        }
+        return true;
+    }
+
+    bool RunCase(int sig, const char* name, const std::string& dir) {
+        std::string textPath = dir + "/crashtest_" + name + ".log";
+        std::string binaryPath = dir + "/crashtest_" + name + Segment::FILE_EXTENSION;
+
+        fflush(nullptr);
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "crashtest: fork falhou\n");
+            return false;
+        }
+        if (pid == 0) {
+            RunChild(sig, textPath, binaryPath);
+        }
+
+        int status = 0;
+        if (waitpid(pid, &status, 0) != pid) {
+            fprintf(stderr, "crashtest: %s: waitpid falhou\n", name);
+            return false;
+        }
+        if (!WIFSIGNALED(status) || WTERMSIG(status) != sig) {
+            fprintf(stderr, "crashtest: %s: filho não morreu pelo sinal (status %d)\n", name, status);
+            return false;
+        }
+
+        bool ok = CheckText(name, textPath) && CheckSegment(name, binaryPath);
+        if (ok) {
+            remove(textPath.c_str());
+            remove(binaryPath.c_str());
+            printf("crashtest: %s ok (%zu mensagens drenadas)\n", name, PENDING_COUNT);
+        }
+        return ok;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+
+    // RenderLine recebe o deslocamento UTC pronto; o TextRenderer usa localtime
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    bool ok = RunCase(SIGSEGV, "SIGSEGV", dir);
+    ok = RunCase(SIGABRT, "SIGABRT", dir) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Display pipeline benchmark - runs the TargetSide batching stage against a headless surface.
+// No Windows dependency: builds and runs on Linux as well.
+//
+// Usage: display_benchmark [lines] [linesPerSecond] [fps] [maxLines]
+
+#include "LogDisplay.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace WYD_Server;
+using namespace std::chrono;
+
+struct DisplayScenario {
+    uint64_t lines = 1000000;
+    uint64_t linesPerSecond = 200000;   // Simulated arrival rate (timestamps are synthetic)
+    int fps = 30;
+    size_t maxLines = 10000;
+};
+
+struct DisplayResult {
+    double wallSeconds = 0;
+    Display::HeadlessSurface surface;
+    size_t trackedLines = 0;
+};
+
+class DisplayBenchmark {
+public:
+    // fps <= 0 publishes one frame per line (the pre-batching behaviour)
+    static DisplayResult Run(const DisplayScenario& scenario, int fps) {
+        static const uint32_t colors[] = { 0x00FF00, 0x00FF00, 0x00FFFF, 0x00FF00, 0x0000FF, 0xFFC800, 0x00FF00 };
+        constexpr size_t colorCount = sizeof(colors) / sizeof(colors[0]);
+
+        std::vector<std::string> lines;
+        for (size_t i = 0; i < colorCount; ++i) {
+            lines.push_back("[2025-01-01 12:00:00.000] [INFO] Player entered map " + std::to_string(i) +
+                " [pos=2100,2100] [IP:192.168.0.10]\r\n");
+        }
+
+        DisplayResult result;
+        Display::Batcher batcher;
+        batcher.SetMaxFps(fps > 0 ? fps : 0);
+        batcher.SetMaxLines(scenario.maxLines);
+
+        const uint64_t stepNs = 1000000000ull / scenario.linesPerSecond;
+        uint64_t now = 0;
+
+        auto start = high_resolution_clock::now();
+        for (uint64_t i = 0; i < scenario.lines; ++i) {
+            size_t kind = (size_t)(i % 11) < colorCount ? (size_t)(i % 11) : 0;  // Mostly repeated colors
+            batcher.Append(lines[kind], colors[kind]);
+            now += stepNs;
+
+            // Sustained burst: the sink never goes idle, so only the frame interval publishes
+            batcher.Publish(result.surface, now, fps <= 0);
+        }
+        batcher.Publish(result.surface, now, true);     // Queue drained: idle flush
+        auto end = high_resolution_clock::now();
+
+        result.wallSeconds = duration<double>(end - start).count();
+        result.trackedLines = batcher.GetLineCount();
+        return result;
+    }
+
+    static void Print(const char* name, const DisplayScenario& scenario, const DisplayResult& r) {
+        const Display::HeadlessSurface& s = r.surface;
+        double simulatedSeconds = (double)scenario.lines / (double)scenario.linesPerSecond;
+
+        std::cout << "\n--- " << name << " ---\n";
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Frames:               " << s.frames << " (" << (double)s.frames / simulatedSeconds << " per simulated second)\n";
+        std::cout << "Color runs:           " << s.runs << "\n";
+        std::cout << "Top trims:            " << s.trims << "\n";
+        std::cout << "Window resets:        " << s.resets << "\n";
+        std::cout << "Window calls (est.):  " << s.EstimatedWindowCalls() << " ("
+                  << (double)s.EstimatedWindowCalls() / (double)scenario.lines << " per line)\n";
+        std::cout << "Lines in window:      " << s.lines << " (tracked " << r.trackedLines << ")\n";
+        std::cout << "Batching time:        " << r.wallSeconds * 1000.0 << " ms ("
+                  << (double)scenario.lines / r.wallSeconds << " lines/s)\n";
+    }
+};
+
+int main(int argc, char* argv[]) {
+    DisplayScenario scenario;
+    if (argc > 1) scenario.lines = strtoull(argv[1], nullptr, 10);
+    if (argc > 2) scenario.linesPerSecond = strtoull(argv[2], nullptr, 10);
+    if (argc > 3) scenario.fps = atoi(argv[3]);
+    if (argc > 4) scenario.maxLines = (size_t)strtoull(argv[4], nullptr, 10);
+
+    if (scenario.lines == 0 || scenario.linesPerSecond == 0 || scenario.fps <= 0 || scenario.maxLines == 0) {
+        fprintf(stderr, "Usage: display_benchmark [lines] [linesPerSecond] [fps] [maxLines]\n");
+        return 2;
+    }
+
+    std::cout << "LogSystem Display Pipeline Benchmark\n";
+    std::cout << "====================================\n";
+    std::cout << "Lines: " << scenario.lines << " at " << scenario.linesPerSecond << " lines/s (simulated)\n";
+    std::cout << "Window limit: " << scenario.maxLines << " lines\n";
+
+    DisplayResult perLine = DisplayBenchmark::Run(scenario, 0);
+    DisplayBenchmark::Print("One frame per line", scenario, perLine);
+
+    DisplayResult batched = DisplayBenchmark::Run(scenario, scenario.fps);
+    std::string name = "Batched at " + std::to_string(scenario.fps) + " fps";
+    DisplayBenchmark::Print(name.c_str(), scenario, batched);
+
+    if (batched.surface.EstimatedWindowCalls() > 0) {
+        std::cout << "\nWindow call reduction: " << std::setprecision(1)
+                  << (double)perLine.surface.EstimatedWindowCalls() / (double)batched.surface.EstimatedWindowCalls() << "x\n";
+    }
+
+    bool consistent = perLine.surface.lines == perLine.trackedLines && batched.surface.lines == batched.trackedLines &&
+        batched.surface.lines == perLine.surface.lines;
+    if (!consistent) {
+        std::cout << "ERROR: line accounting mismatch\n";
+        return 1;
+    }
+    return 0;
+}
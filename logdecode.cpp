@@ -0,0 +1,126 @@
+﻿// logdecode - converte segmentos binários (.lsb) do LogSystem de volta para o texto do .log
+//
+// Uso: logdecode <segmento.lsb>... [-o saida.log] [-p s|ms|us]
+//      Sem -o a saída vai para stdout. -p escolhe a precisão do timestamp (padrão ms).
+
+#include "LogSegment.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace WYD_Server;
+
+namespace {
+    constexpr size_t OUTPUT_CHUNK = 4 * 1024 * 1024;  // Escrita em blocos grandes para não ser o gargalo
+
+    bool ReadWholeFile(const char* path, std::vector<char>& data) {
+        FILE* f = fopen(path, "rb");
+        if (!f) return false;
+
+        data.clear();
+        char buffer[1 << 16];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            data.insert(data.end(), buffer, buffer + n);
+        }
+
+        bool ok = !ferror(f);
+        fclose(f);
+        return ok;
+    }
+
+    bool DecodeSegment(const char* path, FILE* out, int fractionDigits, uint64_t& records) {
+        std::vector<char> data;
+        if (!ReadWholeFile(path, data)) {
+            fprintf(stderr, "logdecode: falha ao ler %s\n", path);
+            return false;
+        }
+
+        Segment::Decoder decoder(data.data(), data.size());
+        if (!decoder.ReadHeader()) {
+            fprintf(stderr, "logdecode: %s não é um segmento LSMB válido\n", path);
+            return false;
+        }
+
+        Segment::TextRenderer renderer(fractionDigits);
+        Segment::Record rec;
+        std::string text;
+        text.reserve(OUTPUT_CHUNK + 4096);
+
+        while (decoder.Next(rec)) {
+            renderer.Render(rec, text);
+            ++records;
+
+            if (text.size() >= OUTPUT_CHUNK) {
+                fwrite(text.data(), 1, text.size(), out);
+                text.clear();
+            }
+        }
+        fwrite(text.data(), 1, text.size(), out);
+
+        if (decoder.IsCorrupt()) {
+            // Segmento truncado (ex.: queda do servidor no meio de uma escrita): o que veio antes é mantido
+            fprintf(stderr, "logdecode: %s corrompido/truncado perto do byte %zu\n",
+                path, decoder.Offset(data.data()));
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<const char*> inputs;
+    const char* outputPath = nullptr;
+    int fractionDigits = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            const char* precision = argv[++i];
+            if (strcmp(precision, "s") == 0) fractionDigits = 0;
+            else if (strcmp(precision, "ms") == 0) fractionDigits = 3;
+            else if (strcmp(precision, "us") == 0) fractionDigits = 6;
+            else {
+                fprintf(stderr, "logdecode: precisão inválida '%s' (use s, ms ou us)\n", precision);
+                return 2;
+            }
+        }
+        else {
+            inputs.push_back(argv[i]);
+        }
+    }
+
+    if (inputs.empty()) {
+        fprintf(stderr, "Uso: logdecode <segmento.lsb>... [-o saida.log] [-p s|ms|us]\n");
+        return 2;
+    }
+
+    FILE* out = stdout;
+    if (outputPath) {
+        out = fopen(outputPath, "wb");
+        if (!out) {
+            fprintf(stderr, "logdecode: falha ao criar %s\n", outputPath);
+            return 2;
+        }
+    }
+
+    uint64_t records = 0;
+    bool ok = true;
+    for (const char* path : inputs) {
+        ok = DecodeSegment(path, out, fractionDigits, records) && ok;
+    }
+
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "logdecode: %llu registros gravados em %s\n", (unsigned long long)records, outputPath);
+    }
+    else {
+        fflush(out);
+    }
+
+    return ok ? 0 : 1;
+}
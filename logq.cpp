@@ -0,0 +1,1024 @@
+﻿// logq - busca nos logs do LogSystem: segmentos (.log, .lsb, .log.gz, .lsb.gz) e pacotes ZIP da
+//        limpeza (logpack_*.zip de compressMode=day, server_*.log.zip de compressMode=file)
+//
+// Uso: logq [filtros] <arquivo|pasta>... [-o saida.log] [-c] [-j threads] [-p s|ms|us]
+//      -from "AAAA-MM-DD[ HH:MM[:SS]]"  registros a partir deste horário (hora local, como no log)
+//      -to   "AAAA-MM-DD[ HH:MM[:SS]]"  ... até este horário, inclusive
+//      -level ERROR[,WARN,...]          TRACE, DEBUG, INFO, WARN, ERROR, QUEST, PACKETS
+//      -ip a.b.c.d                      registros deste IP
+//      -s texto                         linhas que contêm o texto
+//      -e regex                         linhas em que a regex (ECMAScript) casa
+//      -c                               só imprime quantas linhas foram encontradas
+//      -j                               threads (padrão: núcleos da máquina)
+//      -p                               precisão do timestamp dos segmentos binários (como no logdecode)
+//
+// Pastas são expandidas para os segmentos e pacotes que contêm. Arquivos são lidos mapeados em memória
+// e a busca é dividida em partes independentes (trechos de ~16 MB de um .log, um .gz/.lsb inteiro, uma
+// entrada de ZIP), processadas em paralelo. Com -from/-to/-level/-ip o índice lateral (.idx) limita a
+// leitura aos blocos que podem ter resultados. As linhas saem em ordem de horário.
+// Retorno: 0 com resultados, 1 sem resultados, 2 em erro.
+
+#include "LogSegment.h"
+#include "LogIndex.h"
+#include "LogSimd.h"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <regex>
+#include <thread>
+#include <atomic>
+#include <queue>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <bit>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace WYD_Server;
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t PIECE_BYTES = 16 * 1024 * 1024;  // Trecho de .log processado por uma thread
+    constexpr size_t OUTPUT_CHUNK = 4 * 1024 * 1024;
+    constexpr uint32_t ALL_LEVELS = (1u << Segment::LEVEL_COUNT) - 1;
+
+    // =======================
+    // Arquivo mapeado em memória (somente leitura)
+    // =======================
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+#ifdef _WIN32
+            if (data) UnmapViewOfFile(data);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+            if (data) munmap((void*)data, size);
+            if (fd >= 0) close(fd);
+#endif
+        }
+
+        bool Open(const std::string& path) {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            LARGE_INTEGER fileSize;
+            if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+                return false;
+            }
+            size = (size_t)fileSize.QuadPart;
+            if (size == 0) {
+                return true;
+            }
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            data = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+            fd = open(path.c_str(), O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                return false;
+            }
+            size = (size_t)st.st_size;
+            if (size == 0) {
+                return true;
+            }
+            void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            data = view == MAP_FAILED ? nullptr : (const char*)view;
+            if (data) {
+                madvise(view, size, MADV_SEQUENTIAL);
+            }
+#endif
+            return data != nullptr;
+        }
+
+        const char* Data() const { return data; }
+        size_t Size() const { return size; }
+
+    private:
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    // =======================
+    // Horário local como chave ordenável: o mesmo valor para "[AAAA-MM-DD HH:MM:SS.fff]" da linha
+    // e para -from/-to, sem mktime por linha
+    // =======================
+    uint64_t MakeKey(int year, int month, int day, int hour, int minute, int second, uint32_t micros) {
+        uint64_t days = ((uint64_t)year * 13 + (uint64_t)month) * 32 + (uint64_t)day;
+        return ((days * 24 + (uint64_t)hour) * 3600 + (uint64_t)minute * 60 + (uint64_t)second) * 1000000 + micros;
+    }
+
+    bool ParseDigits(const char* p, int count, int& value) {
+        value = 0;
+        for (int i = 0; i < count; ++i) {
+            if (p[i] < '0' || p[i] > '9') return false;
+            value = value * 10 + (p[i] - '0');
+        }
+        return true;
+    }
+
+    // "[AAAA-MM-DD HH:MM:SS[.f...]] " no início da linha; devolve a posição depois de "] "
+    const char* ParseStamp(const char* line, const char* end, uint64_t& key) {
+        int year, month, day, hour, minute, second;
+        if (end - line < 22 || line[0] != '[' || line[5] != '-' || line[8] != '-' || line[11] != ' ' ||
+            line[14] != ':' || line[17] != ':' ||
+            !ParseDigits(line + 1, 4, year) || !ParseDigits(line + 6, 2, month) || !ParseDigits(line + 9, 2, day) ||
+            !ParseDigits(line + 12, 2, hour) || !ParseDigits(line + 15, 2, minute) || !ParseDigits(line + 18, 2, second)) {
+            return nullptr;
+        }
+
+        const char* p = line + 20;
+        uint32_t micros = 0;
+        if (*p == '.') {
+            uint32_t scale = 100000;
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+                micros += (uint32_t)(*p - '0') * scale;
+                scale /= 10;
+            }
+        }
+        if (end - p < 2 || p[0] != ']' || p[1] != ' ') {
+            return nullptr;
+        }
+
+        key = MakeKey(year, month, day, hour, minute, second, micros);
+        return p + 2;
+    }
+
+    // "AAAA-MM-DD[ HH:MM[:SS]]"; upper = fim do intervalo (campos omitidos vão ao máximo)
+    bool ParseTimeArgument(const char* text, bool upper, uint64_t& key, uint64_t& utcMicros) {
+        int year, month, day, hour = -1, minute = -1, second = -1;
+        int fields = sscanf(text, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second);
+        if (fields < 3 || fields == 4) {
+            return false;
+        }
+        if (fields == 3) {
+            hour = upper ? 23 : 0;
+        }
+        if (fields <= 4) {
+            minute = upper ? 59 : 0;
+        }
+        if (fields <= 5) {
+            second = upper ? 59 : 0;
+        }
+        key = MakeKey(year, month, day, hour, minute, second, upper ? 999999 : 0);
+
+        std::tm tm{};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_min = minute;
+        tm.tm_sec = second;
+        tm.tm_isdst = -1;
+        time_t t = mktime(&tm);
+        if (t == (time_t)-1) {
+            return false;
+        }
+
+        // O índice guarda UTC. Perto da troca de horário de verão o mesmo horário local pode valer duas
+        // vezes: ali a janela do índice ganha uma hora de folga (o filtro exato é o da linha)
+        auto isDst = [](time_t when) {
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &when);
+#else
+            localtime_r(&when, &local);
+#endif
+            return local.tm_isdst > 0;
+        };
+        int64_t seconds = (int64_t)t + (upper ? 1 : 0);
+        if (isDst(t - 3600) != isDst(t) || isDst(t + 3600) != isDst(t)) {
+            seconds += upper ? 3600 : -3600;
+        }
+        utcMicros = seconds > 0 ? (uint64_t)seconds * 1000000 : 0;
+        return true;
+    }
+
+    bool ParseIp(const char* text, uint32_t& ip) {
+        unsigned a, b, c, d;
+        char extra;
+        if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        ip = (a << 24) | (b << 16) | (c << 8) | d;
+        return true;
+    }
+
+    int LevelFromName(std::string_view name) {
+        for (uint8_t level = 0; level < Segment::LEVEL_COUNT; ++level) {
+            std::string_view tag = Segment::LevelTag(level);
+            if (tag.substr(1, tag.size() - 2) == name) {
+                return level;
+            }
+        }
+        return -1;
+    }
+
+    // =======================
+    // Filtro de uma busca
+    // =======================
+    struct Filter {
+        uint64_t fromKey = 0;
+        uint64_t toKey = UINT64_MAX;
+        uint64_t fromMicros = 0;
+        uint64_t toMicros = UINT64_MAX;
+        uint32_t levelMask = ALL_LEVELS;
+        uint32_t ip = 0;
+        std::string ipTag;                          // "[IP:a.b.c.d]" no fim da linha
+        std::unique_ptr<Simd::Finder> substring;
+        std::unique_ptr<std::regex> regex;
+        std::unique_ptr<Simd::Finder> driver;       // Texto que toda linha aceita contém: busca vetorizada no trecho
+
+        bool HasRecordFilter() const {
+            return fromKey != 0 || toKey != UINT64_MAX || levelMask != ALL_LEVELS || ip != 0;
+        }
+
+        Index::Query IndexQuery() const {
+            Index::Query query;
+            query.fromMicros = fromMicros;
+            query.toMicros = toMicros;
+            query.levelMask = (uint16_t)levelMask;
+            query.ip = ip;
+            return query;
+        }
+
+        // Escolhe o texto usado para achar candidatos: o -s, o IP ou o nível quando é um só
+        void ChooseDriver() {
+            if (substring) {
+                driver = std::make_unique<Simd::Finder>(substring->Pattern());
+            }
+            else if (ip != 0) {
+                driver = std::make_unique<Simd::Finder>(ipTag);
+            }
+            else if (std::has_single_bit(levelMask)) {
+                std::string tag = "] ";
+                tag += Segment::LevelTag((uint8_t)std::countr_zero(levelMask));
+                tag += ' ';
+                driver = std::make_unique<Simd::Finder>(tag);
+            }
+        }
+
+        // line sem o \r\n; key recebe o horário da linha, se ela tiver
+        bool Matches(const char* line, const char* end, uint64_t& key) const {
+            uint64_t stamp;
+            const char* rest = ParseStamp(line, end, stamp);
+            if (rest) {
+                key = stamp;
+                if (stamp < fromKey || stamp > toKey) {
+                    return false;
+                }
+                if (levelMask != ALL_LEVELS) {
+                    const char* tagEnd = rest < end && *rest == '[' ? (const char*)memchr(rest, ']', (size_t)(end - rest)) : nullptr;
+                    int level = tagEnd ? LevelFromName(std::string_view(rest + 1, (size_t)(tagEnd - rest - 1))) : -1;
+                    if (level < 0 || !(levelMask & (1u << level))) {
+                        return false;
+                    }
+                }
+                if (ip != 0 && ((size_t)(end - line) < ipTag.size() ||
+                    memcmp(end - ipTag.size(), ipTag.data(), ipTag.size()) != 0)) {
+                    return false;
+                }
+            }
+            else if (HasRecordFilter()) {
+                return false;   // Continuação de uma mensagem com quebra de linha: sem horário/nível/IP
+            }
+
+            if (substring && substring.get() != driver.get() && !substring->Find(line, end)) {
+                return false;
+            }
+            return !regex || std::regex_search(line, end, *regex);
+        }
+    };
+
+    // =======================
+    // Resultado de uma parte: linhas aceitas (texto original) e o horário de cada uma
+    // =======================
+    struct Results {
+        std::string text;
+        std::vector<std::pair<uint64_t, size_t>> lines;    // horário, início em text
+        uint64_t count = 0;
+        uint64_t bytesScanned = 0;
+        std::string error;
+    };
+
+    class Scanner {
+    public:
+        Scanner(const Filter& filter, bool countOnly, Results& results)
+            : filter(filter), countOnly(countOnly), results(results) {}
+
+        // [begin, end) começa no início de uma linha; a última linha pode não ter \n
+        void ScanText(const char* begin, const char* end) {
+            results.bytesScanned += (size_t)(end - begin);
+
+            if (filter.driver) {
+                const char* p = begin;
+                while (p < end) {
+                    const char* hit = filter.driver->Find(p, end);
+                    if (!hit) {
+                        break;
+                    }
+                    const char* lineStart = hit;
+                    while (lineStart > p && lineStart[-1] != '\n') {
+                        --lineStart;
+                    }
+                    const char* newline = (const char*)memchr(hit, '\n', (size_t)(end - hit));
+                    const char* lineEnd = newline ? newline + 1 : end;
+                    Consider(lineStart, lineEnd, begin);
+                    p = lineEnd;
+                }
+                return;
+            }
+
+            for (const char* p = begin; p < end;) {
+                const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+                const char* lineEnd = newline ? newline + 1 : end;
+                Consider(p, lineEnd, begin);
+                p = lineEnd;
+            }
+        }
+
+        // Trecho de segmento binário que começa no cabeçalho (offset 0) ou num Reset
+        bool ScanBinary(const char* begin, const char* end, bool header, int fractionDigits) {
+            results.bytesScanned += (size_t)(end - begin);
+            Segment::Decoder decoder(begin, (size_t)(end - begin));
+            if (header && !decoder.ReadHeader()) {
+                return false;
+            }
+
+            Segment::TextRenderer renderer(fractionDigits);
+            Segment::Record rec;
+            std::string line;
+            uint64_t fromMicros = filter.fromKey != 0 ? filter.fromMicros : 0;
+            uint64_t toMicros = filter.toKey != UINT64_MAX ? filter.toMicros : UINT64_MAX;
+
+            while (decoder.Next(rec)) {
+                // Nível, IP e a janela larga em UTC antes de montar o texto
+                if (!(filter.levelMask & (1u << rec.level)) || (filter.ip != 0 && rec.ip != filter.ip) ||
+                    rec.micros < fromMicros || rec.micros > toMicros) {
+                    continue;
+                }
+                line.clear();
+                renderer.Render(rec, line);
+                if (filter.driver && !filter.driver->Find(line.data(), line.data() + line.size())) {
+                    continue;
+                }
+                Consider(line.data(), line.data() + line.size(), line.data());
+            }
+            return !decoder.IsCorrupt();
+        }
+
+    private:
+        void Consider(const char* line, const char* lineEnd, const char* begin) {
+            const char* content = lineEnd;
+            while (content > line && (content[-1] == '\n' || content[-1] == '\r')) {
+                --content;
+            }
+
+            uint64_t key = 0;
+            if (!filter.Matches(line, content, key)) {
+                return;
+            }
+            if (key == 0) {
+                key = PreviousKey(line, begin);
+            }
+
+            ++results.count;
+            if (!countOnly) {
+                results.lines.emplace_back(key, results.text.size());
+                results.text.append(line, lineEnd);
+                if (lineEnd == content) {
+                    results.text += "\r\n";     // Última linha de um arquivo sem quebra
+                }
+            }
+        }
+
+        // Linha sem horário achada pelo driver: herda o horário da linha anterior que tiver
+        uint64_t PreviousKey(const char* line, const char* begin) const {
+            uint64_t key = 0;
+            while (line > begin) {
+                const char* start = line - 1;
+                while (start > begin && start[-1] != '\n') {
+                    --start;
+                }
+                if (ParseStamp(start, line, key)) {
+                    return key;
+                }
+                line = start;
+            }
+            return 0;
+        }
+
+        const Filter& filter;
+        bool countOnly;
+        Results& results;
+    };
+
+    // =======================
+    // Descompressão (deflate cru das entradas ZIP, gzip multi-membro dos segmentos .gz)
+    // =======================
+    // Para de descomprimir quando out alcança limit (a busca não precisa do resto)
+    bool Inflate(const char* data, size_t size, bool gzip, uint64_t limit, size_t expected, std::string& out) {
+        z_stream zs{};
+        if (inflateInit2(&zs, gzip ? 15 + 16 : -15) != Z_OK) {
+            return false;
+        }
+
+        out.clear();
+        out.reserve((size_t)(std::min<uint64_t>)(expected ? expected : size * 4, limit));
+        zs.next_in = (Bytef*)data;
+        zs.avail_in = 0;
+        size_t remaining = size;
+        int rc = Z_OK;
+
+        while (out.size() < limit) {
+            if (zs.avail_in == 0) {
+                if (remaining == 0) break;
+                zs.avail_in = (uInt)(std::min<size_t>)(remaining, 1u << 30);
+                remaining -= zs.avail_in;
+            }
+
+            size_t before = out.size();
+            size_t chunk = 1 << 20;
+            out.resize(before + chunk);
+            zs.next_out = (Bytef*)out.data() + before;
+            zs.avail_out = (uInt)chunk;
+            rc = inflate(&zs, Z_NO_FLUSH);
+            out.resize(before + chunk - zs.avail_out);
+
+            if (rc == Z_STREAM_END) {
+                // .gz com vários membros (compressionBlockKB): o próximo começa logo depois
+                if (!gzip || (zs.avail_in == 0 && remaining == 0)) break;
+                inflateReset(&zs);
+            }
+            else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                break;
+            }
+            else if (rc == Z_BUF_ERROR && zs.avail_in == 0 && remaining == 0) {
+                break;      // Segmento ativo/truncado: fica o que foi possível ler
+            }
+        }
+
+        inflateEnd(&zs);
+        return rc == Z_OK || rc == Z_STREAM_END || rc == Z_BUF_ERROR;
+    }
+
+    // =======================
+    // Leitura do diretório central de um ZIP mapeado (com ZIP64)
+    // =======================
+    uint64_t Get(const char* p, int bytes) {
+        return Index::GetFixed(p, bytes);
+    }
+
+    struct ZipEntry {
+        std::string name;
+        int method = 0;             // 0 = stored, 8 = deflate
+        uint64_t offset = 0;        // Dados da entrada no arquivo
+        uint64_t compressedSize = 0;
+        uint64_t size = 0;
+    };
+
+    bool ReadZipDirectory(const char* data, size_t size, std::vector<ZipEntry>& entries) {
+        if (size < 22) return false;
+
+        // Fim do diretório central: os últimos 22 bytes mais o comentário (até 64 KB)
+        size_t eocd = SIZE_MAX;
+        for (size_t pos = size - 22, stop = size > 22 + 65535 ? size - 22 - 65535 : 0;; --pos) {
+            if (Get(data + pos, 4) == 0x06054b50) {
+                eocd = pos;
+                break;
+            }
+            if (pos == stop) break;
+        }
+        if (eocd == SIZE_MAX) return false;
+
+        uint64_t count = Get(data + eocd + 10, 2);
+        uint64_t directorySize = Get(data + eocd + 12, 4);
+        uint64_t directory = Get(data + eocd + 16, 4);
+        if ((count == 0xFFFF || directory == 0xFFFFFFFF) && eocd >= 20 && Get(data + eocd - 20, 4) == 0x07064b50) {
+            uint64_t zip64 = Get(data + eocd - 20 + 8, 8);
+            if (zip64 + 56 > size || Get(data + zip64, 4) != 0x06064b50) return false;
+            count = Get(data + zip64 + 32, 8);
+            directorySize = Get(data + zip64 + 40, 8);
+            directory = Get(data + zip64 + 48, 8);
+        }
+        if (directory + directorySize > size) return false;
+
+        const char* p = data + directory;
+        const char* end = p + directorySize;
+        for (uint64_t i = 0; i < count; ++i) {
+            if (end - p < 46 || Get(p, 4) != 0x02014b50) return false;
+            ZipEntry entry;
+            entry.method = (int)Get(p + 10, 2);
+            entry.compressedSize = Get(p + 20, 4);
+            entry.size = Get(p + 24, 4);
+            size_t nameLength = (size_t)Get(p + 28, 2);
+            size_t extraLength = (size_t)Get(p + 30, 2);
+            size_t commentLength = (size_t)Get(p + 32, 2);
+            uint64_t local = Get(p + 42, 4);
+            if ((size_t)(end - p) < 46 + nameLength + extraLength + commentLength) return false;
+            entry.name.assign(p + 46, nameLength);
+
+            // Extra ZIP64 (0x0001): só os campos que estouraram 32 bits, nesta ordem
+            for (const char* e = p + 46 + nameLength, *extraEnd = e + extraLength; extraEnd - e >= 4;) {
+                uint16_t id = (uint16_t)Get(e, 2);
+                uint16_t length = (uint16_t)Get(e + 2, 2);
+                const char* field = e + 4;
+                if (id == 0x0001) {
+                    if (entry.size == 0xFFFFFFFF) { entry.size = Get(field, 8); field += 8; }
+                    if (entry.compressedSize == 0xFFFFFFFF) { entry.compressedSize = Get(field, 8); field += 8; }
+                    if (local == 0xFFFFFFFF) { local = Get(field, 8); }
+                }
+                e += 4 + length;
+            }
+
+            if (local + 30 > size || Get(data + local, 4) != 0x04034b50) return false;
+            entry.offset = local + 30 + Get(data + local + 26, 2) + Get(data + local + 28, 2);
+            if (entry.offset + entry.compressedSize > size) return false;
+            entries.push_back(std::move(entry));
+            p += 46 + nameLength + extraLength + commentLength;
+        }
+        return true;
+    }
+
+    // =======================
+    // Plano da busca: segmentos (arquivos ou entradas de ZIP) e as partes processadas por thread
+    // =======================
+    bool EndsWith(std::string_view text, std::string_view suffix) {
+        return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+    }
+
+    struct Source {
+        std::string name;                       // Para mensagens: "logpack_x.zip:server_x_1.log"
+        std::shared_ptr<MappedFile> file;
+        uint64_t offset = 0;                    // Bytes do segmento (comprimidos, se for o caso) no arquivo
+        uint64_t storedSize = 0;
+        uint64_t size = 0;                      // Tamanho descomprimido, se conhecido
+        bool deflated = false;                  // Entrada ZIP com deflate
+        bool gzip = false;                      // .gz (segmentCompression=gzip)
+        bool binary = false;                    // .lsb
+        std::vector<Index::Range> ranges;       // Trechos a ler quando indexed
+        bool indexed = false;
+        uint64_t indexedEnd = 0;                // .gz: fim do último bloco (o resto é lido sempre)
+    };
+
+    struct Part {
+        size_t source;
+        uint64_t begin;
+        uint64_t end;                           // Só para .log sem compressão; os demais são lidos inteiros
+    };
+
+    class Planner {
+    public:
+        Planner(const Filter& filter, std::vector<Source>& sources, std::vector<Part>& parts)
+            : filter(filter), sources(sources), parts(parts) {}
+
+        bool AddPath(const std::string& path) {
+            std::error_code ec;
+            if (fs::is_directory(path, ec)) {
+                std::vector<std::string> files;
+                for (fs::directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+                    std::string name = it->path().filename().string();
+                    std::error_code fileEc;
+                    if (it->is_regular_file(fileEc) && IsLogFile(name)) {
+                        files.push_back(it->path().string());
+                    }
+                }
+                std::sort(files.begin(), files.end());
+                bool ok = true;
+                for (const auto& file : files) {
+                    ok = AddFile(file) && ok;
+                }
+                return ok;
+            }
+            return AddFile(path);
+        }
+
+        uint64_t SkippedBytes() const { return skipped; }
+
+    private:
+        static bool IsLogFile(const std::string& name) {
+            if (name.rfind("logpack_", 0) == 0) {
+                return EndsWith(name, ".zip");
+            }
+            if (name.rfind("server_", 0) != 0) {
+                return false;
+            }
+            for (const char* extension : { ".log", ".lsb", ".log.gz", ".lsb.gz", ".log.zip", ".lsb.zip" }) {
+                if (EndsWith(name, extension)) return true;
+            }
+            return false;
+        }
+
+        bool AddFile(const std::string& path) {
+            auto file = std::make_shared<MappedFile>();
+            if (!file->Open(path)) {
+                fprintf(stderr, "logq: falha ao ler %s\n", path.c_str());
+                return false;
+            }
+
+            if (EndsWith(path, ".zip")) {
+                std::vector<ZipEntry> entries;
+                if (!ReadZipDirectory(file->Data(), file->Size(), entries)) {
+                    fprintf(stderr, "logq: %s não é um ZIP válido\n", path.c_str());
+                    return false;
+                }
+
+                std::string archive = fs::path(path).filename().string();
+                for (const auto& entry : entries) {
+                    if (EndsWith(entry.name, Index::FILE_EXTENSION) || (entry.method != 0 && entry.method != 8)) {
+                        continue;
+                    }
+                    Source source = Describe(archive + ":" + entry.name, entry.name, file);
+                    source.offset = entry.offset;
+                    source.storedSize = entry.compressedSize;
+                    source.size = source.gzip ? 0 : entry.size;
+                    source.deflated = entry.method == 8;
+
+                    // Índice do segmento no mesmo pacote
+                    std::string index;
+                    for (const auto& candidate : entries) {
+                        if (filter.HasRecordFilter() && candidate.name == entry.name + Index::FILE_EXTENSION) {
+                            index = Extract(*file, candidate);
+                            break;
+                        }
+                    }
+                    Add(std::move(source), index);
+                }
+                return true;
+            }
+
+            Source source = Describe(path, fs::path(path).filename().string(), file);
+            source.storedSize = file->Size();
+            source.size = source.gzip ? 0 : file->Size();
+
+            std::string index;
+            if (filter.HasRecordFilter()) {
+                std::ifstream in(path + Index::FILE_EXTENSION, std::ios::binary);
+                index.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
+            Add(std::move(source), index);
+            return true;
+        }
+
+        static Source Describe(std::string name, std::string_view file, std::shared_ptr<MappedFile> mapped) {
+            Source source;
+            source.name = std::move(name);
+            source.file = std::move(mapped);
+            if (EndsWith(file, ".zip")) file.remove_suffix(4);
+            source.gzip = EndsWith(file, ".gz");
+            if (source.gzip) file.remove_suffix(3);
+            source.binary = EndsWith(file, Segment::FILE_EXTENSION);
+            return source;
+        }
+
+        static std::string Extract(const MappedFile& file, const ZipEntry& entry) {
+            const char* data = file.Data() + entry.offset;
+            if (entry.method == 0) {
+                return std::string(data, (size_t)entry.compressedSize);
+            }
+            std::string out;
+            Inflate(data, (size_t)entry.compressedSize, false, UINT64_MAX, (size_t)entry.size, out);
+            return out;
+        }
+
+        void Add(Source source, const std::string& index) {
+            Index::Reader reader;
+            uint16_t flags = (source.gzip ? Index::FLAG_COMPRESSED : 0) | (source.binary ? Index::FLAG_BINARY : 0);
+            if (filter.HasRecordFilter() && !index.empty() && reader.Load(index.data(), index.size()) &&
+                reader.GetFlags() == flags) {
+                // Tamanho do .gz descomprimido não é conhecido: o Select vai até o fim do último bloco
+                // e o que vier depois (segmento ainda aberto) é lido inteiro
+                uint64_t size = source.size;
+                if (source.gzip) {
+                    size = reader.GetBlocks().empty() ? 0 : reader.GetBlocks().back().offset + reader.GetBlocks().back().length;
+                    source.indexedEnd = size;
+                }
+                source.ranges = reader.Select(filter.IndexQuery(), size);
+                source.indexed = true;
+
+                uint64_t selected = 0;
+                for (const auto& range : source.ranges) selected += range.length;
+                skipped += size - selected;
+                if (source.ranges.empty() && !source.gzip) {
+                    return;     // Nenhum bloco pode ter resultados
+                }
+            }
+
+            size_t id = sources.size();
+            bool plainText = !source.binary && !source.gzip && !source.deflated;
+            sources.push_back(std::move(source));
+
+            if (!plainText) {
+                parts.push_back(Part{ id, 0, 0 });
+                return;
+            }
+
+            // .log mapeado: trechos de PIECE_BYTES cortados em fim de linha
+            const Source& s = sources.back();
+            std::vector<Index::Range> ranges = s.indexed ? s.ranges : std::vector<Index::Range>{ { 0, s.size } };
+            const char* data = s.file->Data() + s.offset;
+            for (const auto& range : ranges) {
+                uint64_t begin = range.offset;
+                uint64_t end = range.offset + range.length;
+                while (begin < end) {
+                    uint64_t cut = (std::min)(begin + PIECE_BYTES, end);
+                    if (cut < end) {
+                        const char* newline = (const char*)memchr(data + cut, '\n', (size_t)(end - cut));
+                        cut = newline ? (uint64_t)(newline - data) + 1 : end;
+                    }
+                    parts.push_back(Part{ id, begin, cut });
+                    begin = cut;
+                }
+            }
+        }
+
+        const Filter& filter;
+        std::vector<Source>& sources;
+        std::vector<Part>& parts;
+        uint64_t skipped = 0;
+    };
+
+    // =======================
+    // Execução de uma parte
+    // =======================
+    void RunPart(const Source& source, const Part& part, const Filter& filter, bool countOnly,
+        int fractionDigits, Results& results) {
+        Scanner scanner(filter, countOnly, results);
+        const char* stored = source.file->Data() + source.offset;
+
+        if (!source.binary && !source.gzip && !source.deflated) {
+            scanner.ScanText(stored + part.begin, stored + part.end);
+            return;
+        }
+
+        std::vector<Index::Range> ranges = source.ranges;
+
+        // Entrada ZIP indexada: a descompressão para no fim do último trecho selecionado
+        uint64_t limit = UINT64_MAX;
+        if (source.indexed && !source.gzip) {
+            limit = ranges.back().offset + ranges.back().length;
+        }
+
+        std::string inflated, gunzipped;
+        const char* data = stored;
+        size_t size = (size_t)source.storedSize;
+        if (source.deflated) {
+            if (!Inflate(data, size, false, limit, (size_t)source.size, inflated)) {
+                results.error = source.name + ": ZIP corrompido";
+                return;
+            }
+            data = inflated.data();
+            size = inflated.size();
+        }
+        if (source.gzip) {
+            if (!Inflate(data, size, true, UINT64_MAX, 0, gunzipped)) {
+                results.error = source.name + ": gzip corrompido";
+                return;
+            }
+            data = gunzipped.data();
+            size = gunzipped.size();
+        }
+
+        if (!source.indexed) {
+            ranges.assign(1, Index::Range{ 0, size });
+        }
+        else if (source.gzip && source.indexedEnd < size) {
+            ranges.push_back(Index::Range{ source.indexedEnd, size - source.indexedEnd });
+        }
+
+        for (const auto& range : ranges) {
+            if (range.offset >= size) break;
+            const char* begin = data + range.offset;
+            const char* end = data + (std::min<uint64_t>)(range.offset + range.length, size);
+            if (source.binary) {
+                if (!scanner.ScanBinary(begin, end, range.offset == 0, fractionDigits)) {
+                    results.error = source.name + ": segmento binário corrompido/truncado";
+                }
+            }
+            else {
+                scanner.ScanText(begin, end);
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<const char*> inputs;
+    const char* outputPath = nullptr;
+    bool countOnly = false;
+    int fractionDigits = 3;
+    unsigned threads = (std::max)(1u, std::thread::hardware_concurrency());
+    Filter filter;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view option = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (option == "-o" && hasValue) {
+            outputPath = argv[++i];
+        }
+        else if (option == "-c") {
+            countOnly = true;
+        }
+        else if (option == "-j" && hasValue) {
+            threads = (unsigned)(std::clamp)(atoi(argv[++i]), 1, 256);
+        }
+        else if (option == "-p" && hasValue) {
+            std::string_view precision = argv[++i];
+            if (precision == "s") fractionDigits = 0;
+            else if (precision == "ms") fractionDigits = 3;
+            else if (precision == "us") fractionDigits = 6;
+            else {
+                fprintf(stderr, "logq: precisão inválida '%s' (use s, ms ou us)\n", argv[i]);
+                return 2;
+            }
+        }
+        else if ((option == "-from" || option == "-to") && hasValue) {
+            bool upper = option == "-to";
+            if (!ParseTimeArgument(argv[++i], upper, upper ? filter.toKey : filter.fromKey,
+                upper ? filter.toMicros : filter.fromMicros)) {
+                fprintf(stderr, "logq: horário inválido '%s' (use \"AAAA-MM-DD HH:MM:SS\")\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (option == "-level" && hasValue) {
+            filter.levelMask = 0;
+            std::string_view list = argv[++i];
+            while (!list.empty()) {
+                size_t comma = list.find(',');
+                std::string_view name = list.substr(0, comma);
+                int level = LevelFromName(name);
+                if (level < 0) {
+                    fprintf(stderr, "logq: nível inválido '%.*s'\n", (int)name.size(), name.data());
+                    return 2;
+                }
+                filter.levelMask |= 1u << level;
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            }
+        }
+        else if (option == "-ip" && hasValue) {
+            if (!ParseIp(argv[++i], filter.ip)) {
+                fprintf(stderr, "logq: IP inválido '%s'\n", argv[i]);
+                return 2;
+            }
+            // Mesma forma do TextRenderer ("010.0.0.1" e "10.0.0.01" viram "10.0.0.1")
+            char tag[32];
+            snprintf(tag, sizeof(tag), "[IP:%u.%u.%u.%u]",
+                (filter.ip >> 24) & 0xFF, (filter.ip >> 16) & 0xFF, (filter.ip >> 8) & 0xFF, filter.ip & 0xFF);
+            filter.ipTag = tag;
+        }
+        else if (option == "-s" && hasValue) {
+            filter.substring = std::make_unique<Simd::Finder>(argv[++i]);
+        }
+        else if (option == "-e" && hasValue) {
+            try {
+                filter.regex = std::make_unique<std::regex>(argv[++i], std::regex::ECMAScript | std::regex::optimize);
+            }
+            catch (const std::regex_error& e) {
+                fprintf(stderr, "logq: regex inválida '%s': %s\n", argv[i], e.what());
+                return 2;
+            }
+        }
+        else if (option.size() > 1 && option[0] == '-') {
+            fprintf(stderr, "logq: opção desconhecida ou sem valor: %s\n", argv[i]);
+            return 2;
+        }
+        else {
+            inputs.push_back(argv[i]);
+        }
+    }
+
+    if (inputs.empty()) {
+        fprintf(stderr, "Uso: logq [-from \"AAAA-MM-DD HH:MM:SS\"] [-to ...] [-level ERROR,WARN] [-ip a.b.c.d]\n"
+                        "            [-s texto] [-e regex] [-c] [-j threads] [-p s|ms|us] [-o saida.log]\n"
+                        "            <arquivo|pasta>...\n");
+        return 2;
+    }
+    filter.ChooseDriver();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Source> sources;
+    std::vector<Part> parts;
+    Planner planner(filter, sources, parts);
+    bool ok = true;
+    for (const char* input : inputs) {
+        ok = planner.AddPath(input) && ok;
+    }
+
+    // Uma thread por núcleo, cada uma pegando a próxima parte livre
+    std::vector<Results> results(parts.size());
+    std::atomic<size_t> next{ 0 };
+    auto work = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < parts.size();) {
+            RunPart(sources[parts[i].source], parts[i], filter, countOnly, fractionDigits, results[i]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < (std::min<size_t>)(threads, parts.size()); ++t) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    uint64_t count = 0, scanned = 0;
+    for (const auto& r : results) {
+        count += r.count;
+        scanned += r.bytesScanned;
+        if (!r.error.empty()) {
+            fprintf(stderr, "logq: %s\n", r.error.c_str());
+            ok = false;
+        }
+    }
+
+    FILE* out = stdout;
+    if (outputPath) {
+        out = fopen(outputPath, "wb");
+        if (!out) {
+            fprintf(stderr, "logq: falha ao criar %s\n", outputPath);
+            return 2;
+        }
+    }
+
+    if (countOnly) {
+        fprintf(out, "%llu\n", (unsigned long long)count);
+    }
+    else {
+        // Cada parte já vem quase sempre em ordem; a junção é um merge por horário (empate: ordem dos arquivos)
+        using Cursor = std::pair<uint64_t, size_t>;     // horário, parte
+        std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+        std::vector<size_t> position(results.size(), 0);
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto& lines = results[i].lines;
+            if (!std::is_sorted(lines.begin(), lines.end(), [](const auto& a, const auto& b) { return a.first < b.first; })) {
+                std::stable_sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            }
+            if (!lines.empty()) {
+                heap.emplace(lines[0].first, i);
+            }
+        }
+
+        std::string buffer;
+        buffer.reserve(OUTPUT_CHUNK + 4096);
+        while (!heap.empty()) {
+            size_t i = heap.top().second;
+            heap.pop();
+            const Results& r = results[i];
+            size_t begin = r.lines[position[i]].second;
+            size_t end = r.text.find('\n', begin);
+            buffer.append(r.text, begin, (end == std::string::npos ? r.text.size() : end + 1) - begin);
+            if (++position[i] < r.lines.size()) {
+                heap.emplace(r.lines[position[i]].first, i);
+            }
+            if (buffer.size() >= OUTPUT_CHUNK) {
+                fwrite(buffer.data(), 1, buffer.size(), out);
+                buffer.clear();
+            }
+        }
+        fwrite(buffer.data(), 1, buffer.size(), out);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (out != stdout) {
+        fclose(out);
+    }
+    else {
+        fflush(out);
+    }
+    if (outputPath || countOnly) {
+        fprintf(stderr, "logq: %llu linhas, %zu segmentos, %.1f MB lidos, %.1f MB pulados pelo índice, %.2f s (%s)\n",
+            (unsigned long long)count, sources.size(), scanned / (1024.0 * 1024.0),
+            planner.SkippedBytes() / (1024.0 * 1024.0), seconds, Simd::PathName());
+    }
+
+    return !ok ? 2 : (count > 0 ? 0 : 1);
+}
@@ -175,6 +175,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
                 pLog.Error("Teste de mensagem ERROR", "erro simulado", testIp);
                 pLog.Quest("Quest aceita pelo jogador", "ID Quest: 1001", testIp);
                 pLog.Packets("Pacote C2S_MOVE recebido", "Tamanho: 16 bytes", testIp);
+                pLog.Info<"Jogador {} moveu para {},{}">(1001, 2100, 2100);
                 
                 pLog.Info("Teste de logs concluído");
                 break;